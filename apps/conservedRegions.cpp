@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cctype>
+
+#include "extraFunctions.hpp"
+#include "fastaParser.hpp"
+
+int main(int argc, char *argv[]) {
+	const std::string cliHelp = "Available command line flags (in any order):\n"
+		"  --input-file      file_name (input file name; required).\n"
+		"  --out-file        file_name (output file name; required).\n"
+		"  --window-size     region length (defaults to 100).\n"
+		"  --max-variable    maximal number of variable sites in a region (defaults to 0).\n"
+		"  --min-gc          minimal consensus GC content, in percent (defaults to 40).\n"
+		"  --max-gc          maximal consensus GC content, in percent (defaults to 60).\n"
+		"  --max-regions     maximal number of top-ranked regions to save (defaults to 100).\n"
+		"  --out-format      output file format (FASTA or TAB case-insensitive; defaults to TAB).\n";
+	try {
+		std::unordered_map <std::string, std::string> clInfo;
+		std::unordered_map <std::string, std::string> stringVariables;
+		std::unordered_map <std::string, int> intVariables;
+		BayesicSpace::parseCL(argc, argv, clInfo);
+		BayesicSpace::extractCLinfo(clInfo, intVariables, stringVariables);
+		if ( (intVariables.at("window-size") <= 0) || (intVariables.at("max-variable") < 0) || (intVariables.at("max-regions") <= 0) ) {
+			throw std::string("ERROR: window size and region number must be > 0, variable site number must be >= 0");
+		}
+		if ( (intVariables.at("min-gc") < 0) || (intVariables.at("max-gc") > 100) || ( intVariables.at("min-gc") > intVariables.at("max-gc") ) ) {
+			throw std::string("ERROR: GC content limits must be between 0 and 100, with the minimum not exceeding the maximum");
+		}
+		BayesicSpace::ParseFASTA fastaAlign( stringVariables.at("input-file") );
+		constexpr double percent{100.0};
+		std::vector<BayesicSpace::ConservedRegion> regions = fastaAlign.conservedRegions(
+			static_cast<size_t>( intVariables.at("window-size") ), static_cast<uint32_t>( intVariables.at("max-variable") ),
+			static_cast<double>( intVariables.at("min-gc") ) / percent, static_cast<double>( intVariables.at("max-gc") ) / percent
+		);
+		if ( regions.size() > static_cast<size_t>( intVariables.at("max-regions") ) ) {
+			regions.resize( static_cast<size_t>( intVariables.at("max-regions") ) );
+		}
+		std::transform(stringVariables.at("out-format").begin(), stringVariables.at("out-format").end(),
+				stringVariables.at("out-format").begin(), [](unsigned char letter){return std::tolower(letter);});
+		std::fstream outStream;
+		outStream.open(stringVariables.at("out-file"), std::ios::out);
+		BayesicSpace::saveConservedRegions(regions, fastaAlign, stringVariables.at("out-format"), outStream);
+		outStream.close();
+	} catch(std::string &problem) {
+		std::cerr << problem << "\n";
+		std::cerr << cliHelp;
+		return 1;
+	}
+}
@@ -31,20 +31,58 @@
 #include <algorithm>
 #include <cctype>
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <iterator>
+#include <utility>
+#include <array>
+#include <memory>
 
 #include "extraFunctions.hpp"
 #include "fastaParser.hpp"
+#include "metrics.hpp"
+#include "queryCache.hpp"
+#include "inSilicoPCR.hpp"
+#include "coordinateIndex.hpp"
+#include "blockStore.hpp"
+#include "gapEncodedAlignment.hpp"
+#include "sampleTable.hpp"
 
 int main(int argc, char *argv[]) {
 	const std::string cliHelp = "Available command line flags (in any order):\n"
 		"  --input-file      file_name (input file name; required).\n"
 		"  --start-position  start_position (window start position; defaults to 1, first nucleotide).\n"
 		"  --window-size     window_size (window size for similarity estimates; required).\n"
+		"  --reference-sample header of the sequence whose ungapped coordinates are used for the start position and window size,\n"
+		"                    and for the reported query match position (defaults to alignment columns).\n"
+		"  --mask-file       file_name (BED file of regions to exclude; in --reference-sample coordinates if that flag is set, alignment columns otherwise).\n"
 		"  --impute-missing  if set (with no value) replaces missing values with the consensus nucleotide.\n"
+		"  --merge-compatible if set (with no value) window sequences that agree wherever neither has missing data (N or other ambiguity codes) are counted as one haplotype.\n"
+		"  --select          predicate (if set, only sequences whose header fields match are used, e.g. 'lineage=B.1 & date>2021-01'; fields are key=value or |-delimited, the latter named field1, field2, ...).\n"
+		"  --max-missing     maximal percent of missing residues (N, ambiguity codes, gaps) in a window sequence; sequences above it are left out of that window (defaults to 100).\n"
+		"  --reorder-sequences if set (with no value) similar sequences are stored together to speed up window comparisons; output is not affected.\n"
 		"  --query-sequence  a FASTA file with a query sequence to extract a window containing its best match;\n"
 		"                    if provided, the --start-position and --window-size flags are ingnored.\n"
+		"  --protein-query   if set (with no value) the query is a protein sequence searched against the six-frame translation of the consensus.\n"
+		"  --long-query      if set (with no value) long queries (several kb or more) are matched by minimizer chaining instead of full Smith-Waterman.\n"
+		"  --query-cache     file_name (if set, query alignment results are cached in this file and re-used in later runs).\n"
+		"  --forward-primer  forward primer sequence (IUPAC codes allowed); with --reverse-primer, the window spans the in-silico PCR products\n"
+		"                    in all sequences and the --start-position and --window-size flags are ignored.\n"
+		"  --reverse-primer  reverse primer sequence (IUPAC codes allowed).\n"
+		"  --max-mismatches  maximal number of mismatches per primer (defaults to 0).\n"
+		"  --max-amplicon    maximal PCR product length (defaults to 5000).\n"
+		"  --pcr-table       file_name (if set, per-sequence primer binding positions, mismatches, and products are saved to this file).\n"
+		"  --threads         number of threads for in-silico PCR and window extraction (defaults to 1).\n"
+		"  --engine          window counting engine: auto (chosen from sampled alignment statistics), hash, projection, packed, or prefix-hash (defaults to auto; the choice is reported on standard error).\n"
+		"  --hash-checkpoints spacing (if > 0, a prefix-hash index with checkpoints every this many columns is built, so that long windows are hashed at a cost independent of their length; defaults to 0).\n"
+		"  --block-size      columns per block (if > 0, the input is streamed into a block-compressed store and the window is decompressed\n"
+		"                    from the blocks it covers, without loading the whole alignment; only --start-position, --window-size, --sorted,\n"
+		"                    TAB or FASTA --out-format, and --metrics-file apply; defaults to 0, loading the alignment).\n"
+		"  --gap-encoded     if set (with no value) the input is streamed into a gap-run encoded store (gap columns take no memory) and the window\n"
+		"                    is extracted from it; the same restrictions as for --block-size apply.\n"
 		"  --sorted          if set (with no value) sorts the window output by sequence occurrence, descending.\n"
-		"  --out-format      output file format (FASTA or TAB case-insensitive; defaults to TAB).\n"
+		"  --out-format      output file format (FASTA, TAB, or POLYMORPHIC case-insensitive; defaults to TAB). POLYMORPHIC writes only the polymorphic columns of the window: a line with their base-1 positions, their consensus, and one compact haplotype per unique sequence, counted by the --engine choice.\n"
+		"  --metrics-file    file_name (if set, performance metrics are saved to this file in the Prometheus text format).\n"
 		"  --out-file        file_name (output file name; required).\n";
 	try {
 		std::unordered_map <std::string, std::string> clInfo;
@@ -52,39 +90,208 @@ int main(int argc, char *argv[]) {
 		std::unordered_map <std::string, int> intVariables;
 		BayesicSpace::parseCL(argc, argv, clInfo);
 		BayesicSpace::extractCLinfo(clInfo, intVariables, stringVariables);
-		BayesicSpace::ParseFASTA fastaAlign( stringVariables.at("input-file") );
+		BayesicSpace::MetricsRegistry metrics;
+		if (intVariables.at("block-size") < 0) {
+			throw std::string("ERROR: block size must be >= 0");
+		}
+		const bool blockMode      = intVariables.at("block-size") > 0;
+		const bool gapEncodedMode = stringVariables.at("gap-encoded") == "set";
+		if (blockMode || gapEncodedMode) {
+			// stream the alignment into a compact store; only plain column windows are supported
+			if (blockMode && gapEncodedMode) {
+				throw std::string("ERROR: --block-size and --gap-encoded cannot be used together");
+			}
+			const std::array<std::string, 8> fullAlignmentFlags{"mask-file", "impute-missing", "merge-compatible", "select", "reorder-sequences",
+				"query-sequence", "forward-primer", "reference-sample"};
+			for (const auto &eachFlag : fullAlignmentFlags) {
+				if (stringVariables.at(eachFlag) != "unset") {
+					throw std::string("ERROR: --") + eachFlag + std::string(" cannot be used with --block-size or --gap-encoded");
+				}
+			}
+			if ( (intVariables.at("max-missing") != 100) || (intVariables.at("hash-checkpoints") != 0) ) {
+				throw std::string("ERROR: --max-missing and --hash-checkpoints cannot be used with --block-size or --gap-encoded");
+			}
+			if (intVariables.at("window-size") <= 0) {
+				throw std::string("ERROR: window size must be > 0");
+			}
+			if (intVariables.at("start-position") <= 0) {
+				throw std::string("ERROR: start position must be greater than 1");
+			}
+			std::transform(stringVariables.at("out-format").begin(), stringVariables.at("out-format").end(),
+					stringVariables.at("out-format").begin(), [](unsigned char letter){return std::tolower(letter);});
+			if (stringVariables.at("out-format") == "polymorphic") {
+				throw std::string("ERROR: POLYMORPHIC output cannot be used with --block-size or --gap-encoded");
+			}
+			const size_t windowSize    = static_cast<size_t>( intVariables.at("window-size") );
+			const size_t startPosition = static_cast<size_t>( intVariables.at("start-position") ) - 1;  // make position base-0
+			auto saveStoreWindow = [&](const auto &alignmentStore){
+				metrics.gauge("analyze_alignments_sequences")         = static_cast<int64_t>( alignmentStore.sequenceNumber() );
+				metrics.gauge("analyze_alignments_alignment_columns") = static_cast<int64_t>( alignmentStore.alignmentLength() );
+				BayesicSpace::ScopedTimer windowTimer( metrics.histogram("analyze_alignments_window_seconds") ); // extraction and output
+				const std::string consensusWindow{alignmentStore.consensusWindow(startPosition, windowSize)};
+				std::fstream outStream;
+				if (stringVariables.at("sorted") == "unset") {
+					auto result{alignmentStore.extractWindow(startPosition, windowSize)};
+					outStream.open(stringVariables.at("out-file"), std::ios::out);
+					BayesicSpace::saveUniqueSequences(result, consensusWindow, stringVariables.at("out-format"), outStream);
+				} else {
+					auto result{alignmentStore.extractWindowSorted(startPosition, windowSize)};
+					outStream.open(stringVariables.at("out-file"), std::ios::out);
+					BayesicSpace::saveUniqueSequences(result, consensusWindow, stringVariables.at("out-format"), outStream);
+				}
+				outStream.close();
+			};
+			if (blockMode) {
+				const size_t blockSize = static_cast<size_t>( intVariables.at("block-size") );
+				std::unique_ptr<const BayesicSpace::BlockCompressedAlignment> blockStore;
+				{
+					BayesicSpace::ScopedTimer loadTimer( metrics.histogram("analyze_alignments_load_seconds") );
+					// enough cache for every block the window touches
+					blockStore = std::make_unique<const BayesicSpace::BlockCompressedAlignment>(stringVariables.at("input-file"), blockSize, windowSize / blockSize + 2);
+				}
+				saveStoreWindow(*blockStore);
+			} else {
+				BayesicSpace::GapEncodedAlignment gapStore;
+				{
+					BayesicSpace::ScopedTimer loadTimer( metrics.histogram("analyze_alignments_load_seconds") );
+					gapStore = BayesicSpace::GapEncodedAlignment( stringVariables.at("input-file") );
+				}
+				saveStoreWindow(gapStore);
+			}
+			if (stringVariables.at("metrics-file") != "unset") {
+				metrics.dumpToFile( stringVariables.at("metrics-file") );
+			}
+			return 0;
+		}
+		BayesicSpace::ParseFASTA fastaAlign;
+		{
+			BayesicSpace::ScopedTimer loadTimer( metrics.histogram("analyze_alignments_load_seconds") );
+			fastaAlign = BayesicSpace::ParseFASTA( stringVariables.at("input-file") );
+		}
+		metrics.gauge("analyze_alignments_sequences")         = static_cast<int64_t>( fastaAlign.sequenceNumber() );
+		metrics.gauge("analyze_alignments_alignment_columns") = static_cast<int64_t>( fastaAlign.alignmentLength() );
+		if (stringVariables.at("mask-file") != "unset") {
+			BayesicSpace::ScopedTimer maskTimer( metrics.histogram("analyze_alignments_mask_seconds") );
+			BayesicSpace::applyBEDmask( stringVariables.at("mask-file"), stringVariables.at("reference-sample"), fastaAlign );
+		}
 		if (stringVariables.at("impute-missing") == "set") {
+			BayesicSpace::ScopedTimer imputeTimer( metrics.histogram("analyze_alignments_impute_seconds") );
 			fastaAlign.imputeMissing();
 		}
+		if ( (intVariables.at("max-missing") < 0) || (intVariables.at("max-missing") > 100) ) {
+			throw std::string("ERROR: maximal missing data percentage must be between 0 and 100");
+		}
+		constexpr double percent{100.0};
+		fastaAlign.filterMissing(static_cast<double>( intVariables.at("max-missing") ) / percent);
+		fastaAlign.groupCompatible(stringVariables.at("merge-compatible") == "set");
+		if (stringVariables.at("select") != "unset") {
+			const BayesicSpace::SampleTable samples(fastaAlign);
+			fastaAlign.selectSamples( samples.select( stringVariables.at("select") ) );
+		}
+		if (stringVariables.at("reorder-sequences") == "set") {
+			BayesicSpace::ScopedTimer reorderTimer( metrics.histogram("analyze_alignments_reorder_seconds") );
+			fastaAlign.reorderBySimilarity();
+		}
+		if (intVariables.at("hash-checkpoints") < 0) {
+			throw std::string("ERROR: hash checkpoint spacing must be >= 0");
+		}
+		if ( (intVariables.at("hash-checkpoints") > 0) && (fastaAlign.sequenceNumber() > 0) ) {
+			BayesicSpace::ScopedTimer indexTimer( metrics.histogram("analyze_alignments_prefix_hash_seconds") );
+			fastaAlign.buildPrefixHashIndex( static_cast<size_t>( intVariables.at("hash-checkpoints") ) );
+		}
+		if (intVariables.at("threads") <= 0) {
+			throw std::string("ERROR: thread number must be > 0");
+		}
 		size_t windowSize{0};
 		size_t startPosition{0};
+		// stays empty without a reference sample, so positions are reported in alignment columns
+		BayesicSpace::CoordinateIndex sampleCoordinates;
+		if (stringVariables.at("reference-sample") != "unset") {
+			sampleCoordinates = fastaAlign.coordinateIndex( stringVariables.at("reference-sample") );
+		}
 		if (stringVariables.at("query-sequence") == "unset") {
-			if (intVariables.at("window-size") > 0) {
-				windowSize = static_cast<size_t>( intVariables.at("window-size") );
+			if (stringVariables.at("forward-primer") != "unset") {
+				if (stringVariables.at("reverse-primer") == "unset") {
+					throw std::string("ERROR: reverse primer must be specified with the forward primer");
+				}
+				if ( (intVariables.at("max-mismatches") < 0) || (intVariables.at("max-amplicon") <= 0) ) {
+					throw std::string("ERROR: mismatch number must be >= 0, maximal amplicon length must be > 0");
+				}
+				const BayesicSpace::InSilicoPCR pcr( stringVariables.at("forward-primer"), stringVariables.at("reverse-primer"),
+						static_cast<uint32_t>( intVariables.at("max-mismatches") ), static_cast<size_t>( intVariables.at("max-amplicon") ) );
+				std::vector<BayesicSpace::AmpliconResult> pcrResults;
+				{
+					BayesicSpace::ScopedTimer pcrTimer( metrics.histogram("analyze_alignments_pcr_seconds") );
+					pcrResults = pcr.amplify( fastaAlign, static_cast<size_t>( intVariables.at("threads") ) );
+				}
+				if (stringVariables.at("pcr-table") != "unset") {
+					std::fstream pcrStream;
+					pcrStream.open(stringVariables.at("pcr-table"), std::ios::out);
+					BayesicSpace::savePCRresults(pcrResults, fastaAlign, pcrStream);
+					pcrStream.close();
+				}
+				// the window covers the products of all amplified sequences
+				size_t windowEnd{0};
+				startPosition = fastaAlign.alignmentLength();
+				for (const auto &eachResult : pcrResults) {
+					if (eachResult.amplified) {
+						startPosition = std::min(startPosition, eachResult.ampliconStartColumn);
+						windowEnd     = std::max(windowEnd, eachResult.ampliconEndColumn + 1);
+					}
+				}
+				if ( startPosition >= fastaAlign.alignmentLength() ) {
+					throw std::string("ERROR: the primers do not amplify any sequence");
+				}
+				windowSize = windowEnd - startPosition;
 			} else {
-				throw std::string("ERROR: window size must be > 0");
-			}
-			if (intVariables.at("start-position") > 0) {
-				startPosition = static_cast<size_t>( intVariables.at("start-position") ) - 1;  // make position base-0
-			} else {
-				throw std::string("ERROR: start position must be greater than 1");
+				if (intVariables.at("window-size") > 0) {
+					windowSize = static_cast<size_t>( intVariables.at("window-size") );
+				} else {
+					throw std::string("ERROR: window size must be > 0");
+				}
+				if (intVariables.at("start-position") > 0) {
+					startPosition = static_cast<size_t>( intVariables.at("start-position") ) - 1;  // make position base-0
+				} else {
+					throw std::string("ERROR: start position must be greater than 1");
+				}
+				if (stringVariables.at("reference-sample") != "unset") {
+					if ( startPosition + windowSize > sampleCoordinates.sequenceLength() ) {
+						throw std::string("ERROR: window extends past the end of the reference sample");
+					}
+					const size_t endColumn = sampleCoordinates.toAlignmentColumn(startPosition + windowSize - 1);
+					startPosition          = sampleCoordinates.toAlignmentColumn(startPosition);
+					windowSize             = endColumn - startPosition + 1;
+				}
 			}
-			std::string consensusWindow{fastaAlign.extractConsensusWindow(startPosition, windowSize)};
 			// convert to lower case in-place
 			std::transform(stringVariables.at("out-format").begin(), stringVariables.at("out-format").end(),
 					stringVariables.at("out-format").begin(), [](unsigned char letter){return std::tolower(letter);});
-			if (stringVariables.at("sorted") == "unset") {
-				auto result{fastaAlign.extractWindow(startPosition, windowSize)};
+			const BayesicSpace::WindowPlan windowPlan{fastaAlign.planWindows( windowSize, 1, static_cast<size_t>( intVariables.at("threads") ),
+				BayesicSpace::parseWindowEngine( stringVariables.at("engine") ) )};
+			std::cerr << BayesicSpace::describeWindowPlan(windowPlan) << "\n";
+			if (stringVariables.at("out-format") == "polymorphic") {
+				BayesicSpace::ScopedTimer windowTimer( metrics.histogram("analyze_alignments_window_seconds") ); // extraction and output
 				std::fstream outStream;
 				outStream.open(stringVariables.at("out-file"), std::ios::out);
-				BayesicSpace::saveUniqueSequences(result, consensusWindow, stringVariables.at("out-format"), outStream);
+				BayesicSpace::savePolymorphicWindow(fastaAlign, startPosition, windowSize, windowPlan, stringVariables.at("sorted") != "unset", sampleCoordinates, outStream);
 				outStream.close();
 			} else {
-				auto result{fastaAlign.extractWindowSorted(startPosition, windowSize)};
-				std::fstream outStream;
-				outStream.open(stringVariables.at("out-file"), std::ios::out);
-				BayesicSpace::saveUniqueSequences(result, consensusWindow, stringVariables.at("out-format"), outStream);
-				outStream.close();
+				const std::string consensusWindow{fastaAlign.extractConsensusWindow(startPosition, windowSize)};
+				if (stringVariables.at("sorted") == "unset") {
+					BayesicSpace::ScopedTimer windowTimer( metrics.histogram("analyze_alignments_window_seconds") ); // extraction and output
+					auto result{fastaAlign.extractWindow( startPosition, windowSize, windowPlan)};
+					std::fstream outStream;
+					outStream.open(stringVariables.at("out-file"), std::ios::out);
+					BayesicSpace::saveUniqueSequences(result, consensusWindow, stringVariables.at("out-format"), outStream);
+					outStream.close();
+				} else {
+					BayesicSpace::ScopedTimer windowTimer( metrics.histogram("analyze_alignments_window_seconds") ); // extraction and output
+					auto result{fastaAlign.extractWindowSorted( startPosition, windowSize, windowPlan)};
+					std::fstream outStream;
+					outStream.open(stringVariables.at("out-file"), std::ios::out);
+					BayesicSpace::saveUniqueSequences(result, consensusWindow, stringVariables.at("out-format"), outStream);
+					outStream.close();
+				}
 			}
 		} else {
 			std::fstream fastaQueryFile;
@@ -99,28 +306,69 @@ int main(int argc, char *argv[]) {
 				querySequence += fastaQueryLine;
 			}
 			fastaQueryFile.close();
-			BayesicSpace::AlignmentStatistics windowParams{fastaAlign.extractSequence(querySequence)};
+			BayesicSpace::AlignmentStatistics windowParams{};
+			{
+				BayesicSpace::ScopedTimer queryTimer( metrics.histogram("analyze_alignments_query_seconds") );
+				if (stringVariables.at("protein-query") == "set") {
+					windowParams = fastaAlign.extractProteinSequence(querySequence);
+				} else if (stringVariables.at("long-query") == "set") {
+					windowParams = fastaAlign.extractLongSequence(querySequence);
+				} else if (stringVariables.at("query-cache") == "unset") {
+					windowParams = fastaAlign.extractSequence(querySequence);
+				} else {
+					BayesicSpace::QueryCache queryCache( stringVariables.at("query-cache") );
+					windowParams = fastaAlign.extractSequence(querySequence, queryCache);
+					metrics.counter("analyze_alignments_query_cache_hits_total")   += queryCache.hits();
+					metrics.counter("analyze_alignments_query_cache_misses_total") += queryCache.misses();
+				}
+			}
 			startPosition = windowParams.referenceStart;
 			windowSize    = windowParams.referenceLength;
 			querySequence = querySequence.substr(windowParams.queryStart, windowParams.queryLength);
-			std::string consensusWindow{fastaAlign.extractConsensusWindow(startPosition, windowSize)};
+			if (stringVariables.at("reference-sample") != "unset") {
+				// report the match in reference sample coordinates
+				const size_t sampleStart = sampleCoordinates.toSequencePosition(windowParams.referenceStart);
+				const size_t sampleEnd   = sampleCoordinates.toSequencePosition(windowParams.referenceStart + windowParams.referenceLength + 1);
+				if (sampleEnd <= sampleStart) {
+					throw std::string("ERROR: the reference sample has no residues in the matching window");
+				}
+				windowParams.referenceStart  = sampleStart;
+				windowParams.referenceLength = sampleEnd - 1 - sampleStart;
+			}
 			// convert to lower case in-place
 			std::transform(stringVariables.at("out-format").begin(), stringVariables.at("out-format").end(),
 					stringVariables.at("out-format").begin(), [](unsigned char letter){return std::tolower(letter);});
-			if (stringVariables.at("sorted") == "unset") {
-				auto result{fastaAlign.extractWindow(startPosition, windowSize)};
+			const BayesicSpace::WindowPlan windowPlan{fastaAlign.planWindows( windowSize, 1, static_cast<size_t>( intVariables.at("threads") ),
+				BayesicSpace::parseWindowEngine( stringVariables.at("engine") ) )};
+			std::cerr << BayesicSpace::describeWindowPlan(windowPlan) << "\n";
+			if (stringVariables.at("out-format") == "polymorphic") {
+				BayesicSpace::ScopedTimer windowTimer( metrics.histogram("analyze_alignments_window_seconds") ); // extraction and output
 				std::fstream outStream;
 				outStream.open(stringVariables.at("out-file"), std::ios::out);
-				BayesicSpace::saveUniqueSequences(result, consensusWindow, windowParams, querySequence, stringVariables.at("out-format"), outStream);
+				BayesicSpace::savePolymorphicWindow(fastaAlign, startPosition, windowSize, windowParams, querySequence, windowPlan, stringVariables.at("sorted") != "unset", sampleCoordinates, outStream);
 				outStream.close();
 			} else {
-				auto result{fastaAlign.extractWindowSorted(startPosition, windowSize)};
-				std::fstream outStream;
-				outStream.open(stringVariables.at("out-file"), std::ios::out);
-				BayesicSpace::saveUniqueSequences(result, consensusWindow, windowParams, querySequence, stringVariables.at("out-format"), outStream);
-				outStream.close();
+				const std::string consensusWindow{fastaAlign.extractConsensusWindow(startPosition, windowSize)};
+				if (stringVariables.at("sorted") == "unset") {
+					BayesicSpace::ScopedTimer windowTimer( metrics.histogram("analyze_alignments_window_seconds") ); // extraction and output
+					auto result{fastaAlign.extractWindow( startPosition, windowSize, windowPlan)};
+					std::fstream outStream;
+					outStream.open(stringVariables.at("out-file"), std::ios::out);
+					BayesicSpace::saveUniqueSequences(result, consensusWindow, windowParams, querySequence, stringVariables.at("out-format"), outStream);
+					outStream.close();
+				} else {
+					BayesicSpace::ScopedTimer windowTimer( metrics.histogram("analyze_alignments_window_seconds") ); // extraction and output
+					auto result{fastaAlign.extractWindowSorted( startPosition, windowSize, windowPlan)};
+					std::fstream outStream;
+					outStream.open(stringVariables.at("out-file"), std::ios::out);
+					BayesicSpace::saveUniqueSequences(result, consensusWindow, windowParams, querySequence, stringVariables.at("out-format"), outStream);
+					outStream.close();
+				}
 			}
 		}
+		if (stringVariables.at("metrics-file") != "unset") {
+			metrics.dumpToFile( stringVariables.at("metrics-file") );
+		}
 	} catch(std::string &problem) {
 		std::cerr << problem << "\n";
 		std::cerr << cliHelp;
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <utility>
+
+#include "extraFunctions.hpp"
+#include "fastaParser.hpp"
+#include "featureIndex.hpp"
+#include "coordinateIndex.hpp"
+
+int main(int argc, char *argv[]) {
+	const std::string cliHelp = "Available command line flags (in any order):\n"
+		"  --input-file       file_name (input file name; required).\n"
+		"  --feature-file     file_name (GFF/GTF, recognized by extension, or BED annotation file; required).\n"
+		"  --feature-type     only analyze features of this type, e.g. CDS (defaults to all features).\n"
+		"  --reference-sample header of the sequence the features are annotated on (defaults to alignment columns).\n"
+		"  --region           start-end (if set, only features overlapping these base-1 positions, inclusive, are analyzed; in --reference-sample coordinates if that flag is set).\n"
+		"  --mask-file        file_name (BED file of regions to exclude; in --reference-sample coordinates if that flag is set, alignment columns otherwise).\n"
+		"  --impute-missing   if set (with no value) replaces missing values with the consensus nucleotide.\n"
+		"  --threads          number of threads (defaults to 1).\n"
+		"  --out-file         file_name (output file name; required).\n";
+	try {
+		std::unordered_map <std::string, std::string> clInfo;
+		std::unordered_map <std::string, std::string> stringVariables;
+		std::unordered_map <std::string, int> intVariables;
+		BayesicSpace::parseCL(argc, argv, clInfo);
+		BayesicSpace::extractCLinfo(clInfo, intVariables, stringVariables);
+		if (stringVariables.at("feature-file") == "unset") {
+			throw std::string("ERROR: feature file is required");
+		}
+		if (intVariables.at("threads") <= 0) {
+			throw std::string("ERROR: thread number must be > 0");
+		}
+		BayesicSpace::ParseFASTA fastaAlign( stringVariables.at("input-file") );
+		if (stringVariables.at("mask-file") != "unset") {
+			BayesicSpace::applyBEDmask( stringVariables.at("mask-file"), stringVariables.at("reference-sample"), fastaAlign );
+		}
+		if (stringVariables.at("impute-missing") == "set") {
+			fastaAlign.imputeMissing();
+		}
+		std::vector<BayesicSpace::GenomicFeature> features;
+		BayesicSpace::readFeatures(stringVariables.at("feature-file"), stringVariables.at("feature-type"), features);
+		BayesicSpace::FeatureIndex featureIndex( std::move(features) );
+		if (stringVariables.at("reference-sample") != "unset") {
+			featureIndex.liftOver( fastaAlign.coordinateIndex( stringVariables.at("reference-sample") ) );
+		}
+		std::vector<BayesicSpace::FeatureStatistics> featureStats;
+		if (stringVariables.at("region") == "unset") {
+			featureStats = featureIndex.statistics( fastaAlign, static_cast<size_t>( intVariables.at("threads") ) );
+		} else {
+			std::pair<size_t, size_t> region{BayesicSpace::parseRegion( stringVariables.at("region") )};
+			if (stringVariables.at("reference-sample") != "unset") {
+				const BayesicSpace::CoordinateIndex sampleCoordinates{fastaAlign.coordinateIndex( stringVariables.at("reference-sample") )};
+				if ( region.second > sampleCoordinates.sequenceLength() ) {
+					throw std::string("ERROR: region extends past the end of the reference sample");
+				}
+				const size_t endColumn = sampleCoordinates.toAlignmentColumn(region.second - 1) + 1;
+				region.first           = sampleCoordinates.toAlignmentColumn(region.first);
+				region.second          = endColumn;
+			}
+			featureStats = featureIndex.statistics( fastaAlign, static_cast<size_t>( intVariables.at("threads") ), featureIndex.overlapping(region.first, region.second) );
+		}
+		std::fstream outStream;
+		outStream.open(stringVariables.at("out-file"), std::ios::out);
+		BayesicSpace::saveFeatureStatistics(featureStats, featureIndex, outStream);
+		outStream.close();
+	} catch(std::string &problem) {
+		std::cerr << problem << "\n";
+		std::cerr << cliHelp;
+		return 1;
+	}
+}
@@ -29,16 +29,35 @@
 
 #include <fstream>
 #include <iostream>
+#include <vector>
 
 #include "extraFunctions.hpp"
 #include "fastaParser.hpp"
+#include "metrics.hpp"
+#include "coordinateIndex.hpp"
+#include "sampleTable.hpp"
+#include "indelIndex.hpp"
 
 int main(int argc, char *argv[]) {
 	const std::string cliHelp = "Available command line flags (in any order):\n"
 		"  --input-file      file_name (input file name; required).\n"
 		"  --window-size     window_size (window size for similarity estimates; defaults to 100).\n"
 		"  --step-size       step_size (step size for similarity estimates; defaults to 10).\n"
+		"  --reference-sample header of the sequence whose ungapped coordinates are used to report window positions (defaults to alignment columns).\n"
+		"  --mask-file       file_name (BED file of regions to exclude; in --reference-sample coordinates if that flag is set, alignment columns otherwise).\n"
+		"  --shard           i/N (if set, only the i-th of N consecutive blocks of windows is computed, reading only the columns it needs; cannot be combined with --reference-sample or --mask-file).\n"
+		"  --progressive     if set (with no value) windows are written as they are computed, first a sparse overview and then the windows in between, so rows are not in position order.\n"
+		"  --indels          if set (with no value) the table gets per-window counts, mean lengths, and mean frequencies of distinct polymorphic internal gap runs,\n"
+		"                    among the sequences and unmasked columns used for the window counts (cannot be combined with --shard).\n"
 		"  --impute-missing  if set (with no value) replaces missing values with the consensus nucleotide.\n"
+		"  --merge-compatible if set (with no value) window sequences that agree wherever neither has missing data (N or other ambiguity codes) are counted as one haplotype.\n"
+		"  --select          predicate (if set, only sequences whose header fields match are used, e.g. 'lineage=B.1 & date>2021-01'; fields are key=value or |-delimited, the latter named field1, field2, ...).\n"
+		"  --max-missing     maximal percent of missing residues (N, ambiguity codes, gaps) in a window sequence; sequences above it are left out of that window (defaults to 100).\n"
+		"  --threads         number of threads for the diversity scan (defaults to 1).\n"
+		"  --engine          window counting engine: auto (chosen from sampled alignment statistics), hash, projection, packed, or prefix-hash (defaults to auto; the choice is reported on standard error).\n"
+		"  --hash-checkpoints spacing (if > 0, a prefix-hash index with checkpoints every this many columns is built, so that long windows are hashed at a cost independent of their length; defaults to 0).\n"
+		"  --reorder-sequences if set (with no value) similar sequences are stored together to speed up window comparisons; output is not affected.\n"
+		"  --metrics-file    file_name (if set, performance metrics are saved to this file in the Prometheus text format).\n"
 		"  --out-file        file_name (output file name; required).\n";
 	try {
 		std::unordered_map <std::string, std::string> clInfo;
@@ -46,10 +65,7 @@ int main(int argc, char *argv[]) {
 		std::unordered_map <std::string, int> intVariables;
 		BayesicSpace::parseCL(argc, argv, clInfo);
 		BayesicSpace::extractCLinfo(clInfo, intVariables, stringVariables);
-		BayesicSpace::ParseFASTA fastaAlign( stringVariables.at("input-file") );
-		if (stringVariables.at("impute-missing") == "set") {
-			fastaAlign.imputeMissing();
-		}
+		BayesicSpace::MetricsRegistry metrics;
 		size_t windowSize{0};
 		if (intVariables.at("window-size") > 0) {
 			windowSize = static_cast<size_t>( intVariables.at("window-size") );
@@ -62,11 +78,184 @@ int main(int argc, char *argv[]) {
 		} else {
 			throw std::string("ERROR: step size must be > 0");
 		}
-		auto result{fastaAlign.diversityInWindows(windowSize, stepSize)};
-		std::fstream outStream;
-		outStream.open(stringVariables.at("out-file"), std::ios::out);
-		BayesicSpace::saveDiversityTable(result, outStream);
-		outStream.close();
+		if (intVariables.at("threads") <= 0) {
+			throw std::string("ERROR: thread number must be > 0");
+		}
+		size_t shardFirstColumn{0};
+		size_t shardColumns{0};
+		const bool shardMode = stringVariables.at("shard") != "unset";
+		const bool withIndels = stringVariables.at("indels") == "set";
+		// gap runs that reach shard boundaries cannot be told apart from terminal gaps
+		if (withIndels && shardMode) {
+			throw std::string("ERROR: --indels cannot be combined with --shard");
+		}
+		BayesicSpace::ParseFASTA fastaAlign;
+		{
+			BayesicSpace::ScopedTimer loadTimer( metrics.histogram("analyze_alignments_load_seconds") );
+			if (shardMode) {
+				if ( (stringVariables.at("reference-sample") != "unset") || (stringVariables.at("mask-file") != "unset") ) {
+					throw std::string("ERROR: --shard cannot be combined with --reference-sample or --mask-file");
+				}
+				size_t shardIdx{0};
+				size_t shardNumber{0};
+				BayesicSpace::parseShard(stringVariables.at("shard"), shardIdx, shardNumber);
+				const std::vector<BayesicSpace::FastaIndexRecord> fastaIndex{BayesicSpace::indexFASTA( stringVariables.at("input-file") )};
+				if ( fastaIndex.empty() ) {
+					throw std::string("ERROR: no sequences in ") + stringVariables.at("input-file");
+				}
+				const auto columnRange = BayesicSpace::shardColumnRange(shardIdx, shardNumber, fastaIndex[0].length, windowSize, stepSize);
+				shardFirstColumn       = columnRange.first;
+				shardColumns           = columnRange.second;
+				if (shardColumns > 0) {
+					fastaAlign = BayesicSpace::ParseFASTA(stringVariables.at("input-file"), fastaIndex, shardFirstColumn, shardColumns);
+				}
+			} else {
+				fastaAlign = BayesicSpace::ParseFASTA( stringVariables.at("input-file") );
+			}
+		}
+		metrics.gauge("analyze_alignments_sequences")         = static_cast<int64_t>( fastaAlign.sequenceNumber() );
+		metrics.gauge("analyze_alignments_alignment_columns") = static_cast<int64_t>( shardMode ? shardColumns : fastaAlign.alignmentLength() );
+		if (stringVariables.at("mask-file") != "unset") {
+			BayesicSpace::ScopedTimer maskTimer( metrics.histogram("analyze_alignments_mask_seconds") );
+			BayesicSpace::applyBEDmask( stringVariables.at("mask-file"), stringVariables.at("reference-sample"), fastaAlign );
+		}
+		if (stringVariables.at("impute-missing") == "set") {
+			BayesicSpace::ScopedTimer imputeTimer( metrics.histogram("analyze_alignments_impute_seconds") );
+			fastaAlign.imputeMissing();
+		}
+		if ( (intVariables.at("max-missing") < 0) || (intVariables.at("max-missing") > 100) ) {
+			throw std::string("ERROR: maximal missing data percentage must be between 0 and 100");
+		}
+		constexpr double percent{100.0};
+		fastaAlign.filterMissing(static_cast<double>( intVariables.at("max-missing") ) / percent);
+		fastaAlign.groupCompatible(stringVariables.at("merge-compatible") == "set");
+		// an empty shard has no headers to select from, and its table stays empty either way
+		if ( (stringVariables.at("select") != "unset") && ( !shardMode || (shardColumns > 0) ) ) {
+			const BayesicSpace::SampleTable samples(fastaAlign);
+			fastaAlign.selectSamples( samples.select( stringVariables.at("select") ) );
+		}
+		if (stringVariables.at("reorder-sequences") == "set") {
+			BayesicSpace::ScopedTimer reorderTimer( metrics.histogram("analyze_alignments_reorder_seconds") );
+			fastaAlign.reorderBySimilarity();
+		}
+		if (intVariables.at("hash-checkpoints") < 0) {
+			throw std::string("ERROR: hash checkpoint spacing must be >= 0");
+		}
+		if ( (intVariables.at("hash-checkpoints") > 0) && (fastaAlign.sequenceNumber() > 0) ) {
+			BayesicSpace::ScopedTimer indexTimer( metrics.histogram("analyze_alignments_prefix_hash_seconds") );
+			fastaAlign.buildPrefixHashIndex( static_cast<size_t>( intVariables.at("hash-checkpoints") ) );
+		}
+		// indel statistics are filtered per window like the diversity counts
+		BayesicSpace::IndelIndex indels;
+		if (withIndels) {
+			BayesicSpace::ScopedTimer indelTimer( metrics.histogram("analyze_alignments_indel_seconds") );
+			indels = BayesicSpace::IndelIndex(fastaAlign);
+			metrics.gauge("analyze_alignments_indel_events") = static_cast<int64_t>( indels.size() );
+		}
+		if (stringVariables.at("progressive") == "set") {
+			const bool masked   = stringVariables.at("mask-file") != "unset";
+			const bool liftOver = stringVariables.at("reference-sample") != "unset";
+			BayesicSpace::CoordinateIndex sampleCoordinates;
+			if (liftOver) {
+				sampleCoordinates = fastaAlign.coordinateIndex( stringVariables.at("reference-sample") );
+			}
+			std::fstream outStream;
+			outStream.open(stringVariables.at("out-file"), std::ios::out);
+			outStream << (masked ? "position\tcount\tunmasked" : "position\tcount") << (withIndels ? "\tindels\tmean_length\tmean_frequency\n" : "\n") << std::flush;
+			// a shard without windows leaves the table empty
+			if ( !shardMode || (shardColumns > 0) ) {
+				BayesicSpace::ScopedTimer scanTimer( metrics.histogram("analyze_alignments_diversity_scan_seconds") );
+				// the first pass reports about overviewWindows evenly spaced windows
+				constexpr size_t overviewWindows{100};
+				const size_t windowNumber = fastaAlign.alignmentLength() > windowSize ? (fastaAlign.alignmentLength() - windowSize - 1) / stepSize + 1 : 0;
+				const BayesicSpace::WindowPlan windowPlan{fastaAlign.planWindows( windowSize, windowNumber, static_cast<size_t>( intVariables.at("threads") ),
+					BayesicSpace::parseWindowEngine( stringVariables.at("engine") ) )};
+				std::cerr << BayesicSpace::describeWindowPlan(windowPlan) << "\n";
+				metrics.gauge("analyze_alignments_scan_threads") = static_cast<int64_t>(windowPlan.threads);
+				metrics.counter("analyze_alignments_windows_total") += fastaAlign.diversityInWindows(windowSize, stepSize, windowNumber / overviewWindows, windowPlan,
+					[&](const size_t &windowStart, std::vector<uint32_t> &&counts){
+						const size_t position = liftOver ? sampleCoordinates.toSequencePosition(windowStart) : windowStart + shardFirstColumn;
+						BayesicSpace::IndelWindowStatistics indelStats{0, 0.0, 0.0};
+						if (withIndels) {
+							indelStats = indels.windowStatistics(windowStart, windowSize, fastaAlign);
+						}
+						for (const auto &count : counts) {
+							outStream << position + 1 << "\t" << count;
+							if (masked) {
+								outStream << "\t" << fastaAlign.unmaskedColumns(windowStart, windowSize);
+							}
+							if (withIndels) {
+								outStream << "\t" << indelStats.indels << "\t" << indelStats.meanLength << "\t" << indelStats.meanFrequency;
+							}
+							outStream << "\n";
+						}
+						outStream.flush();
+						// stop when the output is gone, e.g. a closed pipe
+						return outStream.good();
+					}
+				);
+			}
+			outStream.close();
+			if (stringVariables.at("metrics-file") != "unset") {
+				metrics.dumpToFile( stringVariables.at("metrics-file") );
+			}
+			return 0;
+		}
+		std::vector< std::pair< size_t, std::vector<uint32_t> > > result;
+		{
+			BayesicSpace::ScopedTimer scanTimer( metrics.histogram("analyze_alignments_diversity_scan_seconds") );
+			// a shard without windows leaves the table empty
+			if ( !shardMode || (shardColumns > 0) ) {
+				const size_t windowNumber = fastaAlign.alignmentLength() > windowSize ? (fastaAlign.alignmentLength() - windowSize - 1) / stepSize + 1 : 0;
+				const BayesicSpace::WindowPlan windowPlan{fastaAlign.planWindows( windowSize, windowNumber, static_cast<size_t>( intVariables.at("threads") ),
+					BayesicSpace::parseWindowEngine( stringVariables.at("engine") ) )};
+				std::cerr << BayesicSpace::describeWindowPlan(windowPlan) << "\n";
+				metrics.gauge("analyze_alignments_scan_threads") = static_cast<int64_t>(windowPlan.threads);
+				result = fastaAlign.diversityInWindows(windowSize, stepSize, windowPlan);
+			}
+			for (auto &eachWindow : result) {
+				eachWindow.first += shardFirstColumn;
+			}
+		}
+		metrics.counter("analyze_alignments_windows_total") += result.size();
+		std::vector<size_t> unmaskedCounts;
+		if (stringVariables.at("mask-file") != "unset") {
+			unmaskedCounts.reserve( result.size() );
+			for (const auto &eachWindow : result) {
+				unmaskedCounts.push_back( fastaAlign.unmaskedColumns(eachWindow.first, windowSize) );
+			}
+		}
+		std::vector<BayesicSpace::IndelWindowStatistics> indelStatistics;
+		if (withIndels) {
+			BayesicSpace::ScopedTimer indelTimer( metrics.histogram("analyze_alignments_indel_seconds") );
+			indelStatistics.reserve( result.size() );
+			for (const auto &eachWindow : result) {
+				indelStatistics.push_back( indels.windowStatistics(eachWindow.first, windowSize, fastaAlign) );
+			}
+		}
+		if (stringVariables.at("reference-sample") != "unset") {
+			// each window is reported at the first reference sample residue at or after its start
+			const BayesicSpace::CoordinateIndex sampleCoordinates{fastaAlign.coordinateIndex( stringVariables.at("reference-sample") )};
+			for (auto &eachWindow : result) {
+				eachWindow.first = sampleCoordinates.toSequencePosition(eachWindow.first);
+			}
+		}
+		{
+			BayesicSpace::ScopedTimer saveTimer( metrics.histogram("analyze_alignments_save_seconds") );
+			std::fstream outStream;
+			outStream.open(stringVariables.at("out-file"), std::ios::out);
+			if (withIndels) {
+				BayesicSpace::saveDiversityTable(result, unmaskedCounts, indelStatistics, outStream);
+			} else if (stringVariables.at("mask-file") == "unset") {
+				BayesicSpace::saveDiversityTable(result, outStream);
+			} else {
+				BayesicSpace::saveDiversityTable(result, unmaskedCounts, outStream);
+			}
+			outStream.close();
+		}
+		if (stringVariables.at("metrics-file") != "unset") {
+			metrics.dumpToFile( stringVariables.at("metrics-file") );
+		}
 	} catch(std::string &problem) {
 		std::cerr << problem << "\n";
 		std::cerr << cliHelp;
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Merge sharded homozygosity run tables
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Concatenate the outputs of `homoruns --shard` runs into the table a single-process run would produce.
+ *
+ */
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+
+#include "extraFunctions.hpp"
+
+int main(int argc, char *argv[]) {
+	const std::string cliHelp = "Available command line flags (in any order):\n"
+		"  --input-file      comma-separated shard output file names, in shard order (required).\n"
+		"  --out-file        file_name (output file name; required).\n";
+	try {
+		std::unordered_map <std::string, std::string> clInfo;
+		std::unordered_map <std::string, std::string> stringVariables;
+		std::unordered_map <std::string, int> intVariables;
+		BayesicSpace::parseCL(argc, argv, clInfo);
+		BayesicSpace::extractCLinfo(clInfo, intVariables, stringVariables);
+		std::vector<std::string> shardFileNames;
+		std::stringstream fileListStream( stringVariables.at("input-file") );
+		std::string shardFileName;
+		while ( std::getline(fileListStream, shardFileName, ',') ) {
+			if ( !shardFileName.empty() ) {
+				shardFileNames.push_back(shardFileName);
+			}
+		}
+		if ( shardFileNames.empty() ) {
+			throw std::string("ERROR: at least one shard file name is required");
+		}
+		std::fstream outStream;
+		outStream.open(stringVariables.at("out-file"), std::ios::out);
+		BayesicSpace::mergeShardTables(shardFileNames, outStream);
+		outStream.close();
+	} catch(std::string &problem) {
+		std::cerr << problem << "\n";
+		std::cerr << cliHelp;
+		return 1;
+	}
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <utility>
+
+#include "extraFunctions.hpp"
+#include "fastaParser.hpp"
+
+int main(int argc, char *argv[]) {
+	const std::string cliHelp = "Available command line flags (in any order):\n"
+		"  --input-file       file_name (alignment file name; required).\n"
+		"  --new-sequences    file_name (FASTA file with unaligned sequences to add; required).\n"
+		"  --out-file         file_name (output alignment file name; required).\n"
+		"  --placement-report file_name (if set, the numbers of placed, dropped, and clipped residues of each new sequence are saved to this file).\n"
+		"  --threads          number of threads (defaults to 1).\n";
+	try {
+		std::unordered_map <std::string, std::string> clInfo;
+		std::unordered_map <std::string, std::string> stringVariables;
+		std::unordered_map <std::string, int> intVariables;
+		BayesicSpace::parseCL(argc, argv, clInfo);
+		BayesicSpace::extractCLinfo(clInfo, intVariables, stringVariables);
+		if (stringVariables.at("new-sequences") == "unset") {
+			throw std::string("ERROR: new sequence file is required");
+		}
+		if (intVariables.at("threads") <= 0) {
+			throw std::string("ERROR: thread number must be > 0");
+		}
+		BayesicSpace::ParseFASTA fastaAlign( stringVariables.at("input-file") );
+		std::vector< std::pair<std::string, std::string> > newSequences;
+		BayesicSpace::readSequences(stringVariables.at("new-sequences"), newSequences);
+		const auto placements = fastaAlign.placeSequences( newSequences, static_cast<size_t>( intVariables.at("threads") ) );
+		std::fstream outStream;
+		outStream.open(stringVariables.at("out-file"), std::ios::out);
+		BayesicSpace::saveAlignment(fastaAlign, outStream);
+		outStream.close();
+		if (stringVariables.at("placement-report") != "unset") {
+			std::fstream reportStream;
+			reportStream.open(stringVariables.at("placement-report"), std::ios::out);
+			BayesicSpace::savePlacementTable(placements, newSequences, reportStream);
+			reportStream.close();
+		}
+	} catch(std::string &problem) {
+		std::cerr << problem << "\n";
+		std::cerr << cliHelp;
+		return 1;
+	}
+}
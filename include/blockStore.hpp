@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Block-compressed alignment store
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Class definition for a random-access alignment store compressed in column blocks.
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <utility> // for std::pair
+#include <string>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <cstdint>
+
+#include "fastaParser.hpp"
+
+namespace BayesicSpace {
+	class BlockCompressedAlignment;
+
+	/** \brief Block-compressed alignment
+	 *
+	 * The alignment is split into blocks of consecutive columns.
+	 * The column consensus is stored once; within each block, each sequence is run-length coded against it as alternating runs of matching columns (length only) and differing columns (length and residues).
+	 * Run lengths are variable-length integers, so a sequence identical to the consensus takes two bytes per block.
+	 * A block index gives the start of each block, and a small least-recently-used cache holds decompressed blocks, so window extraction decompresses only the blocks it touches.
+	 * Queries are thread safe.
+	 */
+	class BlockCompressedAlignment {
+	public:
+		/** \brief Default constructor */
+		BlockCompressedAlignment() = default;
+		/** \brief Constructor from an alignment
+		 *
+		 * Sequences are stored in the original order of the alignment. Column masks are not stored.
+		 *
+		 * \param[in] alignment alignment to compress
+		 * \param[in] blockSize number of columns per block
+		 * \param[in] cacheBlocks maximal number of decompressed blocks kept in memory
+		 */
+		BlockCompressedAlignment(const ParseFASTA &alignment, const size_t &blockSize, const size_t &cacheBlocks);
+		/** \brief Constructor from a FASTA file
+		 *
+		 * The file is streamed one record at a time, twice: the first pass counts residues to build the consensus, the second compresses each sequence against it.
+		 * The uncompressed alignment is never held in memory.
+		 *
+		 * \param[in] fastaFileName FASTA file name
+		 * \param[in] blockSize number of columns per block
+		 * \param[in] cacheBlocks maximal number of decompressed blocks kept in memory
+		 */
+		BlockCompressedAlignment(const std::string &fastaFileName, const size_t &blockSize, const size_t &cacheBlocks);
+		/** \brief Copy constructor (deleted) */
+		BlockCompressedAlignment(const BlockCompressedAlignment &toCopy) = delete;
+		/** \brief Move constructor (deleted) */
+		BlockCompressedAlignment(BlockCompressedAlignment &&toMove) = delete;
+		/** \brief Copy assignment operator (deleted) */
+		BlockCompressedAlignment& operator=(const BlockCompressedAlignment &toCopy) = delete;
+		/** \brief Move assignment operator (deleted) */
+		BlockCompressedAlignment& operator=(BlockCompressedAlignment &&toMove) = delete;
+		/** \brief Destructor */
+		~BlockCompressedAlignment() = default;
+		/** \brief Number of sequences
+		 *
+		 * \return number of sequences
+		 */
+		size_t sequenceNumber() const noexcept { return headers_.size(); };
+		/** \brief Number of alignment columns
+		 *
+		 * \return number of columns
+		 */
+		size_t alignmentLength() const noexcept { return alignmentLength_; };
+		/** \brief Number of blocks
+		 *
+		 * \return number of column blocks
+		 */
+		size_t blockNumber() const noexcept { return blockOffsets_.empty() ? 0 : blockOffsets_.size() - 1; };
+		/** \brief Compressed size
+		 *
+		 * \return number of bytes of compressed residues, including the consensus
+		 */
+		size_t compressedBytes() const noexcept { return compressedBlocks_.size() + consensus_.size(); };
+		/** \brief Sequence header
+		 *
+		 * \param[in] sequenceIdx sequence index
+		 * \return FASTA header without the leading '>'
+		 */
+		const std::string& header(const size_t &sequenceIdx) const { return headers_.at(sequenceIdx); };
+		/** \brief Window of one sequence
+		 *
+		 * \param[in] sequenceIdx sequence index
+		 * \param[in] windowStartPosition first column
+		 * \param[in] windowSize number of columns (truncated at the alignment end)
+		 * \return aligned residues in the window
+		 */
+		std::string window(const size_t &sequenceIdx, const size_t &windowStartPosition, const size_t &windowSize) const;
+		/** \brief Extract unique sequences in a window
+		 *
+		 * Same as `ParseFASTA::extractWindow` on an unmasked alignment.
+		 *
+		 * \param[in] windowStartPosition first column
+		 * \param[in] windowSize number of columns (truncated at the alignment end)
+		 * \return unique window sequences and their counts
+		 */
+		std::unordered_map<std::string, uint32_t> extractWindow(const size_t &windowStartPosition, const size_t &windowSize) const;
+		/** \brief Extract unique sequences in a window, sorted
+		 *
+		 * Sorted by count, descending, with ties in sequence order, as `ParseFASTA::extractWindowSorted`.
+		 *
+		 * \param[in] windowStartPosition first column
+		 * \param[in] windowSize number of columns (truncated at the alignment end)
+		 * \return unique window sequences and their counts
+		 */
+		std::vector< std::pair<std::string, uint32_t> > extractWindowSorted(const size_t &windowStartPosition, const size_t &windowSize) const;
+		/** \brief Consensus in a window
+		 *
+		 * The most common of A, C, G, T, N (either case) and gap in each column, with ties going to the first in that order; N if a column has none of them.
+		 *
+		 * \param[in] windowStartPosition first column
+		 * \param[in] windowSize number of columns (truncated at the alignment end)
+		 * \return consensus residues
+		 */
+		std::string consensusWindow(const size_t &windowStartPosition, const size_t &windowSize) const;
+	private:
+		/** \brief Sequence headers */
+		std::vector<std::string> headers_;
+		/** \brief Column consensus, also the reference each block is coded against */
+		std::string consensus_;
+		/** \brief Compressed blocks, one after another */
+		std::vector<uint8_t> compressedBlocks_;
+		/** \brief Start of each block in `compressedBlocks_`, with the end as the last element */
+		std::vector<size_t> blockOffsets_;
+		/** \brief Number of alignment columns */
+		size_t alignmentLength_{0};
+		/** \brief Number of columns per block */
+		size_t blockSize_{0};
+		/** \brief Maximal number of cached blocks */
+		size_t cacheBlocks_{0};
+		/** \brief Decompressed block cache
+		 *
+		 * Pairs of block indexes and blocks (sequences one after another), most recently used first.
+		 */
+		mutable std::vector< std::pair< size_t, std::shared_ptr<const std::string> > > blockCache_;
+		/** \brief Cache mutex */
+		mutable std::mutex cacheMutex_;
+		/** \brief Get a decompressed block
+		 *
+		 * \param[in] blockIdx block index
+		 * \return decompressed block, kept valid after eviction from the cache
+		 */
+		std::shared_ptr<const std::string> block_(const size_t &blockIdx) const;
+		/** \brief Decompress a block
+		 *
+		 * \param[in] blockIdx block index
+		 * \return block residues, sequences one after another
+		 */
+		std::string decompressBlock_(const size_t &blockIdx) const;
+		/** \brief Compress a sequence
+		 *
+		 * Appends the sequence runs of each block to that block's bytes.
+		 *
+		 * \param[in] sequence aligned sequence
+		 * \param[in,out] blockBytes compressed sequences of each block
+		 */
+		void encodeSequence_(const std::string &sequence, std::vector< std::vector<uint8_t> > &blockBytes) const;
+		/** \brief Lay out the compressed blocks
+		 *
+		 * Copies the compressed sequences of each block, in block order, into one byte store and builds the block index. The consensus is kept once for the whole alignment, not per block. The per-block bytes are released as they are copied.
+		 *
+		 * \param[in,out] blockBytes compressed sequences of each block
+		 */
+		void storeBlocks_(std::vector< std::vector<uint8_t> > &blockBytes);
+		/** \brief Columns in a block
+		 *
+		 * \param[in] blockIdx block index
+		 * \return number of columns (the last block may be short)
+		 */
+		size_t blockWidth_(const size_t &blockIdx) const noexcept { return std::min(blockSize_, alignmentLength_ - blockIdx * blockSize_); };
+	};
+}
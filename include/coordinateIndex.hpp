@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Alignment to sequence coordinate conversion
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Class definition for a rank/select index that converts between alignment columns and ungapped sequence positions.
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace BayesicSpace {
+	class CoordinateIndex;
+
+	/** \brief Coordinate index
+	 *
+	 * Converts between alignment columns and ungapped positions of one aligned sequence.
+	 * Non-gap columns are marked in a bit vector with a cumulative count per 64-bit word (rank) and the word position of every 256th residue (sampled select).
+	 * Where 256 residues span more than 128 words, the columns of all of them are also stored, so locating a residue never searches more than 128 words.
+	 * The index takes about 1.5 bits per alignment column, and less than one more bit per column in gap-rich regions.
+	 * All positions are base-0.
+	 */
+	class CoordinateIndex {
+	public:
+		/** \brief Default constructor */
+		CoordinateIndex() = default;
+		/** \brief Constructor from an aligned sequence
+		 *
+		 * \param[in] alignedSequence sequence with gaps ('-')
+		 */
+		CoordinateIndex(const std::string &alignedSequence);
+		/** \brief Copy constructor
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		CoordinateIndex(const CoordinateIndex &toCopy) = default;
+		/** \brief Move constructor
+		 *
+		 * \param[in] toMove object to move
+		 */
+		CoordinateIndex(CoordinateIndex &&toMove) noexcept = default;
+		/** \brief Copy assignment operator
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		CoordinateIndex& operator=(const CoordinateIndex &toCopy) = default;
+		/** \brief Move assignment operator
+		 *
+		 * \param[in] toMove object to move
+		 */
+		CoordinateIndex& operator=(CoordinateIndex &&toMove) noexcept = default;
+		/** \brief Destructor */
+		~CoordinateIndex() = default;
+		/** \brief Number of alignment columns
+		 *
+		 * \return number of columns
+		 */
+		size_t alignmentLength() const noexcept { return alignmentLength_; };
+		/** \brief Number of non-gap residues
+		 *
+		 * \return ungapped sequence length
+		 */
+		size_t sequenceLength() const noexcept { return sequenceLength_; };
+		/** \brief Number of residues before a column
+		 *
+		 * Gives the ungapped position of the residue in the column, or of the next residue if the column is a gap.
+		 *
+		 * \param[in] alignmentColumn alignment column, must not exceed the alignment length
+		 * \return number of non-gap residues in columns before `alignmentColumn`
+		 */
+		size_t toSequencePosition(const size_t &alignmentColumn) const;
+		/** \brief Alignment column of a residue
+		 *
+		 * \param[in] sequencePosition ungapped residue position, must be less than the sequence length
+		 * \return alignment column of the residue
+		 */
+		size_t toAlignmentColumn(const size_t &sequencePosition) const;
+		/** \brief Is the column a gap
+		 *
+		 * \param[in] alignmentColumn alignment column
+		 * \return `true` if the sequence has a gap in the column
+		 */
+		bool isGap(const size_t &alignmentColumn) const;
+	private:
+		/** \brief Non-gap column bits */
+		std::vector<uint64_t> residueBits_;
+		/** \brief Number of residues before each word */
+		std::vector<uint32_t> wordRanks_;
+		/** \brief Word containing every `selectSampleRate_`-th residue */
+		std::vector<uint32_t> selectSamples_;
+		/** \brief Start of each sparse sample's columns in `sparseColumns_`; `denseSample_` for samples searched in the bit vector */
+		std::vector<uint32_t> sparseStarts_;
+		/** \brief Column of each residue in sparse samples, relative to the first column of the sample's word */
+		std::vector<uint32_t> sparseColumns_;
+		/** \brief Number of alignment columns */
+		size_t alignmentLength_{0};
+		/** \brief Number of residues */
+		size_t sequenceLength_{0};
+		/** \brief Residue sampling rate for select */
+		static constexpr size_t selectSampleRate_{256};
+		/** \brief Bits per word */
+		static constexpr size_t wordSize_{64};
+		/** \brief Maximal number of words between select samples searched in the bit vector */
+		static constexpr size_t maxSearchWords_{128};
+		/** \brief Marks a select sample searched in the bit vector */
+		static constexpr uint32_t denseSample_{UINT32_MAX};
+	};
+}
@@ -37,6 +37,10 @@
 #include <fstream>
 
 #include "fastaParser.hpp"
+#include "fmIndex.hpp"
+#include "inSilicoPCR.hpp"
+#include "featureIndex.hpp"
+#include "indelIndex.hpp"
 
 namespace BayesicSpace {
 	/** \brief Command line parser
@@ -67,6 +71,35 @@ namespace BayesicSpace {
 	 * \param[in,out] outFile output file stream
 	 */
 	void saveDiversityTable(const std::vector< std::pair< size_t, std::vector<uint32_t> > > &diversityTable, std::fstream &outFile);
+	/** \brief Save the diversity table with unmasked column counts
+	 *
+	 * Save the diversity table of a masked alignment. The output file will have three columns: 
+	 *     (1) window start position (repeated for every unique sequence).
+	 *     (2) number of unique sequence occurrences.
+	 *     (3) number of unmasked columns in the window.
+	 * 
+	 * \param[in] diversityTable the diversity table data
+	 * \param[in] unmaskedCounts number of unmasked columns in each window
+	 * \param[in,out] outFile output file stream
+	 */
+	void saveDiversityTable(const std::vector< std::pair< size_t, std::vector<uint32_t> > > &diversityTable, const std::vector<size_t> &unmaskedCounts, std::fstream &outFile);
+	/** \brief Save the diversity table with indel statistics
+	 *
+	 * Save the diversity table with per-window indel columns. The output file will have these columns:
+	 *     (1) window start position (repeated for every unique sequence).
+	 *     (2) number of unique sequence occurrences.
+	 *     (3) number of unmasked columns in the window, only if `unmaskedCounts` is not empty.
+	 *     (4) number of distinct indel events starting in the window.
+	 *     (5) their mean length.
+	 *     (6) their mean frequency.
+	 * 
+	 * \param[in] diversityTable the diversity table data
+	 * \param[in] unmaskedCounts number of unmasked columns in each window; empty if the alignment is not masked
+	 * \param[in] indelStatistics indel statistics of each window
+	 * \param[in,out] outFile output file stream
+	 */
+	void saveDiversityTable(const std::vector< std::pair< size_t, std::vector<uint32_t> > > &diversityTable, const std::vector<size_t> &unmaskedCounts,
+							const std::vector<IndelWindowStatistics> &indelStatistics, std::fstream &outFile);
 	/** \brief Save unique sequences 
 	 *
 	 * Save unique sequences in an alignment window.
@@ -135,4 +168,209 @@ namespace BayesicSpace {
 	void saveUniqueSequences(const std::vector< std::pair<std::string, uint32_t> > &uniqueSequences, const std::string &consensus,
 								const AlignmentStatistics &alignStats, const std::string &query,
 								const std::string &fileType, std::fstream &outFile);
+	/** \brief Save compact haplotypes
+	 *
+	 * Save unique sequences restricted to the polymorphic columns of a window, as returned by `ParseFASTA::extractPolymorphicWindow`.
+	 * The first line starts with '#' and lists the base-1 alignment positions of the columns, separated by commas.
+	 * If the reference sample coordinate index is not empty, positions are base-1 positions in the reference sample instead; a column where the sample has a gap is given as the position of the preceding residue followed by '+'.
+	 * The consensus residues at these columns follow on a line marked by "C", then each haplotype and its count, separated by a tab.
+	 * Residues that are the same as the consensus are displayed as '.', the different residues are shown.
+	 *
+	 * \param[in] haplotypes compact haplotypes and their counts
+	 * \param[in] columns polymorphic column indexes
+	 * \param[in] consensus consensus residues at the polymorphic columns
+	 * \param[in] sampleCoordinates coordinate index of the reference sample; empty for alignment positions
+	 * \param[in,out] outFile output stream
+	 */
+	void savePolymorphicHaplotypes(const std::vector< std::pair<std::string, uint32_t> > &haplotypes, const std::vector<size_t> &columns, const std::string &consensus,
+									const CoordinateIndex &sampleCoordinates, std::fstream &outFile);
+	/** \brief Save compact haplotypes of a query match
+	 *
+	 * As the version without a query, but the query sequence is on the top line, marked by "Q", and the consensus line is marked by "C" followed by the window start and length, with a "|" delimiter, as in the TAB format of `saveUniqueSequences`.
+	 *
+	 * \param[in] haplotypes compact haplotypes and their counts
+	 * \param[in] columns polymorphic column indexes
+	 * \param[in] consensus consensus residues at the polymorphic columns
+	 * \param[in] sampleCoordinates coordinate index of the reference sample; empty for alignment positions
+	 * \param[in] alignStats alignment statistics
+	 * \param[in] query query sequence
+	 * \param[in,out] outFile output stream
+	 */
+	void savePolymorphicHaplotypes(const std::vector< std::pair<std::string, uint32_t> > &haplotypes, const std::vector<size_t> &columns, const std::string &consensus,
+									const CoordinateIndex &sampleCoordinates, const AlignmentStatistics &alignStats, const std::string &query, std::fstream &outFile);
+	/** \brief Extract and save the compact haplotypes of a window
+	 *
+	 * Extracts the polymorphic columns of the window following the plan and saves them with `savePolymorphicHaplotypes`.
+	 *
+	 * \param[in] alignment the alignment
+	 * \param[in] windowStartPosition window start
+	 * \param[in] windowSize window size in base pairs
+	 * \param[in] plan window analysis plan
+	 * \param[in] sorted if `true`, haplotypes are sorted as in `ParseFASTA::extractWindowSorted`
+	 * \param[in] sampleCoordinates coordinate index of the reference sample; empty for alignment positions
+	 * \param[in,out] outFile output stream
+	 */
+	void savePolymorphicWindow(const ParseFASTA &alignment, const size_t &windowStartPosition, const size_t &windowSize, const WindowPlan &plan, const bool &sorted,
+								const CoordinateIndex &sampleCoordinates, std::fstream &outFile);
+	/** \brief Extract and save the compact haplotypes of a query match
+	 *
+	 * As the version without a query, with the query and reported match window saved as well.
+	 *
+	 * \param[in] alignment the alignment
+	 * \param[in] windowStartPosition window start
+	 * \param[in] windowSize window size in base pairs
+	 * \param[in] alignStats query alignment statistics, as reported
+	 * \param[in] query query sequence
+	 * \param[in] plan window analysis plan
+	 * \param[in] sorted if `true`, haplotypes are sorted as in `ParseFASTA::extractWindowSorted`
+	 * \param[in] sampleCoordinates coordinate index of the reference sample; empty for alignment positions
+	 * \param[in,out] outFile output stream
+	 */
+	void savePolymorphicWindow(const ParseFASTA &alignment, const size_t &windowStartPosition, const size_t &windowSize, const AlignmentStatistics &alignStats,
+								const std::string &query, const WindowPlan &plan, const bool &sorted, const CoordinateIndex &sampleCoordinates, std::fstream &outFile);
+	/** \brief Save motif hits
+	 *
+	 * Save exact motif matches, one per line, in a tab-delimited file with a header line.
+	 * The columns are the sequence FASTA header, the base-1 position in the gap-stripped sequence, and the base-1 alignment position.
+	 *
+	 * \param[in] motifHits motif matches
+	 * \param[in] alignment the alignment that was searched
+	 * \param[in,out] outFile output stream
+	 */
+	void saveMotifHits(const std::vector<MotifHit> &motifHits, const ParseFASTA &alignment, std::fstream &outFile);
+	/** \brief Save in-silico PCR results
+	 *
+	 * Save per-sequence primer binding results in a tab-delimited file with a header line.
+	 * The columns are the sequence FASTA header, forward primer position and mismatches, reverse primer position and mismatches, product length, and the alignment positions of the first and last product residues.
+	 * Primer positions are base-1 in the gap-stripped sequence, alignment positions are base-1.
+	 * Sequences that do not amplify have NA in all but the header column.
+	 *
+	 * \param[in] pcrResults per-sequence PCR results
+	 * \param[in] alignment the alignment that was amplified
+	 * \param[in,out] outFile output stream
+	 */
+	void savePCRresults(const std::vector<AmpliconResult> &pcrResults, const ParseFASTA &alignment, std::fstream &outFile);
+	/** \brief Save conserved regions
+	 *
+	 * Save conserved regions in rank order.
+	 * Each region starts with a line beginning with '#' that lists its base-1 start position, length, number of variable sites, and consensus GC content.
+	 * The unique sequences in the region follow, sorted and formatted as in `saveUniqueSequences`.
+	 *
+	 * \param[in] regions ranked conserved regions
+	 * \param[in] alignment the alignment the regions are from
+	 * \param[in] fileType TAB or FASTA, otherwise throws
+	 * \param[in,out] outFile output stream
+	 */
+	void saveConservedRegions(const std::vector<ConservedRegion> &regions, const ParseFASTA &alignment, const std::string &fileType, std::fstream &outFile);
+	/** \brief Read sequences from a FASTA file
+	 *
+	 * Reads all records without checking sequence lengths, so the sequences need not be aligned.
+	 *
+	 * \param[in] fastaFileName FASTA file name
+	 * \param[out] sequences pairs of headers (without the leading '>') and sequences
+	 */
+	void readSequences(const std::string &fastaFileName, std::vector< std::pair<std::string, std::string> > &sequences);
+	/** \brief Save an alignment
+	 *
+	 * Save all aligned sequences in FASTA format, one line per sequence.
+	 *
+	 * \param[in] alignment sequence alignment
+	 * \param[in,out] outFile output stream
+	 */
+	void saveAlignment(const ParseFASTA &alignment, std::fstream &outFile);
+	/** \brief Save placement statistics
+	 *
+	 * Save a tab-delimited table with a header line.
+	 * Each row has the sequence header and the numbers of placed, dropped (insertion), and clipped residues.
+	 *
+	 * \param[in] placements placement statistics
+	 * \param[in] newSequences placed sequences, in the same order
+	 * \param[in,out] outFile output stream
+	 */
+	void savePlacementTable(const std::vector<PlacementStatistics> &placements, const std::vector< std::pair<std::string, std::string> > &newSequences, std::fstream &outFile);
+	/** \brief Read a BED file
+	 *
+	 * Reads the start and end of each interval; other columns are ignored, as are comment, track, and browser lines.
+	 *
+	 * \param[in] bedFileName BED file name
+	 * \param[out] intervals half-open base-0 intervals
+	 */
+	void readBED(const std::string &bedFileName, std::vector< std::pair<size_t, size_t> > &intervals);
+	/** \brief Mask alignment columns from a BED file
+	 *
+	 * Intervals are in alignment columns, or in the ungapped coordinates of a reference sample if one is named.
+	 *
+	 * \param[in] bedFileName BED file name
+	 * \param[in] referenceSample reference sample header, or "unset" for alignment columns
+	 * \param[in,out] alignment alignment to mask
+	 */
+	void applyBEDmask(const std::string &bedFileName, const std::string &referenceSample, ParseFASTA &alignment);
+	/** \brief Read annotation features
+	 *
+	 * Reads a GFF or GTF file (recognized by the .gff, .gff3, or .gtf extension) or a BED file.
+	 * GFF feature names are taken from the ID, Name, or gene_id attribute; BED names from the fourth column.
+	 * Features without a name are named by type and position.
+	 *
+	 * \param[in] featureFileName annotation file name
+	 * \param[in] featureType only features of this type (GFF column 3) are kept; "unset" keeps all
+	 * \param[out] features features as half-open base-0 intervals
+	 */
+	void readFeatures(const std::string &featureFileName, const std::string &featureType, std::vector<GenomicFeature> &features);
+	/** \brief Save per-feature statistics
+	 *
+	 * Save a tab-delimited table with a header line.
+	 * Each row has the feature name and type, its base-1 first and last alignment positions, and the number of unmasked columns, variable sites, unique sequences, and nucleotide diversity.
+	 *
+	 * \param[in] featureStats per-feature statistics
+	 * \param[in] features feature index the statistics refer to
+	 * \param[in,out] outFile output stream
+	 */
+	void saveFeatureStatistics(const std::vector<FeatureStatistics> &featureStats, const FeatureIndex &features, std::fstream &outFile);
+	/** \brief Parse a window engine name
+	 *
+	 * \param[in] engineName `auto`, `hash`, `projection`, `packed`, or `prefix-hash`
+	 * \return window engine
+	 */
+	WindowEngine parseWindowEngine(const std::string &engineName);
+	/** \brief Describe a window analysis plan
+	 *
+	 * \param[in] plan window analysis plan
+	 * \return one-line description of the engine, threads, and sampled statistics
+	 */
+	std::string describeWindowPlan(const WindowPlan &plan);
+	/** \brief Parse a shard specification
+	 *
+	 * \param[in] shardSpecification shard as `i/N`, with base-1 `i` not larger than `N`
+	 * \param[out] shardIdx base-1 shard index
+	 * \param[out] shardNumber number of shards
+	 */
+	void parseShard(const std::string &shardSpecification, size_t &shardIdx, size_t &shardNumber);
+	/** \brief Parse a region specification
+	 *
+	 * \param[in] regionSpecification region as `start-end`, base-1 and inclusive, with `start` not larger than `end`
+	 * \return half-open base-0 interval
+	 */
+	std::pair<size_t, size_t> parseRegion(const std::string &regionSpecification);
+	/** \brief Alignment columns of a shard
+	 *
+	 * Windows of a whole-alignment diversity scan are split into consecutive, nearly equal blocks, one per shard.
+	 * Scanning the returned columns with the same window and step sizes yields exactly the windows of the shard.
+	 *
+	 * \param[in] shardIdx base-1 shard index
+	 * \param[in] shardNumber number of shards
+	 * \param[in] alignmentLength number of alignment columns
+	 * \param[in] windowSize window size
+	 * \param[in] stepSize step size
+	 * \return first column and number of columns; zero columns if the shard has no windows
+	 */
+	std::pair<size_t, size_t> shardColumnRange(const size_t &shardIdx, const size_t &shardNumber, const size_t &alignmentLength, const size_t &windowSize, const size_t &stepSize);
+	/** \brief Merge shard tables
+	 *
+	 * Concatenates tab-delimited shard outputs in the given order, keeping one header line.
+	 * Header lines must match.
+	 *
+	 * \param[in] shardFileNames shard output file names in shard order
+	 * \param[in,out] outFile output stream
+	 */
+	void mergeShardTables(const std::vector<std::string> &shardFileNames, std::fstream &outFile);
 }
@@ -33,12 +33,76 @@
 #include <unordered_map>
 #include <utility> // for std::pair
 #include <string>
+#include <array>
 #include <iterator>
+#include <functional>
 #include <cstdint>
 
+#include "coordinateIndex.hpp"
+
 namespace BayesicSpace {
 	struct AlignmentStatistics;
+	struct ConservedRegion;
+	struct PlacementStatistics;
+	struct FastaIndexRecord;
+	struct WindowPlan;
 	class ParseFASTA;
+	class QueryCache;
+
+	/** \brief Nucleotide set of an IUPAC code
+	 *
+	 * Bit mask of the nucleotides an IUPAC code can stand for: A is 1, C is 2, G is 4, T (or U) is 8.
+	 * Case-insensitive; N, '?', and unrecognized characters give all four nucleotides, gaps give 0.
+	 *
+	 * \param[in] residue IUPAC nucleotide code
+	 * \return nucleotide bit mask
+	 */
+	uint8_t iupacMask(const char &residue) noexcept;
+	/** \brief Order of sorted window tables
+	 *
+	 * Counts descending, ties by sequence, so that sorted output does not depend on hash table order.
+	 *
+	 * \param[in] first first window and count
+	 * \param[in] second second window and count
+	 * \return `true` if `first` goes before `second`
+	 */
+	bool byCountThenSequence(const std::pair<std::string, uint32_t> &first, const std::pair<std::string, uint32_t> &second) noexcept;
+
+	/** \brief FASTA index record
+	 *
+	 * Location of one sequence in a FASTA file, as in a samtools .fai index.
+	 * All sequence lines except the last must have the same length.
+	 */
+	struct FastaIndexRecord {
+		/** \brief Sequence name */
+		std::string name;
+		/** \brief Number of residues */
+		size_t length;
+		/** \brief Byte offset of the first residue */
+		size_t offset;
+		/** \brief Residues per line */
+		size_t lineBases;
+		/** \brief Bytes per line, including the line break */
+		size_t lineBytes;
+	};
+	/** \brief Index a FASTA file
+	 *
+	 * Reads the samtools index `fastaFileName.fai` if it exists (names are then the first words of the headers).
+	 * Otherwise the file is scanned once without storing sequences (names are complete headers).
+	 *
+	 * \param[in] fastaFileName FASTA file name
+	 * \return one record per sequence, in file order
+	 */
+	std::vector<FastaIndexRecord> indexFASTA(const std::string &fastaFileName);
+	/** \brief Stream the records of a FASTA file
+	 *
+	 * Reads one record at a time and passes its header (without the '>' and leading spaces) and sequence (lines joined) to the callback.
+	 * Empty lines are skipped.
+	 *
+	 * \param[in] fastaFileName FASTA file name
+	 * \param[in] processRecord function taking the header and the sequence; both may be moved from
+	 */
+	void readFASTA(const std::string &fastaFileName, const std::function<void(std::string &&, std::string &&)> &processRecord);
 
 	/** \brief Collection of alignment statistics 
 	 *
@@ -50,6 +114,57 @@ namespace BayesicSpace {
 		size_t queryStart;
 		size_t queryLength;
 	};
+	/** \brief Conserved alignment region
+	 *
+	 * Alignment window with few variable sites, described by its base-0 start column and length.
+	 */
+	struct ConservedRegion {
+		size_t start;
+		size_t length;
+		uint32_t variableSites;
+		double gcContent;
+	};
+	/** \brief Placement statistics
+	 *
+	 * Describes how an unaligned sequence was placed into an alignment.
+	 * Placed residues are in alignment columns, dropped residues are insertions relative to the consensus, and clipped residues are unaligned sequence ends.
+	 */
+	struct PlacementStatistics {
+		size_t placedResidues;
+		size_t droppedInsertions;
+		size_t clippedResidues;
+	};
+	/** \brief Window counting engine
+	 *
+	 * `hash` counts whole window strings.
+	 * `projection` counts the residues at polymorphic columns only and rebuilds whole windows for the distinct sequences; the counts are the same.
+	 * `packed` is `projection` with up to 64 polymorphic columns packed two bits per residue into one or two 64-bit integer keys, so that no strings are built until the distinct keys are known.
+	 * Sequences with other than A, C, G, or T at these columns, and windows with more polymorphic columns, are projected to strings.
+	 * `prefixHash` groups windows by hashes computed from a prefix-hash index (see `ParseFASTA::buildPrefixHashIndex`), at a cost that does not grow with window length.
+	 * `automatic` lets the planner choose.
+	 */
+	enum class WindowEngine : uint8_t {
+		automatic,
+		hash,
+		projection,
+		packed,
+		prefixHash
+	};
+	/** \brief Window analysis plan
+	 *
+	 * Engine and thread layout chosen by `ParseFASTA::planWindows`, with the sampled statistics the choice was based on.
+	 * Threads are spread across windows in diversity scans and across sequences within a window in window extraction.
+	 */
+	struct WindowPlan {
+		/** \brief Counting engine (never `automatic`) */
+		WindowEngine engine;
+		/** \brief Number of threads */
+		size_t threads;
+		/** \brief Fraction of sampled unmasked columns that are polymorphic */
+		double polymorphicFraction;
+		/** \brief Fraction of sampled window sequences that duplicate another */
+		double duplicationRate;
+	};
 	/** \brief FASTA alignment parser
 	 *
 	 * Reads a FASTA alignment file, separates the sequences and headers, and provides analysis methods.
@@ -67,6 +182,18 @@ namespace BayesicSpace {
 		 * \param[in] fastaFileName input FASTA file name
 		 */
 		ParseFASTA(const std::string &fastaFileName);
+		/** \brief Constructor reading a column range
+		 *
+		 * Reads only the residues in the column range, seeking to them with the FASTA index.
+		 * Column 0 of the object is column `firstColumn` of the file alignment.
+		 * Headers are read from the FASTA file, so they are complete even if the index names come from a samtools .fai file.
+		 *
+		 * \param[in] fastaFileName name of the FASTA file
+		 * \param[in] fastaIndex index of the file
+		 * \param[in] firstColumn first column to read
+		 * \param[in] nColumns number of columns to read
+		 */
+		ParseFASTA(const std::string &fastaFileName, const std::vector<FastaIndexRecord> &fastaIndex, const size_t &firstColumn, const size_t &nColumns);
 		/** \brief Copy constructor 
 		 *
 		 * \param[in] toCopy object to copy
@@ -99,9 +226,128 @@ namespace BayesicSpace {
 		 * \return alignment length
 		 */
 		size_t alignmentLength() const {return fastaAlignment_.at(0).second.size(); };
+		/** \brief Sequence header
+		 *
+		 * \param[in] sequenceIdx sequence index
+		 * \return FASTA header without the leading '>'
+		 */
+		const std::string& header(const size_t &sequenceIdx) const {return fastaAlignment_.at( this->storageIdx_(sequenceIdx) ).first; };
+		/** \brief Aligned sequence
+		 *
+		 * \param[in] sequenceIdx sequence index
+		 * \return sequence, including gaps
+		 */
+		const std::string& sequence(const size_t &sequenceIdx) const {return fastaAlignment_.at( this->storageIdx_(sequenceIdx) ).second; };
+		/** \brief Index of a sequence
+		 *
+		 * \param[in] sequenceHeader FASTA header without the leading '>'
+		 * \return index of the first sequence with this header
+		 */
+		size_t sequenceIndex(const std::string &sequenceHeader) const;
+		/** \brief Coordinate index of a sequence
+		 *
+		 * Builds a rank/select index that converts between alignment columns and the ungapped coordinates of the named sequence, e.g. a reference genome.
+		 *
+		 * \param[in] sequenceHeader FASTA header without the leading '>'
+		 * \return coordinate index of the first sequence with this header
+		 */
+		CoordinateIndex coordinateIndex(const std::string &sequenceHeader) const;
+		/** \brief Mask alignment columns
+		 *
+		 * Masked columns (e.g., repeats or low-quality regions) are skipped by window extraction and diversity scans.
+		 * Their consensus is N and they are never variable.
+		 * Masks accumulate over calls.
+		 *
+		 * \param[in] maskedIntervals half-open base-0 column intervals to mask
+		 */
+		void maskColumns(const std::vector< std::pair<size_t, size_t> > &maskedIntervals);
+		/** \brief Number of unmasked columns
+		 *
+		 * \param[in] startIdx first column
+		 * \param[in] windowLength number of columns (truncated at the alignment end)
+		 * \return number of unmasked columns in the window
+		 */
+		size_t unmaskedColumns(const size_t &startIdx, const size_t &windowLength) const;
+		/** \brief Number of missing residues in a window
+		 *
+		 * Missing residues are N, other ambiguity codes, and gaps; masked columns are not counted.
+		 * Counted a 64-bit word at a time from per-sequence missing data bits built at load.
+		 *
+		 * \param[in] sequenceIdx sequence index
+		 * \param[in] startIdx first column
+		 * \param[in] windowLength number of columns (truncated at the alignment end)
+		 * \return number of missing unmasked columns
+		 */
+		size_t missingColumns(const size_t &sequenceIdx, const size_t &startIdx, const size_t &windowLength) const;
+		/** \brief Filter sequences by missing data
+		 *
+		 * Window extraction and diversity scans then leave out, in each window, the sequences with a larger fraction of missing unmasked columns.
+		 * A threshold of 1 keeps all sequences.
+		 *
+		 * \param[in] maxMissingFraction maximal fraction of missing residues, between 0 and 1
+		 */
+		void filterMissing(const double &maxMissingFraction);
+		/** \brief Group compatible window sequences
+		 *
+		 * When set, window extraction and diversity scans merge window sequences that agree at all positions where neither is missing.
+		 * Residues are bit masks of allowed states (A, C, G, T, gap): N allows all, other ambiguity codes the nucleotides they stand for.
+		 * Windows are assigned, most complete first, to the largest compatible group, whose allowed states are narrowed to those shared by all members.
+		 * Each group is reported as its resolved sequence, with IUPAC codes at positions still ambiguous.
+		 *
+		 * \param[in] groupCompatible `true` to merge compatible windows
+		 */
+		void groupCompatible(const bool &groupCompatible) noexcept;
+		/** \brief Select samples
+		 *
+		 * Window extraction and diversity scans then use only the selected sequences.
+		 * Bits are in sequence index order, as produced by `SampleTable::select`; sequences placed later are selected.
+		 * An empty vector selects all sequences.
+		 *
+		 * \param[in] sampleBits selected sequence bits, one per sequence in 64-bit words
+		 */
+		void selectSamples(const std::vector<uint64_t> &sampleBits);
+		/** \brief Is a sequence used in a window
+		 *
+		 * A sequence is used if it is selected (see `selectSamples`) and does not have too much missing data in the window (see `filterMissing`).
+		 *
+		 * \param[in] sequenceIdx sequence index
+		 * \param[in] startIdx first column
+		 * \param[in] windowLength number of columns (truncated at the alignment end)
+		 * \return `true` if window extraction and diversity scans use the sequence in this window
+		 */
+		bool usesSequence(const size_t &sequenceIdx, const size_t &startIdx, const size_t &windowLength) const { return !this->isExcluded_(this->storageIdx_(sequenceIdx), startIdx, windowLength); };
+		/** \brief Number of variable sites in a window
+		 *
+		 * Counted a 64-bit word at a time from the variable column bits.
+		 *
+		 * \param[in] startIdx first column
+		 * \param[in] windowLength number of columns (truncated at the alignment end)
+		 * \return number of variable columns in the window
+		 */
+		uint32_t variableSiteNumber(const size_t &startIdx, const size_t &windowLength) const;
+		/** \brief Nucleotide diversity in a window
+		 *
+		 * Average number of pairwise differences per unmasked column (\f$ \pi \f$).
+		 * Per-column expected heterozygosity among A, C, G, and T residues (with the \f$ n/(n-1) \f$ correction) is stored as a prefix sum when the consensus is built, so any window takes constant time.
+		 *
+		 * \param[in] startIdx first column
+		 * \param[in] windowLength number of columns (truncated at the alignment end)
+		 * \return nucleotide diversity, 0 if all columns are masked
+		 */
+		double nucleotideDiversity(const size_t &startIdx, const size_t &windowLength) const;
+		/** \brief Is the column variable
+		 *
+		 * A column is variable if it has more than one state among A, C, G, T (case-insensitive), and gap.
+		 * Ambiguous and missing residues are ignored.
+		 *
+		 * \param[in] alignmentColumn alignment column
+		 * \return `true` if the column is variable
+		 */
+		bool isVariable(const size_t &alignmentColumn) const;
 		/** \brief Extract a consensus region 
 		 *
 		 * Extract a window of the consensus sequence.
+		 * Masked columns are skipped.
 		 *
 		 * \param[in] startIdx index of the window start
 		 * \param[in] windowLength number of nucleotides in the window
@@ -111,16 +357,35 @@ namespace BayesicSpace {
 		 *
 		 * Calculate the number of different sequences in window sliding along a sequence alignment.
 		 * Reports the number of times each unique sequence occurs by window position.
+		 * Masked columns are skipped, so windows are compared on their unmasked columns only.
 		 *
 		 * \param[in] windowSize window size in base pairs
 		 * \param[in] stepSize window movement steps in base pairs
 		 * \return vector of pairs that contain window start positions and unique sequence counts
 		 */
 		std::vector< std::pair< size_t, std::vector<uint32_t> > > diversityInWindows(const size_t &windowSize, const size_t &stepSize) const;
+		/** \brief Progressive sequence diversity in windows
+		 *
+		 * Evaluates the same windows as the table version, coarse to fine, passing each to a callback as soon as it is done.
+		 * The first pass takes every `coarseStride`-th window (rounded down to a power of two).
+		 * Each following pass halves the stride and fills in the windows midway between those already reported, until all windows are done.
+		 * The scan stops early when the callback returns `false`.
+		 * Windows are counted by the planned engine. With more than one planned thread, the threads count a batch of windows at a time, which are then passed to the callback in order from the calling thread.
+		 *
+		 * \param[in] windowSize window size in base pairs
+		 * \param[in] stepSize window movement steps in base pairs
+		 * \param[in] coarseStride window stride of the first pass; 0 or 1 reports windows in position order
+		 * \param[in] plan window analysis plan
+		 * \param[in] windowCallback receives the window start position and unique sequence counts; returns `false` to cancel
+		 * \return number of windows evaluated
+		 */
+		size_t diversityInWindows(const size_t &windowSize, const size_t &stepSize, const size_t &coarseStride, const WindowPlan &plan,
+									const std::function<bool(const size_t &, std::vector<uint32_t> &&)> &windowCallback) const;
 		/** \brief Extract an alignment window
 		 *
 		 * Calculates the number of different sequences in a window.
 		 * Reports the number of times each unique sequence occurs in the provided window.
+		 * Masked columns are skipped.
 		 *
 		 * \param[in] windowStartPosition window start
 		 * \param[in] windowSize window size in base pairs
@@ -131,14 +396,142 @@ namespace BayesicSpace {
 		 *
 		 * Calculates the number of different sequences in a window.
 		 * Reports the number of times each unique sequence occurs in the provided window.
-		 * The output is sorted by the number of times a sequence is present, in descending order.
+		 * The output is sorted by the number of times a sequence is present, in descending order, and sequences with equal counts in lexicographic order.
 		 *
 		 * \param[in] windowStartPosition window start
 		 * \param[in] windowSize window size in base pairs
 		 * \return map of sequences to the number of times each occurs in the alignment, sorted
 		 */
 		std::vector< std::pair<std::string, uint32_t> > extractWindowSorted(const size_t &windowStartPosition, const size_t &windowSize) const;
-		/** \brief Extract a region matching a sequence 
+		/** \brief Extract an alignment window in parallel
+		 *
+		 * As `extractWindow`, but sequences are split among threads that count windows in thread-local tables.
+		 * The tables are hash-partitioned, so the partitions are merged in parallel without locking.
+		 * Use for very tall alignments (many sequences); falls back to the single-threaded version for one thread.
+		 *
+		 * \param[in] windowStartPosition window start
+		 * \param[in] windowSize window size in base pairs
+		 * \param[in] nThreads number of threads
+		 * \return map of sequences to the number of times each occurs in the alignment
+		 */
+		std::unordered_map<std::string, uint32_t> extractWindow(const size_t &windowStartPosition, const size_t &windowSize, const size_t &nThreads) const;
+		/** \brief Extract an alignment window and sort in parallel
+		 *
+		 * As `extractWindowSorted`, with counting as in the parallel `extractWindow`.
+		 * Each hash partition is sorted in its own thread and the sorted runs are merged pairwise, with the merges of each round in parallel.
+		 *
+		 * \param[in] windowStartPosition window start
+		 * \param[in] windowSize window size in base pairs
+		 * \param[in] nThreads number of threads
+		 * \return map of sequences to the number of times each occurs in the alignment, sorted
+		 */
+		std::vector< std::pair<std::string, uint32_t> > extractWindowSorted(const size_t &windowStartPosition, const size_t &windowSize, const size_t &nThreads) const;
+		/** \brief Plan window analyses
+		 *
+		 * Samples polymorphic column density and window sequence duplication in a few evenly spaced windows.
+		 * A cost model based on these and the alignment shape picks the counting engine and the number of threads.
+		 *
+		 * \param[in] windowSize window size in base pairs
+		 * \param[in] windowNumber number of windows to be analyzed; 1 plans a single window extraction
+		 * \param[in] nThreads maximal number of threads
+		 * \param[in] engine counting engine; `automatic` chooses by cost, any other value overrides the choice
+		 * \return window analysis plan
+		 */
+		WindowPlan planWindows(const size_t &windowSize, const size_t &windowNumber, const size_t &nThreads, const WindowEngine &engine) const;
+		/** \brief Build a sampled prefix-hash index
+		 *
+		 * Stores, for each sequence, two polynomial hashes (modulo 2^61 - 1, with different bases) of its unmasked residues before every `checkpointSpacing`-th column.
+		 * The hash of any window of any sequence is then computed from the nearest checkpoints with at most `checkpointSpacing` residues rehashed at each end.
+		 * Memory use is 16 bytes per sequence per checkpoint; the base power a window needs is computed from its length when it is hashed, so nothing is stored per column.
+		 * The index is kept up to date when columns are masked, sequences are placed or imputed, or storage is reordered.
+		 *
+		 * \param[in] checkpointSpacing number of columns between checkpoints
+		 */
+		void buildPrefixHashIndex(const size_t &checkpointSpacing);
+		/** \brief Checkpoint spacing of the prefix-hash index
+		 *
+		 * \return number of columns between checkpoints; 0 if there is no index
+		 */
+		size_t prefixHashSpacing() const noexcept { return checkpointSpacing_; };
+		/** \brief Hash of a window
+		 *
+		 * Windows with the same unmasked residues have the same hash; distinct windows share a hash with probability about 2^-120.
+		 * Needs a prefix-hash index.
+		 *
+		 * \param[in] sequenceIdx sequence index
+		 * \param[in] startIdx first column
+		 * \param[in] windowLength number of columns (truncated at the alignment end)
+		 * \return pair of window hashes
+		 */
+		std::array<uint64_t, 2> windowHash(const size_t &sequenceIdx, const size_t &startIdx, const size_t &windowLength) const;
+		/** \brief Sequence diversity in windows following a plan
+		 *
+		 * As the table version of `diversityInWindows`, with windows counted by the planned engine and split among the planned number of threads.
+		 *
+		 * \param[in] windowSize window size in base pairs
+		 * \param[in] stepSize window movement steps in base pairs
+		 * \param[in] plan window analysis plan
+		 * \return vector of pairs that contain window start positions and unique sequence counts
+		 */
+		std::vector< std::pair< size_t, std::vector<uint32_t> > > diversityInWindows(const size_t &windowSize, const size_t &stepSize, const WindowPlan &plan) const;
+		/** \brief Extract an alignment window following a plan
+		 *
+		 * \param[in] windowStartPosition window start
+		 * \param[in] windowSize window size in base pairs
+		 * \param[in] plan window analysis plan
+		 * \return map of sequences to the number of times each occurs in the alignment
+		 */
+		std::unordered_map<std::string, uint32_t> extractWindow(const size_t &windowStartPosition, const size_t &windowSize, const WindowPlan &plan) const;
+		/** \brief Extract an alignment window following a plan and sort
+		 *
+		 * \param[in] windowStartPosition window start
+		 * \param[in] windowSize window size in base pairs
+		 * \param[in] plan window analysis plan
+		 * \return map of sequences to the number of times each occurs in the alignment, sorted
+		 */
+		std::vector< std::pair<std::string, uint32_t> > extractWindowSorted(const size_t &windowStartPosition, const size_t &windowSize, const WindowPlan &plan) const;
+		/** \brief Polymorphic columns in a window
+		 *
+		 * Unmasked columns in the window where not all sequences have the same character.
+		 *
+		 * \param[in] windowStartPosition window start
+		 * \param[in] windowSize window size in base pairs (truncated at the alignment end)
+		 * \return polymorphic column indexes, in increasing order
+		 */
+		std::vector<size_t> polymorphicColumns(const size_t &windowStartPosition, const size_t &windowSize) const;
+		/** \brief Extract the polymorphic columns of an alignment window
+		 *
+		 * As `extractWindow`, but each unique window is reduced to its residues at the `polymorphicColumns` of the window.
+		 * Windows are counted by the packed or projection engine, so full window strings are never built and time and output size scale with the number of polymorphic columns rather than window length.
+		 * Counts are the same as those from `extractWindow`.
+		 *
+		 * \param[in] windowStartPosition window start
+		 * \param[in] windowSize window size in base pairs
+		 * \return map of compact haplotypes to the number of times each occurs in the alignment
+		 */
+		std::unordered_map<std::string, uint32_t> extractPolymorphicWindow(const size_t &windowStartPosition, const size_t &windowSize) const;
+		/** \brief Extract the polymorphic columns of an alignment window following a plan
+		 *
+		 * The `projection` and `packed` engines count the compact haplotypes directly.
+		 * The hash engines count whole windows as in `extractWindow` (in parallel for `hash`) and reduce the distinct windows to their polymorphic columns.
+		 *
+		 * \param[in] windowStartPosition window start
+		 * \param[in] windowSize window size in base pairs
+		 * \param[in] plan window analysis plan
+		 * \return map of compact haplotypes to the number of times each occurs in the alignment
+		 */
+		std::unordered_map<std::string, uint32_t> extractPolymorphicWindow(const size_t &windowStartPosition, const size_t &windowSize, const WindowPlan &plan) const;
+		/** \brief Extract the polymorphic columns of an alignment window following a plan and sort
+		 *
+		 * Haplotypes are in the same order as the corresponding windows from `extractWindowSorted`.
+		 *
+		 * \param[in] windowStartPosition window start
+		 * \param[in] windowSize window size in base pairs
+		 * \param[in] plan window analysis plan
+		 * \return compact haplotypes and the number of times each occurs in the alignment, sorted
+		 */
+		std::vector< std::pair<std::string, uint32_t> > extractPolymorphicWindowSorted(const size_t &windowStartPosition, const size_t &windowSize, const WindowPlan &plan) const;
+		/** \brief Extract a region matching a sequence
 		 *
 		 * Report all unique sequences (and their counts) matching the query sequence.
 		 * Matching performed using striped Smith-Waterman alignment.
@@ -147,6 +540,84 @@ namespace BayesicSpace {
 		 * \return matching window start and length
 		 */
 		AlignmentStatistics extractSequence(const std::string &querySequence) const;
+		/** \brief Extract a region matching a sequence using a cache
+		 *
+		 * As `extractSequence`, but the result is first looked up in a persistent cache.
+		 * The cache key is a hash of the consensus the query is aligned to, the query, and the Smith-Waterman scoring parameters.
+		 * Masking, imputation, or sequence placement that changes the consensus therefore misses the cache.
+		 * Cache misses are aligned and added to the cache.
+		 *
+		 * \param[in] querySequence the query sequence
+		 * \param[in,out] cache query result cache
+		 * \return matching window start and length
+		 */
+		AlignmentStatistics extractSequence(const std::string &querySequence, QueryCache &cache) const;
+		/** \brief Extract a region matching a protein sequence
+		 *
+		 * Translated search of a protein query against the consensus.
+		 * The gap-free consensus is translated in all six reading frames and each frame is aligned to the query with striped Smith-Waterman using BLOSUM62 scores.
+		 * Frames are aligned in parallel.
+		 * The best-scoring hit is mapped back to alignment columns through the gap positions of the consensus, so the reported window spans the codons of the hit on either strand.
+		 * Query start and length are in amino acids.
+		 *
+		 * \param[in] proteinQuery the protein query sequence (one-letter amino acid codes)
+		 * \return matching window start and length
+		 */
+		AlignmentStatistics extractProteinSequence(const std::string &proteinQuery) const;
+		/** \brief Extract a region matching a long sequence
+		 *
+		 * Seed-and-chain search for long queries (several kb or more), where full Smith-Waterman is too slow.
+		 * Minimizers of the gap-free consensus are indexed and matched to query minimizers.
+		 * The highest-scoring colinear chain of these anchors is found by dynamic programming, and its ends are extended with banded alignment of the flanking query and consensus segments.
+		 * Falls back to `extractSequence` if no anchors are found.
+		 * Coordinates are reported as in `extractSequence`.
+		 *
+		 * \param[in] querySequence the query sequence
+		 * \return matching window start and length
+		 */
+		AlignmentStatistics extractLongSequence(const std::string &querySequence) const;
+		/** \brief Find conserved regions
+		 *
+		 * Finds all windows of the given length with a limited number of variable columns and consensus GC content in the given range, for primer or probe design.
+		 * Variable-site and GC counts are updated as the window slides, so the search is one linear pass over the alignment.
+		 * GC content is the fraction of G or C among the A, C, G, T consensus residues in the window.
+		 * Regions are ranked by the number of variable sites, then by the distance of the GC content from the middle of the allowed range, then by position.
+		 * A window that overlaps a higher-ranked window is dropped, so the regions returned do not overlap.
+		 *
+		 * \param[in] windowSize window size in base pairs
+		 * \param[in] maxVariableSites maximal number of variable columns in a window
+		 * \param[in] minGC minimal GC content
+		 * \param[in] maxGC maximal GC content
+		 * \return ranked conserved regions
+		 */
+		std::vector<ConservedRegion> conservedRegions(const size_t &windowSize, const uint32_t &maxVariableSites, const double &minGC, const double &maxGC) const;
+		/** \brief Place unaligned sequences into the alignment
+		 *
+		 * Each new sequence is aligned to the gap-free consensus with striped Smith-Waterman, as in `extractSequence`.
+		 * Aligned residues are projected into the existing alignment columns, and columns not covered by the sequence are filled with gaps.
+		 * Residues inserted relative to the consensus have no column and are dropped, as are unaligned sequence ends.
+		 * Sequences are aligned in parallel, then appended to the alignment in input order, and the consensus is updated.
+		 *
+		 * \param[in] newSequences pairs of FASTA headers and unaligned sequences (gaps are removed)
+		 * \param[in] nThreads number of threads
+		 * \return placement statistics for each new sequence, in input order
+		 */
+		std::vector<PlacementStatistics> placeSequences(const std::vector< std::pair<std::string, std::string> > &newSequences, const size_t &nThreads);
+		/** \brief Store similar sequences together
+		 *
+		 * Sequences are stored in positional Burrows-Wheeler transform (PBWT) order: a stable sort on each variable column in turn, so that sequences sharing long runs of alleles end up next to each other.
+		 * This improves memory locality of the scans that group identical window sequences.
+		 * It does not make `BlockCompressedAlignment` smaller, because that store codes each sequence against the consensus, independently of sequence order.
+		 * Only the storage order changes; sequence indexes and all output stay in the original file order.
+		 */
+		void reorderBySimilarity();
+		/** \brief Alignment hash
+		 *
+		 * 64-bit FNV-1a hash of all headers and sequences, in original file order.
+		 *
+		 * \return alignment hash
+		 */
+		uint64_t alignmentHash() const noexcept;
 		/** \brief Impute missing values
 		 *
 		 * Replaces missing (N or other variants, e.g. Y, S, etc.) nucleotides with the consensus value.
@@ -159,13 +630,196 @@ namespace BayesicSpace {
 		 * The first string in the pair is the FASTA header, the second is the sequence without line breaks.
 		 */
 		std::vector< std::pair<std::string, std::string> > fastaAlignment_;
+		/** \brief Storage position of each sequence
+		 *
+		 * Indexed by the original (file) sequence order; empty if sequences are stored in that order.
+		 */
+		std::vector<size_t> storageIndex_;
 		/** \brief Consensus sequence */
 		std::string consensus_;
+		/** \brief Variable column bits */
+		std::vector<uint64_t> variableSites_;
+		/** \brief Polymorphic column bits
+		 *
+		 * Unmasked columns where not all sequences have the same character.
+		 */
+		std::vector<uint64_t> polymorphicColumns_;
+		/** \brief Cumulative per-column nucleotide diversity
+		 *
+		 * Element _i_ is the sum over columns before _i_.
+		 */
+		std::vector<double> diversityPrefix_;
+		/** \brief Masked column bits
+		 *
+		 * Empty if no columns are masked.
+		 */
+		std::vector<uint64_t> mask_;
+		/** \brief Missing residue bits of each sequence, in storage order */
+		std::vector< std::vector<uint64_t> > missingData_;
+		/** \brief Maximal fraction of missing residues in a window sequence */
+		double maxMissing_{1.0};
+		/** \brief Merge compatible window sequences */
+		bool groupCompatible_{false};
+		/** \brief Selected sequence bits, in storage order
+		 *
+		 * Empty if all sequences are selected.
+		 */
+		std::vector<uint64_t> sampleSelection_;
+		/** \brief Columns between prefix-hash checkpoints
+		 *
+		 * 0 if there is no prefix-hash index.
+		 */
+		size_t checkpointSpacing_{0};
+		/** \brief Prefix-hash checkpoints of each sequence, in storage order */
+		std::vector< std::vector< std::array<uint64_t, 2> > > prefixCheckpoints_;
+		/** \brief Is the column masked
+		 *
+		 * \param[in] alignmentColumn alignment column
+		 * \return `true` if the column is masked
+		 */
+		bool isMasked_(const size_t &alignmentColumn) const noexcept;
+		/** \brief Storage position of a sequence
+		 *
+		 * \param[in] sequenceIdx sequence index in the original order
+		 * \return position in the alignment data
+		 */
+		size_t storageIdx_(const size_t &sequenceIdx) const {return storageIndex_.empty() ? sequenceIdx : storageIndex_.at(sequenceIdx); };
+		/** \brief Copy unmasked residues
+		 *
+		 * Appends the residues of a window that are in unmasked columns, a mask word at a time.
+		 *
+		 * \param[in] alignedSequence sequence to copy from
+		 * \param[in] startIdx window start
+		 * \param[in] windowLength window length (truncated at the sequence end)
+		 * \param[in,out] window string to append to
+		 */
+		void appendUnmasked_(const std::string &alignedSequence, const size_t &startIdx, const size_t &windowLength, std::string &window) const;
 		/** \brief Generate the consensus sequence 
 		 *
 		 * Generates the majority (non-missing residues) consensus sequence.
 		 * The consensus is always upper case.
+		 * Variable columns are marked and per-column nucleotide diversity is accumulated in the same pass.
 		 */
 		void makeConsensus_();
+		/** \brief Build missing data bits
+		 *
+		 * Marks N, other ambiguity codes, and gaps in each sequence.
+		 */
+		void makeMissingData_();
+		/** \brief Number of missing unmasked residues in a window
+		 *
+		 * \param[in] missingBits missing data bits of a sequence
+		 * \param[in] startIdx window start
+		 * \param[in] windowLength window length
+		 * \return number of missing unmasked columns
+		 */
+		size_t missingInWindow_(const std::vector<uint64_t> &missingBits, const size_t &startIdx, const size_t &windowLength) const;
+		/** \brief Is a window sequence filtered out
+		 *
+		 * \param[in] storageIdx sequence position in the alignment data
+		 * \param[in] startIdx window start
+		 * \param[in] windowLength window length
+		 * \return `true` if the sequence has too much missing data in the window
+		 */
+		bool tooMuchMissing_(const size_t &storageIdx, const size_t &startIdx, const size_t &windowLength) const;
+		/** \brief Is a window sequence left out
+		 *
+		 * \param[in] storageIdx sequence position in the alignment data
+		 * \param[in] startIdx window start
+		 * \param[in] windowLength window length
+		 * \return `true` if the sequence is not selected or has too much missing data in the window
+		 */
+		bool isExcluded_(const size_t &storageIdx, const size_t &startIdx, const size_t &windowLength) const;
+		/** \brief Merge compatible window sequences
+		 *
+		 * \param[in] windowTable unique window sequences and their counts
+		 * \return compatible groups, as resolved sequences and counts
+		 */
+		std::unordered_map<std::string, uint32_t> compatibleGroups_(std::unordered_map<std::string, uint32_t> &&windowTable) const;
+		/** \brief Window of one sequence
+		 *
+		 * \param[in] alignedSequence aligned sequence
+		 * \param[in] startIdx window start
+		 * \param[in] windowLength window length
+		 * \return residues of the unmasked window columns
+		 */
+		std::string windowSequence_(const std::string &alignedSequence, const size_t &startIdx, const size_t &windowLength) const;
+		/** \brief Unique sequence counts in a window
+		 *
+		 * \param[in] windowStartPosition window start
+		 * \param[in] windowSize window size
+		 * \param[in] engine counting engine
+		 * \return number of times each unique window sequence occurs
+		 */
+		std::vector<uint32_t> windowCounts_(const size_t &windowStartPosition, const size_t &windowSize, const WindowEngine &engine) const;
+		/** \brief Polymorphic unmasked columns in a window
+		 *
+		 * \param[in] windowStartPosition window start
+		 * \param[in] windowSize window size (truncated at the alignment end)
+		 * \return polymorphic unmasked column indexes
+		 */
+		std::vector<size_t> projectionColumns_(const size_t &windowStartPosition, const size_t &windowSize) const;
+		/** \brief Count window sequences projected onto polymorphic columns
+		 *
+		 * \param[in] windowStartPosition window start
+		 * \param[in] windowSize window size
+		 * \param[in] engine `projection` or `packed`
+		 * \return projected sequences, each with its count and the storage position of its first occurrence
+		 */
+		std::unordered_map< std::string, std::pair<uint32_t, size_t> > projectedWindow_(const size_t &windowStartPosition, const size_t &windowSize,
+																						const WindowEngine &engine) const;
+		/** \brief Count window sequences by packed integer keys
+		 *
+		 * Residues at the projection columns are packed two bits each into `nWords` 64-bit words and counted in an integer-keyed hash table.
+		 * Sequences that cannot be packed are projected to strings.
+		 *
+		 * \tparam nWords number of key words, enough for the projection columns
+		 * \param[in] windowStartPosition window start
+		 * \param[in] windowSize window size
+		 * \param[in] columns projection columns
+		 * \return projected sequences, each with its count and the storage position of its first occurrence
+		 */
+		template <size_t nWords>
+		std::unordered_map< std::string, std::pair<uint32_t, size_t> > packedWindow_(const size_t &windowStartPosition, const size_t &windowSize,
+																						const std::vector<size_t> &columns) const;
+		/** \brief Prefix hash of a sequence
+		 *
+		 * \param[in] storageIdx sequence position in the alignment data
+		 * \param[in] alignmentColumn column up to which (not including) unmasked residues are hashed
+		 * \return pair of prefix hashes
+		 */
+		std::array<uint64_t, 2> prefixHash_(const size_t &storageIdx, const size_t &alignmentColumn) const;
+		/** \brief Hash of a column range of a sequence
+		 *
+		 * \param[in] storageIdx sequence position in the alignment data
+		 * \param[in] startIdx first column
+		 * \param[in] endIdx column after the last
+		 * \param[in] lengthPower base powers for the number of unmasked columns in the range
+		 * \return pair of range hashes
+		 */
+		std::array<uint64_t, 2> rangeHash_(const size_t &storageIdx, const size_t &startIdx, const size_t &endIdx, const std::array<uint64_t, 2> &lengthPower) const;
+		/** \brief Group window sequences by prefix-index hashes
+		 *
+		 * \param[in] windowStartPosition window start
+		 * \param[in] windowSize window size
+		 * \return count and storage position of the first sequence of each distinct window
+		 */
+		std::vector< std::pair<uint32_t, size_t> > hashedWindow_(const size_t &windowStartPosition, const size_t &windowSize) const;
+		/** \brief Count windows in hash partitions
+		 *
+		 * \param[in] windowStartPosition window start
+		 * \param[in] windowSize window size
+		 * \param[in] nThreads number of threads, also the number of partitions
+		 * \return disjoint unique window tables, one per partition
+		 */
+		std::vector< std::unordered_map<std::string, uint32_t> > windowPartitions_(const size_t &windowStartPosition, const size_t &windowSize, const size_t &nThreads) const;
+		/** \brief Gap-free consensus
+		 *
+		 * Removes gaps from the consensus and records the alignment column of each remaining residue.
+		 *
+		 * \param[out] ungappedConsensus consensus without gaps
+		 * \param[out] columnIndexes alignment column of each residue in `ungappedConsensus`
+		 */
+		void ungappedConsensus_(std::string &ungappedConsensus, std::vector<size_t> &columnIndexes) const;
 	};
 }
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Annotation feature interval index
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Class definition for an interval index of annotation features and per-feature alignment statistics.
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "fastaParser.hpp"
+#include "coordinateIndex.hpp"
+
+namespace BayesicSpace {
+	struct GenomicFeature;
+	struct FeatureStatistics;
+	class FeatureIndex;
+
+	/** \brief Annotation feature
+	 *
+	 * Half-open base-0 interval, in alignment columns once lifted over.
+	 */
+	struct GenomicFeature {
+		/** \brief Feature name */
+		std::string name;
+		/** \brief Feature type (e.g., gene, exon, CDS) */
+		std::string type;
+		/** \brief Interval start */
+		size_t start;
+		/** \brief Interval end (one past the last position) */
+		size_t end;
+	};
+
+	/** \brief Per-feature alignment statistics */
+	struct FeatureStatistics {
+		/** \brief Feature index */
+		size_t featureIdx;
+		/** \brief Number of unmasked columns */
+		size_t unmaskedColumns;
+		/** \brief Number of variable sites */
+		uint32_t variableSites;
+		/** \brief Number of unique sequences (haplotypes) */
+		uint32_t haplotypes;
+		/** \brief Nucleotide diversity */
+		double nucleotideDiversity;
+	};
+
+	/** \brief Feature interval index
+	 *
+	 * Features are sorted by start and form an implicit augmented interval tree: the middle feature of each index range is the root of that range, and stores the largest end in it.
+	 * An overlap query descends only into ranges whose largest end reaches the interval and whose first start precedes its end, so it takes O((k + 1) log n) time for k overlaps however long some features are.
+	 * Per-feature statistics come from the alignment's variable-site bits and nucleotide diversity prefix sums, plus one window extraction for the haplotype count.
+	 */
+	class FeatureIndex {
+	public:
+		/** \brief Default constructor */
+		FeatureIndex() = default;
+		/** \brief Constructor from features
+		 *
+		 * \param[in] features annotation features
+		 */
+		FeatureIndex(std::vector<GenomicFeature> features);
+		/** \brief Copy constructor
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		FeatureIndex(const FeatureIndex &toCopy) = default;
+		/** \brief Move constructor
+		 *
+		 * \param[in] toMove object to move
+		 */
+		FeatureIndex(FeatureIndex &&toMove) noexcept = default;
+		/** \brief Copy assignment operator
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		FeatureIndex& operator=(const FeatureIndex &toCopy) = default;
+		/** \brief Move assignment operator
+		 *
+		 * \param[in] toMove object to move
+		 */
+		FeatureIndex& operator=(FeatureIndex &&toMove) noexcept = default;
+		/** \brief Destructor */
+		~FeatureIndex() = default;
+		/** \brief Number of features
+		 *
+		 * \return number of features
+		 */
+		size_t size() const noexcept { return features_.size(); };
+		/** \brief Feature by index
+		 *
+		 * \param[in] featureIdx feature index, in start order
+		 * \return feature
+		 */
+		const GenomicFeature& feature(const size_t &featureIdx) const { return features_.at(featureIdx); };
+		/** \brief Features overlapping an interval
+		 *
+		 * \param[in] start interval start
+		 * \param[in] end interval end (one past the last position)
+		 * \return indexes of overlapping features, in start order
+		 */
+		std::vector<size_t> overlapping(const size_t &start, const size_t &end) const;
+		/** \brief Lift features over to alignment columns
+		 *
+		 * Converts feature intervals from the ungapped coordinates of a sample to alignment columns.
+		 *
+		 * \param[in] sampleCoordinates coordinate index of the sample the features are annotated on
+		 */
+		void liftOver(const CoordinateIndex &sampleCoordinates);
+		/** \brief Per-feature statistics
+		 *
+		 * Features must be in alignment columns. Features are processed in parallel.
+		 *
+		 * \param[in] alignment sequence alignment
+		 * \param[in] nThreads number of threads
+		 * \return statistics for each feature, in start order
+		 */
+		std::vector<FeatureStatistics> statistics(const ParseFASTA &alignment, const size_t &nThreads) const;
+		/** \brief Statistics of selected features
+		 *
+		 * As the all-feature version, but only for the listed features, e.g. those returned by `overlapping`.
+		 *
+		 * \param[in] alignment sequence alignment
+		 * \param[in] nThreads number of threads
+		 * \param[in] featureIdxs indexes of the features to analyze
+		 * \return statistics for each listed feature, in list order
+		 */
+		std::vector<FeatureStatistics> statistics(const ParseFASTA &alignment, const size_t &nThreads, const std::vector<size_t> &featureIdxs) const;
+	private:
+		/** \brief Features sorted by start */
+		std::vector<GenomicFeature> features_;
+		/** \brief Largest end in the index range each feature is the tree root of */
+		std::vector<size_t> subtreeMaxEnds_;
+		/** \brief Sort features and rebuild the subtree maximum ends */
+		void index_();
+		/** \brief Build the subtree maximum ends of an index range
+		 *
+		 * \param[in] rangeStart first feature index
+		 * \param[in] rangeEnd one past the last feature index
+		 * \return largest end in the range (0 if empty)
+		 */
+		size_t indexRange_(const size_t &rangeStart, const size_t &rangeEnd);
+		/** \brief Collect features in an index range overlapping an interval
+		 *
+		 * \param[in] rangeStart first feature index
+		 * \param[in] rangeEnd one past the last feature index
+		 * \param[in] start interval start
+		 * \param[in] end interval end (one past the last position)
+		 * \param[in,out] result overlapping feature indexes, appended in start order
+		 */
+		void overlappingRange_(const size_t &rangeStart, const size_t &rangeEnd, const size_t &start, const size_t &end, std::vector<size_t> &result) const;
+	};
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// FM-index of aligned sequences
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Class definition for an FM-index over all gap-stripped sequences in an alignment, used for exact motif search.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include <utility> // for std::pair
+#include <string>
+#include <cstdint>
+
+#include "fastaParser.hpp"
+#include "coordinateIndex.hpp"
+
+namespace BayesicSpace {
+	struct MotifHit;
+	class FMindex;
+
+	/** \brief Location of an exact motif match */
+	struct MotifHit {
+		/** \brief Index of the sequence in the alignment */
+		size_t sequenceIdx;
+		/** \brief Base-0 start position in the gap-stripped sequence */
+		size_t sequencePosition;
+		/** \brief Base-0 alignment column of the first motif residue */
+		size_t alignmentColumn;
+	};
+
+	/** \brief FM-index of aligned sequences
+	 *
+	 * Gap-stripped sequences are concatenated, with separators, and indexed with a Burrows-Wheeler transform.
+	 * Residues are case-insensitive and all non-ACGT residues are treated as N.
+	 * The suffix array is built by induced sorting (SA-IS) in time linear in the total residue count, so near-identical sequences cost no more than random ones.
+	 * Rank queries use one bit vector per residue with cumulative counts per 64-bit word, so counting a motif takes time proportional to the motif length regardless of the alignment size.
+	 * The suffix array is sampled every 32 text positions and at each sequence start, so each hit is located in at most 31 LF steps.
+	 * Hits are mapped back to alignment columns with a per-sequence `CoordinateIndex`.
+	 */
+	class FMindex {
+	public:
+		/** \brief Default constructor */
+		FMindex() = default;
+		/** \brief Constructor from an alignment
+		 *
+		 * \param[in] alignment sequence alignment
+		 */
+		FMindex(const ParseFASTA &alignment);
+		/** \brief Copy constructor
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		FMindex(const FMindex &toCopy) = default;
+		/** \brief Move constructor
+		 *
+		 * \param[in] toMove object to move
+		 */
+		FMindex(FMindex &&toMove) noexcept = default;
+		/** \brief Copy assignment operator
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		FMindex& operator=(const FMindex &toCopy) = default;
+		/** \brief Move assignment operator
+		 *
+		 * \param[in] toMove object to move
+		 */
+		FMindex& operator=(FMindex &&toMove) noexcept = default;
+		/** \brief Destructor */
+		~FMindex() = default;
+		/** \brief Count motif occurrences
+		 *
+		 * \param[in] motif nucleotide motif
+		 * \return number of occurrences in all sequences
+		 */
+		size_t count(const std::string &motif) const;
+		/** \brief Locate motif occurrences
+		 *
+		 * \param[in] motif nucleotide motif
+		 * \return hits sorted by sequence index and position
+		 */
+		std::vector<MotifHit> locate(const std::string &motif) const;
+		/** \brief Count motif occurrences per sequence
+		 *
+		 * \param[in] motif nucleotide motif
+		 * \return number of occurrences in each sequence, in alignment order
+		 */
+		std::vector<uint32_t> countPerSequence(const std::string &motif) const;
+	private:
+		/** \brief Number of symbols: terminator, separator, A, C, G, T, N */
+		static constexpr size_t nSymbols_{7};
+		/** \brief Code of the first residue symbol */
+		static constexpr uint8_t firstResidue_{2};
+		/** \brief Suffix array sampling rate */
+		static constexpr uint32_t sampleRate_{32};
+		/** \brief Bits per word */
+		static constexpr size_t wordSize_{64};
+		/** \brief Number of text positions */
+		size_t textLength_{0};
+		/** \brief Burrows-Wheeler transform of the concatenated sequences */
+		std::vector<uint8_t> bwt_;
+		/** \brief Number of text symbols smaller than each symbol */
+		std::array<size_t, nSymbols_> symbolStarts_{};
+		/** \brief BWT positions of each residue symbol, as bit vectors */
+		std::array<std::vector<uint64_t>, nSymbols_> symbolBits_;
+		/** \brief Cumulative symbol counts before each word */
+		std::array<std::vector<uint32_t>, nSymbols_> symbolRanks_;
+		/** \brief Sampled BWT rows */
+		std::vector<uint64_t> sampledRows_;
+		/** \brief Number of sampled rows before each word */
+		std::vector<uint32_t> sampledRanks_;
+		/** \brief Suffix array values of the sampled rows */
+		std::vector<uint32_t> suffixSamples_;
+		/** \brief Text position where each sequence starts */
+		std::vector<size_t> sequenceStarts_;
+		/** \brief Alignment column indexes for each sequence */
+		std::vector<CoordinateIndex> coordinates_;
+		/** \brief Symbol code of a character
+		 *
+		 * \param[in] residue residue character
+		 * \return symbol code
+		 */
+		static uint8_t symbolCode_(const char &residue) noexcept;
+		/** \brief Symbol occurrences in a BWT prefix
+		 *
+		 * \param[in] symbol residue symbol code
+		 * \param[in] bwtPosition BWT prefix length
+		 * \return number of occurrences of `symbol` before `bwtPosition`
+		 */
+		size_t occurrences_(const uint8_t &symbol, const size_t &bwtPosition) const noexcept;
+		/** \brief Backward search
+		 *
+		 * \param[in] motif nucleotide motif
+		 * \return half-open range of BWT rows whose suffixes start with the motif
+		 */
+		std::pair<size_t, size_t> backwardSearch_(const std::string &motif) const;
+		/** \brief Text position of a BWT row
+		 *
+		 * \param[in] bwtRow BWT row
+		 * \return suffix array value
+		 */
+		size_t textPosition_(size_t bwtRow) const;
+		/** \brief Suffix array by induced sorting
+		 *
+		 * SA-IS construction in time and extra space linear in text length, whatever the repeat content.
+		 * The last text symbol must be unique and smaller than all others.
+		 *
+		 * \param[in] text text symbols
+		 * \param[in] alphabetSize number of distinct symbol values (symbols are smaller than this)
+		 * \param[out] suffixArray suffix array
+		 */
+		template <typename SymbolType>
+		static void suffixArrayIS_(const std::vector<SymbolType> &text, const size_t &alphabetSize, std::vector<uint32_t> &suffixArray);
+	};
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Gap run-length encoded alignment
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Class definition for an alignment stored as gap runs and residues.
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <string>
+#include <utility> // for std::pair
+#include <cstdint>
+
+#include "fastaParser.hpp"
+
+namespace BayesicSpace {
+	struct GapRun;
+	class GapEncodedAlignment;
+
+	/** \brief Run of gap columns
+	 *
+	 * Half-open base-0 column interval of consecutive gaps in one sequence.
+	 */
+	struct GapRun {
+		/** \brief First gap column */
+		size_t start;
+		/** \brief Column after the last gap */
+		size_t end;
+		/** \brief Number of gap columns before the run */
+		size_t gapsBefore;
+	};
+
+	/** \brief Find gap runs
+	 *
+	 * \param[in] alignedSequence sequence with gaps
+	 * \return sorted gap runs
+	 */
+	std::vector<GapRun> findGapRuns(const std::string &alignedSequence);
+
+	/** \brief Gap-encoded alignment
+	 *
+	 * Each sequence is stored as its sorted gap runs plus its non-gap residues, so gap columns take no space.
+	 * Memory and the cost of window extraction and consensus are proportional to the number of residues and gap runs rather than alignment columns.
+	 */
+	class GapEncodedAlignment {
+	public:
+		/** \brief Default constructor */
+		GapEncodedAlignment() = default;
+		/** \brief Constructor from a FASTA file
+		 *
+		 * Sequences are encoded one at a time as they are read, so the gapped alignment is never held in memory.
+		 *
+		 * \param[in] fastaFileName input FASTA file name
+		 */
+		GapEncodedAlignment(const std::string &fastaFileName);
+		/** \brief Constructor from an alignment
+		 *
+		 * \param[in] alignment alignment to encode
+		 */
+		GapEncodedAlignment(const ParseFASTA &alignment);
+		/** \brief Copy constructor
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		GapEncodedAlignment(const GapEncodedAlignment &toCopy) = default;
+		/** \brief Move constructor
+		 *
+		 * \param[in] toMove object to move
+		 */
+		GapEncodedAlignment(GapEncodedAlignment &&toMove) noexcept = default;
+		/** \brief Copy assignment operator
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		GapEncodedAlignment& operator=(const GapEncodedAlignment &toCopy) = default;
+		/** \brief Move assignment operator
+		 *
+		 * \param[in] toMove object to move
+		 */
+		GapEncodedAlignment& operator=(GapEncodedAlignment &&toMove) noexcept = default;
+		/** \brief Destructor */
+		~GapEncodedAlignment() = default;
+		/** \brief Number of sequences
+		 *
+		 * \return number of sequences
+		 */
+		size_t sequenceNumber() const noexcept { return headers_.size(); };
+		/** \brief Number of alignment columns
+		 *
+		 * \return number of columns
+		 */
+		size_t alignmentLength() const noexcept { return alignmentLength_; };
+		/** \brief Sequence header
+		 *
+		 * \param[in] sequenceIdx sequence index
+		 * \return FASTA header without the leading '>'
+		 */
+		const std::string& header(const size_t &sequenceIdx) const { return headers_.at(sequenceIdx); };
+		/** \brief Gap runs of a sequence
+		 *
+		 * \param[in] sequenceIdx sequence index
+		 * \return sorted gap runs
+		 */
+		const std::vector<GapRun>& gapRuns(const size_t &sequenceIdx) const { return gapRuns_.at(sequenceIdx); };
+		/** \brief Non-gap residues of a sequence
+		 *
+		 * \param[in] sequenceIdx sequence index
+		 * \return ungapped sequence
+		 */
+		const std::string& residues(const size_t &sequenceIdx) const { return residues_.at(sequenceIdx); };
+		/** \brief Storage size
+		 *
+		 * \return number of bytes used by residues and gap runs
+		 */
+		size_t storageBytes() const noexcept;
+		/** \brief Window of one sequence
+		 *
+		 * \param[in] sequenceIdx sequence index
+		 * \param[in] windowStartPosition first column
+		 * \param[in] windowSize number of columns (truncated at the alignment end)
+		 * \return aligned residues in the window, with gaps
+		 */
+		std::string window(const size_t &sequenceIdx, const size_t &windowStartPosition, const size_t &windowSize) const;
+		/** \brief Extract unique sequences in a window
+		 *
+		 * Same as `ParseFASTA::extractWindow` on an unmasked alignment.
+		 *
+		 * \param[in] windowStartPosition first column
+		 * \param[in] windowSize number of columns (truncated at the alignment end)
+		 * \return unique window sequences and their counts
+		 */
+		std::unordered_map<std::string, uint32_t> extractWindow(const size_t &windowStartPosition, const size_t &windowSize) const;
+		/** \brief Extract unique sequences in a window, sorted
+		 *
+		 * Sorted by count, descending, with ties in sequence order, as `ParseFASTA::extractWindowSorted`.
+		 *
+		 * \param[in] windowStartPosition first column
+		 * \param[in] windowSize number of columns (truncated at the alignment end)
+		 * \return unique window sequences and their counts
+		 */
+		std::vector< std::pair<std::string, uint32_t> > extractWindowSorted(const size_t &windowStartPosition, const size_t &windowSize) const;
+		/** \brief Consensus sequence
+		 *
+		 * Consensus of the whole alignment, as `consensusWindow`.
+		 *
+		 * \return consensus sequence
+		 */
+		std::string consensus() const;
+		/** \brief Consensus in a window
+		 *
+		 * Majority residue among A, C, G, T, N (either case) and gap in each column, with ties going to the first in that order; N if a column has none of them.
+		 * Gap counts are accumulated per run, residues one at a time.
+		 *
+		 * \param[in] windowStartPosition first column
+		 * \param[in] windowSize number of columns (truncated at the alignment end)
+		 * \return consensus residues
+		 */
+		std::string consensusWindow(const size_t &windowStartPosition, const size_t &windowSize) const;
+	private:
+		/** \brief Sequence headers */
+		std::vector<std::string> headers_;
+		/** \brief Gap runs of each sequence */
+		std::vector< std::vector<GapRun> > gapRuns_;
+		/** \brief Non-gap residues of each sequence */
+		std::vector<std::string> residues_;
+		/** \brief Number of alignment columns */
+		size_t alignmentLength_{0};
+		/** \brief Add a sequence
+		 *
+		 * \param[in] sequenceHeader FASTA header
+		 * \param[in] alignedSequence sequence with gaps, the same length as the sequences already added
+		 */
+		void addSequence_(const std::string &sequenceHeader, const std::string &alignedSequence);
+	};
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// In-silico PCR
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Class definition for in-silico PCR with degenerate primers against every sequence in an alignment.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include <utility> // for std::pair
+#include <string>
+#include <cstdint>
+
+#include "fastaParser.hpp"
+
+namespace BayesicSpace {
+	struct AmpliconResult;
+	class InSilicoPCR;
+
+	/** \brief In-silico PCR result for one sequence
+	 *
+	 * Primer positions are base-0 in the gap-stripped sequence; the reverse primer position is the start of its binding site on the forward strand.
+	 * Amplicon columns are base-0 alignment columns of the first and last amplicon residues.
+	 * Positions are meaningful only if `amplified` is `true`.
+	 */
+	struct AmpliconResult {
+		/** \brief Index of the sequence in the alignment */
+		size_t sequenceIdx{0};
+		/** \brief Whether both primers bind in a productive orientation */
+		bool amplified{false};
+		/** \brief Forward primer binding start */
+		size_t forwardPosition{0};
+		/** \brief Forward primer mismatches */
+		uint32_t forwardMismatches{0};
+		/** \brief Reverse primer binding start on the forward strand */
+		size_t reversePosition{0};
+		/** \brief Reverse primer mismatches */
+		uint32_t reverseMismatches{0};
+		/** \brief Amplicon length in ungapped residues, including primers */
+		size_t ampliconLength{0};
+		/** \brief Alignment column of the first amplicon residue */
+		size_t ampliconStartColumn{0};
+		/** \brief Alignment column of the last amplicon residue */
+		size_t ampliconEndColumn{0};
+	};
+
+	/** \brief In-silico PCR
+	 *
+	 * Finds primer binding sites within a mismatch limit in every gap-stripped sequence of an alignment.
+	 * Primers may contain IUPAC degenerate codes; a primer position matches a template residue if the residue is a definite nucleotide in the primer's IUPAC set.
+	 * Ambiguous or missing template residues (e.g., N) count as mismatches, so unsequenced stretches do not amplify.
+	 * The reverse primer must bind downstream of the forward primer without overlapping it.
+	 * Matching is bit-parallel (shift-and with substitution states), scanning each sequence once per primer for primers up to 64 nucleotides.
+	 * The forward primer is matched on the forward strand and the reverse complement of the reverse primer downstream of it.
+	 * For each sequence, the primer pair with the fewest total mismatches (then the shortest product) is reported.
+	 * Sequences are processed in parallel.
+	 */
+	class InSilicoPCR {
+	public:
+		/** \brief Default constructor (deleted) */
+		InSilicoPCR() = delete;
+		/** \brief Constructor with primers
+		 *
+		 * \param[in] forwardPrimer forward primer, 5' to 3'
+		 * \param[in] reversePrimer reverse primer, 5' to 3'
+		 * \param[in] maxMismatches maximal number of mismatches per primer
+		 * \param[in] maxAmpliconLength maximal product length in ungapped residues
+		 */
+		InSilicoPCR(const std::string &forwardPrimer, const std::string &reversePrimer, const uint32_t &maxMismatches, const size_t &maxAmpliconLength);
+		/** \brief Copy constructor
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		InSilicoPCR(const InSilicoPCR &toCopy) = default;
+		/** \brief Move constructor
+		 *
+		 * \param[in] toMove object to move
+		 */
+		InSilicoPCR(InSilicoPCR &&toMove) noexcept = default;
+		/** \brief Copy assignment operator
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		InSilicoPCR& operator=(const InSilicoPCR &toCopy) = default;
+		/** \brief Move assignment operator
+		 *
+		 * \param[in] toMove object to move
+		 */
+		InSilicoPCR& operator=(InSilicoPCR &&toMove) noexcept = default;
+		/** \brief Destructor */
+		~InSilicoPCR() = default;
+		/** \brief Run PCR against an alignment
+		 *
+		 * \param[in] alignment sequence alignment
+		 * \param[in] nThreads number of threads
+		 * \return one result per sequence, in alignment order
+		 */
+		std::vector<AmpliconResult> amplify(const ParseFASTA &alignment, const size_t &nThreads) const;
+		/** \brief Run PCR against one sequence
+		 *
+		 * \param[in] alignedSequence sequence, possibly with gaps
+		 * \return PCR result; the sequence index is left at 0
+		 */
+		AmpliconResult amplify(const std::string &alignedSequence) const;
+	private:
+		/** \brief Number of character masks */
+		static constexpr size_t nChars_{128};
+		/** \brief Forward primer match masks, by character */
+		std::array<uint64_t, nChars_> forwardMasks_{};
+		/** \brief Reverse-complemented reverse primer match masks, by character */
+		std::array<uint64_t, nChars_> reverseMasks_{};
+		/** \brief Forward primer length */
+		size_t forwardLength_{0};
+		/** \brief Reverse primer length */
+		size_t reverseLength_{0};
+		/** \brief Mismatch limit */
+		uint32_t maxMismatches_{0};
+		/** \brief Product length limit */
+		size_t maxAmpliconLength_{0};
+		/** \brief Binding sites of a primer
+		 *
+		 * \param[in] sequence gap-stripped sequence
+		 * \param[in] matchMasks primer match masks
+		 * \param[in] primerLength primer length
+		 * \return pairs of binding start positions and mismatch counts
+		 */
+		std::vector< std::pair<size_t, uint32_t> > bindingSites_(const std::string &sequence, const std::array<uint64_t, nChars_> &matchMasks, const size_t &primerLength) const;
+	};
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Indel event index
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Class definition for an index of distinct gap intervals (indel events) in an alignment.
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <utility> // for std::pair
+#include <cstdint>
+
+#include "gapEncodedAlignment.hpp"
+#include "fastaParser.hpp"
+
+namespace BayesicSpace {
+	struct IndelEvent;
+	struct IndelWindowStatistics;
+	class IndelIndex;
+
+	/** \brief Indel event
+	 *
+	 * A distinct gap interval and the number of sequences that have exactly this gap run.
+	 */
+	struct IndelEvent {
+		/** \brief First gap column (base-0) */
+		size_t start;
+		/** \brief Column after the last gap */
+		size_t end;
+		/** \brief Number of sequences with the gap */
+		uint32_t carriers;
+	};
+	/** \brief Indel statistics of a window */
+	struct IndelWindowStatistics {
+		/** \brief Number of distinct indel events starting in the window */
+		uint32_t indels;
+		/** \brief Mean event length in columns */
+		double meanLength;
+		/** \brief Mean fraction of sequences carrying an event */
+		double meanFrequency;
+	};
+
+	/** \brief Indel event index
+	 *
+	 * Collects distinct gap runs across sequences from a gap-encoded alignment, or directly from the aligned sequences.
+	 * Runs that touch either end of the alignment are treated as missing sequence rather than indels and are left out, as are runs carried by every sequence, which are not polymorphic.
+	 * Events are sorted by position, with prefix sums of lengths and carrier counts, so statistics for any window take logarithmic time.
+	 * Each sequence's runs are kept as well, so that statistics can also be restricted to the sequences and columns an alignment uses in a window.
+	 */
+	class IndelIndex {
+	public:
+		/** \brief Default constructor */
+		IndelIndex() = default;
+		/** \brief Constructor from a gap-encoded alignment
+		 *
+		 * \param[in] alignment gap-encoded alignment
+		 */
+		IndelIndex(const GapEncodedAlignment &alignment);
+		/** \brief Constructor from an alignment
+		 *
+		 * Gap runs are found directly in the aligned sequences; residues are not copied.
+		 *
+		 * \param[in] alignment alignment
+		 */
+		IndelIndex(const ParseFASTA &alignment);
+		/** \brief Copy constructor
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		IndelIndex(const IndelIndex &toCopy) = default;
+		/** \brief Move constructor
+		 *
+		 * \param[in] toMove object to move
+		 */
+		IndelIndex(IndelIndex &&toMove) noexcept = default;
+		/** \brief Copy assignment operator
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		IndelIndex& operator=(const IndelIndex &toCopy) = default;
+		/** \brief Move assignment operator
+		 *
+		 * \param[in] toMove object to move
+		 */
+		IndelIndex& operator=(IndelIndex &&toMove) noexcept = default;
+		/** \brief Destructor */
+		~IndelIndex() = default;
+		/** \brief Number of events
+		 *
+		 * \return number of distinct indel events
+		 */
+		size_t size() const noexcept { return events_.size(); };
+		/** \brief Indel event
+		 *
+		 * \param[in] eventIdx event index, in position order
+		 * \return indel event
+		 */
+		const IndelEvent& event(const size_t &eventIdx) const { return events_.at(eventIdx); };
+		/** \brief Events starting in a window
+		 *
+		 * \param[in] windowStartPosition first column
+		 * \param[in] windowSize number of columns
+		 * \return first event index and one past the last
+		 */
+		std::pair<size_t, size_t> eventRange(const size_t &windowStartPosition, const size_t &windowSize) const;
+		/** \brief Indel statistics of a window
+		 *
+		 * \param[in] windowStartPosition first column
+		 * \param[in] windowSize number of columns
+		 * \return statistics of the events starting in the window; means are 0 if there are none
+		 */
+		IndelWindowStatistics windowStatistics(const size_t &windowStartPosition, const size_t &windowSize) const;
+		/** \brief Indel statistics of a window after alignment filters
+		 *
+		 * Only the sequences the alignment uses in the window (after sample selection and missing-data filtering) are counted.
+		 * Events that overlap masked columns, and events carried by all the counted sequences, are left out; frequencies are among the counted sequences.
+		 * Takes time proportional to the number of sequences times the logarithm of their run number, plus sorting the runs that start in the window.
+		 *
+		 * \param[in] windowStartPosition first column
+		 * \param[in] windowSize number of columns
+		 * \param[in] alignment the alignment the index was built from, with its current mask and filters
+		 * \return statistics of the events starting in the window; means are 0 if there are none
+		 */
+		IndelWindowStatistics windowStatistics(const size_t &windowStartPosition, const size_t &windowSize, const ParseFASTA &alignment) const;
+	private:
+		/** \brief Events sorted by start, then end */
+		std::vector<IndelEvent> events_;
+		/** \brief Total length of the events before each index */
+		std::vector<size_t> lengthPrefix_;
+		/** \brief Total carriers of the events before each index */
+		std::vector<uint64_t> carrierPrefix_;
+		/** \brief Internal gap runs of each sequence, as start and end columns */
+		std::vector< std::vector< std::pair<size_t, size_t> > > sequenceRuns_;
+		/** \brief Number of sequences in the alignment */
+		size_t sequenceNumber_{0};
+		/** \brief Keep the internal gap runs of a sequence
+		 *
+		 * \param[in] gapRuns sorted gap runs of the sequence
+		 * \param[in] alignmentLength number of alignment columns
+		 */
+		void addSequenceRuns_(const std::vector<GapRun> &gapRuns, const size_t &alignmentLength);
+		/** \brief Build the event index from the sequence runs */
+		void indexEvents_();
+	};
+}
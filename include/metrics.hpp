@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Performance metrics
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Class definitions for run-time performance metrics (counters, gauges, and latency histograms) exported in the Prometheus text format.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <unordered_map>
+#include <string>
+#include <cstdint>
+
+namespace BayesicSpace {
+	class LatencyHistogram;
+	class MetricsRegistry;
+	class ScopedTimer;
+
+	/** \brief Latency histogram
+	 *
+	 * HDR-style log-linear histogram of latencies in nanoseconds.
+	 * Each power of two is split into a fixed number of linear sub-buckets, so relative precision is constant over the whole range.
+	 * Recording is lock-free and can be done from several threads at once.
+	 */
+	class LatencyHistogram {
+	public:
+		/** \brief Default constructor */
+		LatencyHistogram();
+		/** \brief Copy constructor (deleted) */
+		LatencyHistogram(const LatencyHistogram &toCopy) = delete;
+		/** \brief Move constructor (deleted) */
+		LatencyHistogram(LatencyHistogram &&toMove) = delete;
+		/** \brief Copy assignment operator (deleted) */
+		LatencyHistogram& operator=(const LatencyHistogram &toCopy) = delete;
+		/** \brief Move assignment operator (deleted) */
+		LatencyHistogram& operator=(LatencyHistogram &&toMove) = delete;
+		/** \brief Destructor */
+		~LatencyHistogram() = default;
+		/** \brief Record a latency
+		 *
+		 * \param[in] nanoseconds latency value
+		 */
+		void record(const uint64_t &nanoseconds) noexcept;
+		/** \brief Number of recorded values
+		 *
+		 * \return number of values
+		 */
+		uint64_t count() const noexcept { return count_.load(std::memory_order_relaxed); };
+		/** \brief Sum of recorded values
+		 *
+		 * \return sum of latencies in nanoseconds
+		 */
+		uint64_t sum() const noexcept { return sum_.load(std::memory_order_relaxed); };
+		/** \brief Latency quantile
+		 *
+		 * Returns the upper bound of the bucket that contains the requested quantile.
+		 *
+		 * \param[in] probability quantile probability, must be in [0, 1]
+		 * \return latency quantile in nanoseconds
+		 */
+		uint64_t quantile(const double &probability) const;
+		/** \brief Prometheus text representation
+		 *
+		 * Cumulative bucket counts are reported for non-empty buckets only, with upper bounds in seconds.
+		 *
+		 * \param[in] metricName name of the metric
+		 * \return Prometheus histogram exposition text
+		 */
+		std::string prometheusText(const std::string &metricName) const;
+	private:
+		/** \brief Number of bits used for linear sub-buckets */
+		static constexpr uint64_t subBucketBits_{3};
+		/** \brief Number of linear sub-buckets per power of two */
+		static constexpr uint64_t subBucketCount_{1ULL << subBucketBits_};
+		/** \brief Total number of buckets */
+		static constexpr size_t bucketCount_{(64 - subBucketBits_ + 1) * subBucketCount_};
+		/** \brief Bucket counts */
+		std::array<std::atomic<uint64_t>, bucketCount_> buckets_;
+		/** \brief Number of recorded values */
+		std::atomic<uint64_t> count_;
+		/** \brief Sum of recorded values */
+		std::atomic<uint64_t> sum_;
+		/** \brief Bucket index for a value
+		 *
+		 * \param[in] value value to bin
+		 * \return bucket index
+		 */
+		static size_t bucketIndex_(const uint64_t &value) noexcept;
+		/** \brief Bucket upper bound
+		 *
+		 * \param[in] bucketIdx bucket index
+		 * \return largest value that falls into the bucket
+		 */
+		static uint64_t bucketUpperBound_(const size_t &bucketIdx) noexcept;
+	};
+
+	/** \brief Metrics registry
+	 *
+	 * Named counters, gauges, and latency histograms.
+	 * Registration is protected by a mutex, but the returned references are updated lock-free, so they should be obtained once and reused in hot code.
+	 * Metrics are exported in the Prometheus text exposition format to a string or a file.
+	 */
+	class MetricsRegistry {
+	public:
+		/** \brief Default constructor */
+		MetricsRegistry() = default;
+		/** \brief Copy constructor (deleted) */
+		MetricsRegistry(const MetricsRegistry &toCopy) = delete;
+		/** \brief Move constructor (deleted) */
+		MetricsRegistry(MetricsRegistry &&toMove) = delete;
+		/** \brief Copy assignment operator (deleted) */
+		MetricsRegistry& operator=(const MetricsRegistry &toCopy) = delete;
+		/** \brief Move assignment operator (deleted) */
+		MetricsRegistry& operator=(MetricsRegistry &&toMove) = delete;
+		/** \brief Destructor */
+		~MetricsRegistry() = default;
+		/** \brief Get or create a counter
+		 *
+		 * Counters only increase.
+		 *
+		 * \param[in] name metric name
+		 * \return reference to the counter
+		 */
+		std::atomic<uint64_t>& counter(const std::string &name);
+		/** \brief Get or create a gauge
+		 *
+		 * Gauges can go up and down (e.g., queue depths or memory use).
+		 *
+		 * \param[in] name metric name
+		 * \return reference to the gauge
+		 */
+		std::atomic<int64_t>& gauge(const std::string &name);
+		/** \brief Get or create a latency histogram
+		 *
+		 * \param[in] name metric name
+		 * \return reference to the histogram
+		 */
+		LatencyHistogram& histogram(const std::string &name);
+		/** \brief Prometheus text representation
+		 *
+		 * Peak resident memory of the process is added as a gauge.
+		 *
+		 * \return Prometheus exposition text for all metrics
+		 */
+		std::string prometheusText() const;
+		/** \brief Dump metrics to a file
+		 *
+		 * The file is written under a temporary name and then renamed, so scrapers never see a partial file.
+		 *
+		 * \param[in] fileName output file name
+		 */
+		void dumpToFile(const std::string &fileName) const;
+	private:
+		/** \brief Registration mutex */
+		mutable std::mutex registryMutex_;
+		/** \brief Counters */
+		std::unordered_map< std::string, std::unique_ptr< std::atomic<uint64_t> > > counters_;
+		/** \brief Gauges */
+		std::unordered_map< std::string, std::unique_ptr< std::atomic<int64_t> > > gauges_;
+		/** \brief Latency histograms */
+		std::unordered_map< std::string, std::unique_ptr<LatencyHistogram> > histograms_;
+	};
+
+	/** \brief Scoped latency timer
+	 *
+	 * Records the time between construction and destruction in a latency histogram.
+	 */
+	class ScopedTimer {
+	public:
+		/** \brief Constructor
+		 *
+		 * \param[in,out] histogram histogram that receives the elapsed time
+		 */
+		ScopedTimer(LatencyHistogram &histogram) : histogram_{histogram}, start_{std::chrono::steady_clock::now()} {};
+		/** \brief Copy constructor (deleted) */
+		ScopedTimer(const ScopedTimer &toCopy) = delete;
+		/** \brief Move constructor (deleted) */
+		ScopedTimer(ScopedTimer &&toMove) = delete;
+		/** \brief Copy assignment operator (deleted) */
+		ScopedTimer& operator=(const ScopedTimer &toCopy) = delete;
+		/** \brief Move assignment operator (deleted) */
+		ScopedTimer& operator=(ScopedTimer &&toMove) = delete;
+		/** \brief Destructor records the elapsed time */
+		~ScopedTimer();
+	private:
+		/** \brief Target histogram */
+		LatencyHistogram &histogram_;
+		/** \brief Start time */
+		std::chrono::steady_clock::time_point start_;
+	};
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Persistent query alignment cache
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Class definition for an on-disk cache of query alignment results.
+ *
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <string>
+#include <cstdint>
+
+#include "fastaParser.hpp"
+
+namespace BayesicSpace {
+	class QueryCache;
+
+	/** \brief Persistent query alignment cache
+	 *
+	 * Stores `AlignmentStatistics` keyed by a 64-bit hash of the alignment contents, the query sequence, and the alignment scoring parameters.
+	 * The cache is a plain text file with one tab-delimited record per line: the key in hexadecimal followed by the reference start, reference length, query start, and query length.
+	 * All records are read at construction and new records are appended as they are inserted, so results survive process restarts.
+	 * Unreadable lines are ignored.
+	 */
+	class QueryCache {
+	public:
+		/** \brief Default constructor */
+		QueryCache() = default;
+		/** \brief Constructor from a cache file
+		 *
+		 * The file is created on the first insertion if it does not exist.
+		 *
+		 * \param[in] cacheFileName cache file name
+		 */
+		QueryCache(const std::string &cacheFileName);
+		/** \brief Copy constructor
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		QueryCache(const QueryCache &toCopy) = default;
+		/** \brief Move constructor
+		 *
+		 * \param[in] toMove object to move
+		 */
+		QueryCache(QueryCache &&toMove) noexcept = default;
+		/** \brief Copy assignment operator
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		QueryCache& operator=(const QueryCache &toCopy) = default;
+		/** \brief Move assignment operator
+		 *
+		 * \param[in] toMove object to move
+		 */
+		QueryCache& operator=(QueryCache &&toMove) noexcept = default;
+		/** \brief Destructor */
+		~QueryCache() = default;
+		/** \brief Number of cached records
+		 *
+		 * \return number of records
+		 */
+		size_t size() const noexcept { return cache_.size(); };
+		/** \brief Number of successful look-ups
+		 *
+		 * \return number of cache hits
+		 */
+		uint64_t hits() const noexcept { return hits_; };
+		/** \brief Number of failed look-ups
+		 *
+		 * \return number of cache misses
+		 */
+		uint64_t misses() const noexcept { return misses_; };
+		/** \brief Look up a record
+		 *
+		 * \param[in] key record key
+		 * \param[out] alignStats cached alignment statistics, unchanged if the key is absent
+		 * \return `true` if the key is in the cache
+		 */
+		bool find(const uint64_t &key, AlignmentStatistics &alignStats);
+		/** \brief Insert a record
+		 *
+		 * The record is added to the in-memory table and appended to the cache file.
+		 *
+		 * \param[in] key record key
+		 * \param[in] alignStats alignment statistics to cache
+		 */
+		void insert(const uint64_t &key, const AlignmentStatistics &alignStats);
+	private:
+		/** \brief Cache file name */
+		std::string cacheFileName_;
+		/** \brief Cached records */
+		std::unordered_map<uint64_t, AlignmentStatistics> cache_;
+		/** \brief Hit count */
+		uint64_t hits_{0};
+		/** \brief Miss count */
+		uint64_t misses_{0};
+	};
+}
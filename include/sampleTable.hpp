@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Sample metadata table
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Class definition for a columnar table of sample metadata parsed from FASTA headers.
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <string>
+#include <cstdint>
+
+#include "fastaParser.hpp"
+
+namespace BayesicSpace {
+	class SampleTable;
+
+	/** \brief Sample metadata table
+	 *
+	 * Header fields are parsed once into dictionary-encoded columns, one code per sample.
+	 * Headers are split at `|` and white space; a `key=value` field goes into the `key` column, any other field into `fieldK`, where `K` is the base-1 field position.
+	 * Predicates are evaluated once per distinct value and yield sample bit masks for `ParseFASTA::selectSamples`.
+	 */
+	class SampleTable {
+	public:
+		/** \brief Default constructor */
+		SampleTable() = default;
+		/** \brief Constructor from headers
+		 *
+		 * \param[in] headers FASTA headers, one per sample
+		 */
+		SampleTable(const std::vector<std::string> &headers);
+		/** \brief Constructor from an alignment
+		 *
+		 * \param[in] alignment alignment whose headers are parsed, in sequence index order
+		 */
+		SampleTable(const ParseFASTA &alignment);
+		/** \brief Copy constructor
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		SampleTable(const SampleTable &toCopy) = default;
+		/** \brief Move constructor
+		 *
+		 * \param[in] toMove object to move
+		 */
+		SampleTable(SampleTable &&toMove) noexcept = default;
+		/** \brief Copy assignment operator
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		SampleTable& operator=(const SampleTable &toCopy) = default;
+		/** \brief Move assignment operator
+		 *
+		 * \param[in] toMove object to move
+		 */
+		SampleTable& operator=(SampleTable &&toMove) noexcept = default;
+		/** \brief Destructor */
+		~SampleTable() = default;
+		/** \brief Number of samples
+		 *
+		 * \return number of samples
+		 */
+		size_t sampleNumber() const noexcept { return sampleNumber_; };
+		/** \brief Number of columns
+		 *
+		 * \return number of metadata columns
+		 */
+		size_t columnNumber() const noexcept { return columnNames_.size(); };
+		/** \brief Column name
+		 *
+		 * \param[in] columnIdx column index, in order of first appearance
+		 * \return column name
+		 */
+		const std::string& columnName(const size_t &columnIdx) const { return columnNames_.at(columnIdx); };
+		/** \brief Sample value
+		 *
+		 * \param[in] sampleIdx sample index
+		 * \param[in] columnName column name
+		 * \return field value; empty if the sample does not have the field
+		 */
+		std::string value(const size_t &sampleIdx, const std::string &columnName) const;
+		/** \brief Select samples
+		 *
+		 * Predicates are comparisons `column op value`, with `op` one of `=`, `!=`, `<`, `<=`, `>`, `>=`, joined by `&` and `|`; `&` binds tighter.
+		 * Values are compared as numbers if both sides are numbers and as strings otherwise, so ISO dates compare in time order.
+		 * Samples without the field fail every comparison.
+		 *
+		 * \param[in] predicate selection predicate
+		 * \return selected sample bits, one per sample in 64-bit words
+		 */
+		std::vector<uint64_t> select(const std::string &predicate) const;
+	private:
+		/** \brief Number of samples */
+		size_t sampleNumber_{0};
+		/** \brief Column names in order of first appearance */
+		std::vector<std::string> columnNames_;
+		/** \brief Column name index */
+		std::unordered_map<std::string, size_t> columnIndex_;
+		/** \brief Distinct values of each column */
+		std::vector< std::vector<std::string> > dictionaries_;
+		/** \brief Value codes of each column
+		 *
+		 * Code 0 marks a missing field; code _k_ is dictionary entry _k_ - 1.
+		 */
+		std::vector< std::vector<uint32_t> > codes_;
+		/** \brief Evaluate one comparison
+		 *
+		 * \param[in] comparison comparison string
+		 * \return selected sample bits
+		 */
+		std::vector<uint64_t> selectComparison_(const std::string &comparison) const;
+	};
+}
@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Block-compressed alignment store
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Implementation of a random-access alignment store compressed in column blocks.
+ *
+ */
+
+#include <vector>
+#include <unordered_map>
+#include <utility> // for std::pair
+#include <string>
+#include <array>
+#include <iterator>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+
+#include "blockStore.hpp"
+#include "fastaParser.hpp"
+
+using namespace BayesicSpace;
+
+namespace {
+	/** \brief Append a variable-length integer
+	 *
+	 * Seven bits per byte, low bits first; the high bit marks continuation.
+	 *
+	 * \param[in] value value to encode
+	 * \param[in,out] bytes output bytes
+	 */
+	void appendVarint(size_t value, std::vector<uint8_t> &bytes) {
+		constexpr size_t lowBits{0x7F};
+		constexpr uint8_t continuation{0x80};
+		while (value > lowBits) {
+			bytes.push_back( static_cast<uint8_t>(value & lowBits) | continuation );
+			value >>= 7;
+		}
+		bytes.push_back( static_cast<uint8_t>(value) );
+	}
+	/** \brief Read a variable-length integer
+	 *
+	 * \param[in] bytes encoded bytes
+	 * \param[in,out] position read position, moved past the integer
+	 * \return decoded value
+	 */
+	size_t readVarint(const std::vector<uint8_t> &bytes, size_t &position) {
+		constexpr uint8_t lowBits{0x7F};
+		constexpr uint8_t continuation{0x80};
+		size_t value{0};
+		size_t shift{0};
+		uint8_t eachByte{continuation};
+		while ( (eachByte & continuation) != 0 ) {
+			eachByte  = bytes[position++];
+			value    |= static_cast<size_t>(eachByte & lowBits) << shift;
+			shift    += 7;
+		}
+		return value;
+	}
+	/** \brief Residues counted for the consensus, in tie-breaking order */
+	constexpr std::array<char, 11> standardResidues{ {'A', 'a', 'C', 'c', 'T', 't', 'G', 'g', 'N', 'n', '-'} };
+	/** \brief Per-column counts of the standard residues */
+	using ResidueCounts = std::array<uint32_t, standardResidues.size()>;
+	/** \brief Add a sequence to column residue counts
+	 *
+	 * \param[in] sequence aligned sequence
+	 * \param[in,out] columnCounts residue counts, one element per column
+	 */
+	void countResidues(const std::string &sequence, std::vector<ResidueCounts> &columnCounts) {
+		constexpr size_t nChars{256};
+		std::array<size_t, nChars> residueIndex{};
+		residueIndex.fill( standardResidues.size() );
+		for (size_t iRes = 0; iRes < standardResidues.size(); ++iRes) {
+			residueIndex[static_cast<unsigned char>(standardResidues[iRes])] = iRes;
+		}
+		for (size_t iCol = 0; iCol < sequence.size(); ++iCol) {
+			const size_t resIdx = residueIndex[static_cast<unsigned char>(sequence[iCol])];
+			if ( resIdx < standardResidues.size() ) {
+				++columnCounts[iCol][resIdx];
+			}
+		}
+	}
+	/** \brief Consensus from column residue counts
+	 *
+	 * \param[in] columnCounts residue counts, one element per column
+	 * \return the most common residue in each column; N if a column has no standard residues
+	 */
+	std::string columnConsensus(const std::vector<ResidueCounts> &columnCounts) {
+		std::string consensus;
+		consensus.reserve( columnCounts.size() );
+		for (const auto &eachColumn : columnCounts) {
+			const auto maxIt = std::max_element( eachColumn.cbegin(), eachColumn.cend() );
+			consensus.push_back( *maxIt == 0 ? 'N' : standardResidues[static_cast<size_t>( std::distance(eachColumn.cbegin(), maxIt) )] );
+		}
+		return consensus;
+	}
+}
+
+BlockCompressedAlignment::BlockCompressedAlignment(const ParseFASTA &alignment, const size_t &blockSize, const size_t &cacheBlocks) :
+									alignmentLength_{alignment.alignmentLength()}, blockSize_{blockSize}, cacheBlocks_{cacheBlocks} {
+	if ( (blockSize_ == 0) || (cacheBlocks_ == 0) ) {
+		throw std::string("ERROR: block size and cache size must be positive in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	headers_.reserve( alignment.sequenceNumber() );
+	std::vector<ResidueCounts> columnCounts(alignmentLength_);
+	for (size_t iSeq = 0; iSeq < alignment.sequenceNumber(); ++iSeq) {
+		headers_.push_back( alignment.header(iSeq) );
+		countResidues(alignment.sequence(iSeq), columnCounts);
+	}
+	consensus_ = columnConsensus(columnCounts);
+	columnCounts.clear();
+	columnCounts.shrink_to_fit();
+	std::vector< std::vector<uint8_t> > blockBytes( (alignmentLength_ + blockSize_ - 1) / blockSize_ );
+	for (size_t iSeq = 0; iSeq < alignment.sequenceNumber(); ++iSeq) {
+		this->encodeSequence_(alignment.sequence(iSeq), blockBytes);
+	}
+	this->storeBlocks_(blockBytes);
+}
+
+BlockCompressedAlignment::BlockCompressedAlignment(const std::string &fastaFileName, const size_t &blockSize, const size_t &cacheBlocks) :
+									blockSize_{blockSize}, cacheBlocks_{cacheBlocks} {
+	if ( (blockSize_ == 0) || (cacheBlocks_ == 0) ) {
+		throw std::string("ERROR: block size and cache size must be positive in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	// first pass: headers and residue counts for the consensus
+	std::vector<ResidueCounts> columnCounts;
+	bool sameLength{true};
+	readFASTA(fastaFileName, [this, &columnCounts, &sameLength](const std::string &sequenceHeader, const std::string &alignedSequence){
+		if ( headers_.empty() ) {
+			alignmentLength_ = alignedSequence.size();
+			columnCounts.resize(alignmentLength_);
+		}
+		headers_.push_back(sequenceHeader);
+		if (alignedSequence.size() != alignmentLength_) {
+			sameLength = false;
+			return;
+		}
+		countResidues(alignedSequence, columnCounts);
+	});
+	if (headers_.size() < 2) {
+		throw std::string("ERROR: alignment file ") + fastaFileName + std::string(" must have at least two sequence records in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if (!sameLength) {
+		throw std::string("ERROR: all sequences in file ") + fastaFileName + std::string(" must be the same length in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	consensus_ = columnConsensus(columnCounts);
+	columnCounts.clear();
+	columnCounts.shrink_to_fit();
+	// second pass: compress each record against the consensus
+	std::vector< std::vector<uint8_t> > blockBytes( (alignmentLength_ + blockSize_ - 1) / blockSize_ );
+	size_t nRecords{0};
+	readFASTA(fastaFileName, [this, &blockBytes, &sameLength, &nRecords](const std::string & /*sequenceHeader*/, const std::string &alignedSequence){
+		++nRecords;
+		if (alignedSequence.size() != alignmentLength_) {
+			sameLength = false;
+			return;
+		}
+		this->encodeSequence_(alignedSequence, blockBytes);
+	});
+	if ( !sameLength || ( nRecords != headers_.size() ) ) {
+		throw std::string("ERROR: file ") + fastaFileName + std::string(" changed while it was read in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	this->storeBlocks_(blockBytes);
+}
+
+std::string BlockCompressedAlignment::window(const size_t &sequenceIdx, const size_t &windowStartPosition, const size_t &windowSize) const {
+	if ( sequenceIdx >= headers_.size() ) {
+		throw std::string("ERROR: sequence index out of range in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if (windowStartPosition >= alignmentLength_) {
+		throw std::string("ERROR: window start is past alignment length in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const size_t windowEnd = std::min(alignmentLength_, windowStartPosition + windowSize);
+	std::string result;
+	result.reserve(windowEnd - windowStartPosition);
+	for (size_t iBlock = windowStartPosition / blockSize_; iBlock * blockSize_ < windowEnd; ++iBlock) {
+		const size_t blockStart = iBlock * blockSize_;
+		const size_t blockWidth = this->blockWidth_(iBlock);
+		const size_t firstCol   = std::max(windowStartPosition, blockStart) - blockStart;
+		const size_t endCol     = std::min(windowEnd, blockStart + blockWidth) - blockStart;
+		const auto residues     = this->block_(iBlock);
+		result.append(*residues, sequenceIdx * blockWidth + firstCol, endCol - firstCol);
+	}
+	return result;
+}
+
+std::unordered_map<std::string, uint32_t> BlockCompressedAlignment::extractWindow(const size_t &windowStartPosition, const size_t &windowSize) const {
+	if (windowStartPosition >= alignmentLength_) {
+		throw std::string("ERROR: window start is past alignment length in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const size_t windowEnd = std::min(alignmentLength_, windowStartPosition + windowSize);
+	std::vector<std::string> windows( headers_.size() );
+	for (auto &eachWindow : windows) {
+		eachWindow.reserve(windowEnd - windowStartPosition);
+	}
+	for (size_t iBlock = windowStartPosition / blockSize_; iBlock * blockSize_ < windowEnd; ++iBlock) {
+		const size_t blockStart = iBlock * blockSize_;
+		const size_t blockWidth = this->blockWidth_(iBlock);
+		const size_t firstCol   = std::max(windowStartPosition, blockStart) - blockStart;
+		const size_t endCol     = std::min(windowEnd, blockStart + blockWidth) - blockStart;
+		const auto residues     = this->block_(iBlock);
+		for (size_t iSeq = 0; iSeq < windows.size(); ++iSeq) {
+			windows[iSeq].append(*residues, iSeq * blockWidth + firstCol, endCol - firstCol);
+		}
+	}
+	std::unordered_map<std::string, uint32_t> result;
+	for (auto &eachWindow : windows) {
+		++result[std::move(eachWindow)];
+	}
+	return result;
+}
+
+std::vector< std::pair<std::string, uint32_t> > BlockCompressedAlignment::extractWindowSorted(const size_t &windowStartPosition, const size_t &windowSize) const {
+	const auto windowCounts{this->extractWindow(windowStartPosition, windowSize)};
+	std::vector< std::pair<std::string, uint32_t> > result( windowCounts.cbegin(), windowCounts.cend() );
+	std::sort(result.begin(), result.end(), byCountThenSequence);
+	return result;
+}
+
+std::string BlockCompressedAlignment::consensusWindow(const size_t &windowStartPosition, const size_t &windowSize) const {
+	if (windowStartPosition >= alignmentLength_) {
+		throw std::string("ERROR: window start is past alignment length in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	return consensus_.substr(windowStartPosition, windowSize);
+}
+
+std::shared_ptr<const std::string> BlockCompressedAlignment::block_(const size_t &blockIdx) const {
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex_);
+		auto cacheIt = std::find_if( blockCache_.begin(), blockCache_.end(),
+			[&blockIdx](const std::pair< size_t, std::shared_ptr<const std::string> > &eachBlock){return eachBlock.first == blockIdx;} );
+		if ( cacheIt != blockCache_.end() ) {
+			std::rotate( blockCache_.begin(), cacheIt, cacheIt + 1 );
+			return blockCache_.front().second;
+		}
+	}
+	// decompress outside the lock so that other threads can use cached blocks meanwhile
+	auto residues = std::make_shared<const std::string>( this->decompressBlock_(blockIdx) );
+	std::lock_guard<std::mutex> lock(cacheMutex_);
+	auto cacheIt = std::find_if( blockCache_.begin(), blockCache_.end(),
+		[&blockIdx](const std::pair< size_t, std::shared_ptr<const std::string> > &eachBlock){return eachBlock.first == blockIdx;} );
+	if ( cacheIt == blockCache_.end() ) {
+		if (blockCache_.size() == cacheBlocks_) {
+			blockCache_.pop_back();
+		}
+		blockCache_.emplace( blockCache_.begin(), blockIdx, residues );
+	}
+	return residues;
+}
+
+std::string BlockCompressedAlignment::decompressBlock_(const size_t &blockIdx) const {
+	const size_t blockWidth = this->blockWidth_(blockIdx);
+	size_t position         = blockOffsets_[blockIdx];
+	const auto consensusIt  = consensus_.cbegin() + static_cast<std::ptrdiff_t>(blockIdx * blockSize_);
+	std::string result;
+	result.reserve( blockWidth * headers_.size() );
+	for (size_t iSeq = 0; iSeq < headers_.size(); ++iSeq) {
+		size_t iCol{0};
+		while (iCol < blockWidth) {
+			const size_t matchLength = readVarint(compressedBlocks_, position);
+			result.append( consensusIt + static_cast<std::ptrdiff_t>(iCol), consensusIt + static_cast<std::ptrdiff_t>(iCol + matchLength) );
+			iCol += matchLength;
+			const size_t differenceLength = readVarint(compressedBlocks_, position);
+			const auto differenceIt       = compressedBlocks_.cbegin() + static_cast<std::ptrdiff_t>(position);
+			result.append( differenceIt, differenceIt + static_cast<std::ptrdiff_t>(differenceLength) );
+			position += differenceLength;
+			iCol     += differenceLength;
+		}
+	}
+	return result;
+}
+
+void BlockCompressedAlignment::encodeSequence_(const std::string &sequence, std::vector< std::vector<uint8_t> > &blockBytes) const {
+	for (size_t iBlock = 0; iBlock < blockBytes.size(); ++iBlock) {
+		const size_t blockStart    = iBlock * blockSize_;
+		const size_t blockWidth    = this->blockWidth_(iBlock);
+		const char *blockResidues  = sequence.data() + blockStart;
+		const char *blockConsensus = consensus_.data() + blockStart;
+		size_t iCol{0};
+		while (iCol < blockWidth) {
+			const size_t matchStart = iCol;
+			while ( (iCol < blockWidth) && (blockResidues[iCol] == blockConsensus[iCol]) ) {
+				++iCol;
+			}
+			appendVarint(iCol - matchStart, blockBytes[iBlock]);
+			const size_t differenceStart = iCol;
+			while ( (iCol < blockWidth) && (blockResidues[iCol] != blockConsensus[iCol]) ) {
+				++iCol;
+			}
+			appendVarint(iCol - differenceStart, blockBytes[iBlock]);
+			blockBytes[iBlock].insert(blockBytes[iBlock].end(), blockResidues + differenceStart, blockResidues + iCol);
+		}
+	}
+}
+
+void BlockCompressedAlignment::storeBlocks_(std::vector< std::vector<uint8_t> > &blockBytes) {
+	size_t totalBytes{0};
+	for (const auto &eachBlock : blockBytes) {
+		totalBytes += eachBlock.size();
+	}
+	compressedBlocks_.clear();
+	compressedBlocks_.reserve(totalBytes);
+	blockOffsets_.clear();
+	blockOffsets_.reserve(blockBytes.size() + 1);
+	for (auto &eachBlock : blockBytes) {
+		blockOffsets_.push_back( compressedBlocks_.size() );
+		compressedBlocks_.insert( compressedBlocks_.end(), eachBlock.cbegin(), eachBlock.cend() );
+		std::vector<uint8_t>().swap(eachBlock);
+	}
+	blockOffsets_.push_back( compressedBlocks_.size() );
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Alignment to sequence coordinate conversion
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Implementation of a rank/select index that converts between alignment columns and ungapped sequence positions.
+ *
+ */
+
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "coordinateIndex.hpp"
+
+using namespace BayesicSpace;
+
+CoordinateIndex::CoordinateIndex(const std::string &alignedSequence) : alignmentLength_{alignedSequence.size()} {
+	const size_t nWords = (alignmentLength_ + wordSize_ - 1) / wordSize_;
+	residueBits_.resize(nWords, 0);
+	for (size_t iCol = 0; iCol < alignmentLength_; ++iCol) {
+		if (alignedSequence[iCol] != '-') {
+			residueBits_[iCol / wordSize_] |= 1ULL << (iCol % wordSize_);
+		}
+	}
+	// one extra rank entry so that rank queries at the alignment end need no special case
+	wordRanks_.reserve(nWords + 1);
+	uint32_t cumulativeCount{0};
+	for (size_t iWord = 0; iWord < nWords; ++iWord) {
+		wordRanks_.push_back(cumulativeCount);
+		const auto wordCount = static_cast<uint32_t>( __builtin_popcountll(residueBits_[iWord]) );
+		// record the word holding each sampled residue
+		for (size_t iSample = (cumulativeCount + selectSampleRate_ - 1) / selectSampleRate_ * selectSampleRate_; iSample < cumulativeCount + wordCount; iSample += selectSampleRate_) {
+			selectSamples_.push_back( static_cast<uint32_t>(iWord) );
+		}
+		cumulativeCount += wordCount;
+	}
+	wordRanks_.push_back(cumulativeCount);
+	sequenceLength_ = cumulativeCount;
+	// samples whose residues span too many words list their columns instead
+	sparseStarts_.reserve( selectSamples_.size() );
+	for (size_t iSample = 0; iSample < selectSamples_.size(); ++iSample) {
+		const size_t firstWord = selectSamples_[iSample];
+		const size_t lastWord  = iSample + 1 < selectSamples_.size() ? selectSamples_[iSample + 1] : nWords - 1;
+		if (lastWord - firstWord < maxSearchWords_) {
+			sparseStarts_.push_back( uint32_t{denseSample_} );
+			continue;
+		}
+		sparseStarts_.push_back( static_cast<uint32_t>( sparseColumns_.size() ) );
+		const size_t firstResidue = iSample * selectSampleRate_;
+		const size_t endResidue   = std::min(firstResidue + selectSampleRate_, sequenceLength_);
+		size_t residueIdx         = wordRanks_[firstWord];
+		for (size_t iWord = firstWord; (iWord <= lastWord) && (residueIdx < endResidue); ++iWord) {
+			uint64_t word = residueBits_[iWord];
+			while ( (word != 0) && (residueIdx < endResidue) ) {
+				if (residueIdx >= firstResidue) {
+					sparseColumns_.push_back( static_cast<uint32_t>( (iWord - firstWord) * wordSize_ + static_cast<size_t>( __builtin_ctzll(word) ) ) );
+				}
+				word &= word - 1;                                                                        // clear the lowest set bit
+				++residueIdx;
+			}
+		}
+	}
+}
+
+size_t CoordinateIndex::toSequencePosition(const size_t &alignmentColumn) const {
+	if (alignmentColumn > alignmentLength_) {
+		throw std::string("ERROR: alignment column past the alignment end in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const size_t wordIdx   = alignmentColumn / wordSize_;
+	const size_t bitOffset = alignmentColumn % wordSize_;
+	size_t result          = wordRanks_[wordIdx];
+	if (bitOffset > 0) {
+		result += static_cast<size_t>( __builtin_popcountll( residueBits_[wordIdx] & ( (1ULL << bitOffset) - 1 ) ) );
+	}
+	return result;
+}
+
+size_t CoordinateIndex::toAlignmentColumn(const size_t &sequencePosition) const {
+	if (sequencePosition >= sequenceLength_) {
+		throw std::string("ERROR: sequence position past the sequence end in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const size_t sampleIdx = sequencePosition / selectSampleRate_;
+	if (sparseStarts_[sampleIdx] != denseSample_) {
+		return static_cast<size_t>(selectSamples_[sampleIdx]) * wordSize_ + sparseColumns_[sparseStarts_[sampleIdx] + sequencePosition % selectSampleRate_];
+	}
+	// the answer lies between the words of the flanking select samples, at most maxSearchWords_ apart
+	const auto firstWord   = static_cast<std::vector<uint32_t>::difference_type>(selectSamples_[sampleIdx]);
+	const auto lastWord    = sampleIdx + 1 < selectSamples_.size() ? static_cast<std::vector<uint32_t>::difference_type>(selectSamples_[sampleIdx + 1]) + 1 :
+								static_cast<std::vector<uint32_t>::difference_type>( residueBits_.size() );
+	const auto wordIt      = std::upper_bound(wordRanks_.cbegin() + firstWord, wordRanks_.cbegin() + lastWord, sequencePosition) - 1;
+	const auto wordIdx     = static_cast<size_t>( std::distance(wordRanks_.cbegin(), wordIt) );
+	size_t remaining       = sequencePosition - *wordIt;
+	uint64_t word          = residueBits_[wordIdx];
+	while (remaining > 0) {
+		word &= word - 1;                                                                                // clear the lowest set bit
+		--remaining;
+	}
+	return wordIdx * wordSize_ + static_cast<size_t>( __builtin_ctzll(word) );
+}
+
+bool CoordinateIndex::isGap(const size_t &alignmentColumn) const {
+	if (alignmentColumn >= alignmentLength_) {
+		throw std::string("ERROR: alignment column past the alignment end in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	return ( residueBits_[alignmentColumn / wordSize_] & ( 1ULL << (alignmentColumn % wordSize_) ) ) == 0;
+}
@@ -30,11 +30,85 @@
 #include <array>
 #include <algorithm>
 #include <iterator>
+#include <sstream>
 
 #include "extraFunctions.hpp"
+#include "coordinateIndex.hpp"
+#include "featureIndex.hpp"
+#include "indelIndex.hpp"
 
 using namespace BayesicSpace;
 
+namespace {
+	/** \brief Compact haplotypes of a window
+	 *
+	 * \param[in] alignment the alignment
+	 * \param[in] windowStartPosition window start
+	 * \param[in] windowSize window size in base pairs
+	 * \param[in] plan window analysis plan
+	 * \param[in] sorted sort the haplotypes
+	 * \param[out] columns polymorphic column indexes
+	 * \param[out] consensus consensus residues at the polymorphic columns
+	 * \return haplotypes and their counts
+	 */
+	std::vector< std::pair<std::string, uint32_t> > polymorphicHaplotypes(const ParseFASTA &alignment, const size_t &windowStartPosition, const size_t &windowSize,
+																			const WindowPlan &plan, const bool &sorted, std::vector<size_t> &columns, std::string &consensus) {
+		columns = alignment.polymorphicColumns(windowStartPosition, windowSize);
+		consensus.clear();
+		for (const auto &iCol : columns) {
+			consensus += alignment.extractConsensusWindow(iCol, 1);
+		}
+		if (sorted) {
+			return alignment.extractPolymorphicWindowSorted(windowStartPosition, windowSize, plan);
+		}
+		std::unordered_map<std::string, uint32_t> haplotypeTable{alignment.extractPolymorphicWindow(windowStartPosition, windowSize, plan)};
+		return std::vector< std::pair<std::string, uint32_t> >( std::make_move_iterator( haplotypeTable.begin() ), std::make_move_iterator( haplotypeTable.end() ) );
+	}
+	/** \brief Write compact haplotypes
+	 *
+	 * Writes the position line, the consensus line with its mark, and the haplotypes.
+	 * With a non-empty coordinate index, positions are given in the indexed sequence.
+	 *
+	 * \param[in] haplotypes compact haplotypes and their counts
+	 * \param[in] columns polymorphic column indexes
+	 * \param[in] consensus consensus residues at the polymorphic columns
+	 * \param[in] sampleCoordinates coordinate index of the reference sample; empty for alignment positions
+	 * \param[in] consensusMark mark after the consensus
+	 * \param[in,out] outFile output stream
+	 */
+	void writePolymorphicHaplotypes(const std::vector< std::pair<std::string, uint32_t> > &haplotypes, const std::vector<size_t> &columns, const std::string &consensus,
+									const CoordinateIndex &sampleCoordinates, const std::string &consensusMark, std::fstream &outFile) {
+		if ( consensus.size() != columns.size() ) {
+			throw std::string("ERROR: consensus length must equal the number of polymorphic columns in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		const bool liftOver = sampleCoordinates.alignmentLength() > 0;
+		outFile << "#";
+		for (size_t iCol = 0; iCol < columns.size(); ++iCol) {
+			outFile << (iCol == 0 ? " " : ",");
+			if (!liftOver) {
+				outFile << columns[iCol] + 1;
+			} else if ( sampleCoordinates.isGap(columns[iCol]) ) {
+				// insertion relative to the reference sample: position of the preceding residue
+				outFile << sampleCoordinates.toSequencePosition(columns[iCol]) << "+";
+			} else {
+				outFile << sampleCoordinates.toSequencePosition(columns[iCol]) + 1;
+			}
+		}
+		outFile << "\n" << consensus << "\t" << consensusMark << "\n";
+		std::string diffs;
+		for (const auto &eachHaplotype : haplotypes) {
+			diffs.clear();
+			std::transform(
+				eachHaplotype.first.cbegin(), eachHaplotype.first.cend(),
+				consensus.cbegin(),
+				std::back_inserter(diffs),
+				[](unsigned char nuc1, unsigned char nuc2){return std::toupper(nuc1) == std::toupper(nuc2) ? '.' : std::toupper(nuc1);});
+			outFile << diffs << "\t" << eachHaplotype.second << "\n";
+		}
+	}
+}
+
 void BayesicSpace::parseCL(int &argc, char **argv, std::unordered_map<std::string, std::string> &cli) {
 	// set to true after encountering a flag token (the characters after the dash)
 	bool val = false;
@@ -63,10 +137,10 @@ void BayesicSpace::extractCLinfo(const std::unordered_map<std::string, std::stri
 	intVariables.clear();
 	stringVariables.clear();
 	const std::array<std::string, 2> requiredStringVariables{"input-file", "out-file"};
-	const std::array<std::string, 4> optionalStringVariables{"impute-missing", "out-format", "query-sequence", "sorted"};
-	const std::array<std::string, 3> optionalIntVariables{"start-position", "window-size", "step-size"};
-	const std::unordered_map<std::string, std::string> defaultStringValues{ {"impute-missing", "unset"}, {"out-format", "tab"}, {"query-sequence", "unset"}, {"sorted", "unset"} };
-	const std::unordered_map<std::string, int> defaultIntValues{ {"start-position", 1}, {"window-size", 100}, {"step-size", 10} };
+	const std::array<std::string, 27> optionalStringVariables{"engine", "feature-file", "feature-type", "forward-primer", "gap-encoded", "impute-missing", "indels", "long-query", "mask-file", "merge-compatible", "metrics-file", "motif", "new-sequences", "out-format", "pcr-table", "placement-report", "progressive", "protein-query", "query-cache", "query-sequence", "reference-sample", "region", "reorder-sequences", "reverse-primer", "select", "shard", "sorted"};
+	const std::array<std::string, 13> optionalIntVariables{"start-position", "window-size", "step-size", "max-mismatches", "max-amplicon", "threads", "max-variable", "min-gc", "max-gc", "max-regions", "max-missing", "hash-checkpoints", "block-size"};
+	const std::unordered_map<std::string, std::string> defaultStringValues{ {"engine", "auto"}, {"feature-file", "unset"}, {"feature-type", "unset"}, {"forward-primer", "unset"}, {"gap-encoded", "unset"}, {"impute-missing", "unset"}, {"indels", "unset"}, {"long-query", "unset"}, {"mask-file", "unset"}, {"merge-compatible", "unset"}, {"metrics-file", "unset"}, {"motif", "unset"}, {"new-sequences", "unset"}, {"out-format", "tab"}, {"pcr-table", "unset"}, {"placement-report", "unset"}, {"progressive", "unset"}, {"protein-query", "unset"}, {"query-cache", "unset"}, {"query-sequence", "unset"}, {"reference-sample", "unset"}, {"region", "unset"}, {"reorder-sequences", "unset"}, {"reverse-primer", "unset"}, {"select", "unset"}, {"shard", "unset"}, {"sorted", "unset"} };
+	const std::unordered_map<std::string, int> defaultIntValues{ {"start-position", 1}, {"window-size", 100}, {"step-size", 10}, {"max-mismatches", 0}, {"max-amplicon", 5000}, {"threads", 1}, {"max-variable", 0}, {"min-gc", 40}, {"max-gc", 60}, {"max-regions", 100}, {"max-missing", 100}, {"hash-checkpoints", 0}, {"block-size", 0} };
 
 	if ( parsedCLI.empty() ) {
 		throw std::string("No command line flags specified;");
@@ -103,6 +177,38 @@ void BayesicSpace::saveDiversityTable(const std::vector< std::pair< size_t, std:
 	}
 }
 
+void BayesicSpace::saveDiversityTable(const std::vector< std::pair< size_t, std::vector<uint32_t> > > &diversityTable, const std::vector<size_t> &unmaskedCounts, std::fstream &outFile) {
+	if ( unmaskedCounts.size() != diversityTable.size() ) {
+		throw std::string("ERROR: must have one unmasked column count per window in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	outFile << "position\tcount\tunmasked\n";
+	for (size_t iWindow = 0; iWindow < diversityTable.size(); ++iWindow) {
+		for (const auto &count : diversityTable[iWindow].second) {
+			outFile << diversityTable[iWindow].first + 1 << "\t" << count << "\t" << unmaskedCounts[iWindow] << "\n";
+		}
+	}
+}
+
+void BayesicSpace::saveDiversityTable(const std::vector< std::pair< size_t, std::vector<uint32_t> > > &diversityTable, const std::vector<size_t> &unmaskedCounts,
+										const std::vector<IndelWindowStatistics> &indelStatistics, std::fstream &outFile) {
+	const bool masked = !unmaskedCounts.empty();
+	if ( ( masked && ( unmaskedCounts.size() != diversityTable.size() ) ) || ( indelStatistics.size() != diversityTable.size() ) ) {
+		throw std::string("ERROR: must have one unmasked column count (if masked) and indel statistic per window in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	outFile << (masked ? "position\tcount\tunmasked\tindels\tmean_length\tmean_frequency\n" : "position\tcount\tindels\tmean_length\tmean_frequency\n");
+	for (size_t iWindow = 0; iWindow < diversityTable.size(); ++iWindow) {
+		for (const auto &count : diversityTable[iWindow].second) {
+			outFile << diversityTable[iWindow].first + 1 << "\t" << count;
+			if (masked) {
+				outFile << "\t" << unmaskedCounts[iWindow];
+			}
+			outFile << "\t" << indelStatistics[iWindow].indels << "\t" << indelStatistics[iWindow].meanLength << "\t" << indelStatistics[iWindow].meanFrequency << "\n";
+		}
+	}
+}
+
 void BayesicSpace::saveUniqueSequences(const std::unordered_map<std::string, uint32_t> &uniqueSequences, const std::string &consensus, const std::string &fileType, std::fstream &outFile) {
 	if (fileType == "fasta") {
 		uint32_t seqIdx{1};
@@ -244,3 +350,350 @@ void BayesicSpace::saveUniqueSequences(const std::vector< std::pair<std::string,
 			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
 	}
 }
+
+void BayesicSpace::savePolymorphicHaplotypes(const std::vector< std::pair<std::string, uint32_t> > &haplotypes, const std::vector<size_t> &columns, const std::string &consensus,
+												const CoordinateIndex &sampleCoordinates, std::fstream &outFile) {
+	writePolymorphicHaplotypes(haplotypes, columns, consensus, sampleCoordinates, "C", outFile);
+}
+
+void BayesicSpace::savePolymorphicHaplotypes(const std::vector< std::pair<std::string, uint32_t> > &haplotypes, const std::vector<size_t> &columns, const std::string &consensus,
+												const CoordinateIndex &sampleCoordinates, const AlignmentStatistics &alignStats, const std::string &query, std::fstream &outFile) {
+	outFile << query << "\t" << "Q\n";
+	writePolymorphicHaplotypes(haplotypes, columns, consensus, sampleCoordinates,
+		"C|" + std::to_string(alignStats.referenceStart) + "|" + std::to_string(alignStats.referenceLength), outFile);
+}
+
+void BayesicSpace::savePolymorphicWindow(const ParseFASTA &alignment, const size_t &windowStartPosition, const size_t &windowSize, const WindowPlan &plan, const bool &sorted,
+											const CoordinateIndex &sampleCoordinates, std::fstream &outFile) {
+	std::vector<size_t> columns;
+	std::string consensus;
+	const auto haplotypes = polymorphicHaplotypes(alignment, windowStartPosition, windowSize, plan, sorted, columns, consensus);
+	savePolymorphicHaplotypes(haplotypes, columns, consensus, sampleCoordinates, outFile);
+}
+
+void BayesicSpace::savePolymorphicWindow(const ParseFASTA &alignment, const size_t &windowStartPosition, const size_t &windowSize, const AlignmentStatistics &alignStats,
+											const std::string &query, const WindowPlan &plan, const bool &sorted, const CoordinateIndex &sampleCoordinates, std::fstream &outFile) {
+	std::vector<size_t> columns;
+	std::string consensus;
+	const auto haplotypes = polymorphicHaplotypes(alignment, windowStartPosition, windowSize, plan, sorted, columns, consensus);
+	savePolymorphicHaplotypes(haplotypes, columns, consensus, sampleCoordinates, alignStats, query, outFile);
+}
+
+void BayesicSpace::saveMotifHits(const std::vector<MotifHit> &motifHits, const ParseFASTA &alignment, std::fstream &outFile) {
+	outFile << "header\tsequence_position\talignment_position\n";
+	for (const auto &eachHit : motifHits) {
+		outFile << alignment.header(eachHit.sequenceIdx) << "\t" << eachHit.sequencePosition + 1 << "\t" << eachHit.alignmentColumn + 1 << "\n";
+	}
+}
+
+void BayesicSpace::savePCRresults(const std::vector<AmpliconResult> &pcrResults, const ParseFASTA &alignment, std::fstream &outFile) {
+	outFile << "header\tforward_position\tforward_mismatches\treverse_position\treverse_mismatches\tamplicon_length\tamplicon_start\tamplicon_end\n";
+	for (const auto &eachResult : pcrResults) {
+		outFile << alignment.header(eachResult.sequenceIdx);
+		if (eachResult.amplified) {
+			outFile << "\t" << eachResult.forwardPosition + 1 << "\t" << eachResult.forwardMismatches << "\t" << eachResult.reversePosition + 1 << "\t" <<
+				eachResult.reverseMismatches << "\t" << eachResult.ampliconLength << "\t" << eachResult.ampliconStartColumn + 1 << "\t" << eachResult.ampliconEndColumn + 1 << "\n";
+		} else {
+			outFile << "\tNA\tNA\tNA\tNA\tNA\tNA\tNA\n";
+		}
+	}
+}
+
+void BayesicSpace::saveConservedRegions(const std::vector<ConservedRegion> &regions, const ParseFASTA &alignment, const std::string &fileType, std::fstream &outFile) {
+	for (const auto &eachRegion : regions) {
+		outFile << "# Region start: " << eachRegion.start + 1 << ", length: " << eachRegion.length << ", variable sites: " << eachRegion.variableSites <<
+			", GC content: " << eachRegion.gcContent << "\n";
+		BayesicSpace::saveUniqueSequences(alignment.extractWindowSorted(eachRegion.start, eachRegion.length), alignment.extractConsensusWindow(eachRegion.start, eachRegion.length),
+			fileType, outFile);
+	}
+}
+
+void BayesicSpace::readSequences(const std::string &fastaFileName, std::vector< std::pair<std::string, std::string> > &sequences) {
+	sequences.clear();
+	std::fstream fastaFile;
+	fastaFile.open(fastaFileName, std::ios::in);
+	if ( !fastaFile.is_open() ) {
+		throw std::string("ERROR: cannot open file ") + fastaFileName + std::string(" in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	std::string fastaLine;
+	while ( std::getline(fastaFile, fastaLine) ) {
+		if ( fastaLine.empty() ) {
+			continue;
+		}
+		if (fastaLine[0] == '>') {
+			fastaLine.erase(0, 1);                                                                       // erase the ">" at the beginning
+			const auto firstNonSpace = fastaLine.find_first_not_of(' ');
+			if (firstNonSpace == std::string::npos) {
+				throw std::string("ERROR: some non-space characters required in a FASTA header in ") +
+					std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+			}
+			fastaLine.erase(0, firstNonSpace);
+			sequences.emplace_back(fastaLine, "");
+		} else if ( sequences.empty() ) {
+			throw std::string("ERROR: file ") + fastaFileName + std::string(" does not appear to be a FASTA file (no > on the first line) in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		} else {
+			sequences.back().second += fastaLine;
+		}
+	}
+	fastaFile.close();
+	if ( sequences.empty() ) {
+		throw std::string("ERROR: no sequences in file ") + fastaFileName + std::string(" in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+}
+
+void BayesicSpace::saveAlignment(const ParseFASTA &alignment, std::fstream &outFile) {
+	for (size_t iSeq = 0; iSeq < alignment.sequenceNumber(); ++iSeq) {
+		outFile << ">" << alignment.header(iSeq) << "\n";
+		outFile << alignment.sequence(iSeq) << "\n";
+	}
+}
+
+void BayesicSpace::savePlacementTable(const std::vector<PlacementStatistics> &placements, const std::vector< std::pair<std::string, std::string> > &newSequences, std::fstream &outFile) {
+	outFile << "header\tplaced_residues\tdropped_insertions\tclipped_residues\n";
+	for (size_t iSeq = 0; iSeq < placements.size(); ++iSeq) {
+		outFile << newSequences.at(iSeq).first << "\t" << placements[iSeq].placedResidues << "\t" << placements[iSeq].droppedInsertions << "\t" <<
+			placements[iSeq].clippedResidues << "\n";
+	}
+}
+
+void BayesicSpace::readBED(const std::string &bedFileName, std::vector< std::pair<size_t, size_t> > &intervals) {
+	intervals.clear();
+	std::fstream bedFile;
+	bedFile.open(bedFileName, std::ios::in);
+	if ( !bedFile.is_open() ) {
+		throw std::string("ERROR: cannot open file ") + bedFileName + std::string(" in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	std::string bedLine;
+	while ( std::getline(bedFile, bedLine) ) {
+		if ( bedLine.empty() || (bedLine[0] == '#') || (bedLine.compare(0, 5, "track") == 0) || (bedLine.compare(0, 7, "browser") == 0) ) {
+			continue;
+		}
+		std::stringstream lineStream(bedLine);
+		std::string chromName;
+		size_t start{0};
+		size_t end{0};
+		lineStream >> chromName >> start >> end;
+		if ( lineStream.fail() || (end <= start) ) {
+			throw std::string("ERROR: malformed BED line '") + bedLine + std::string("' in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		intervals.emplace_back(start, end);
+	}
+	bedFile.close();
+}
+
+void BayesicSpace::applyBEDmask(const std::string &bedFileName, const std::string &referenceSample, ParseFASTA &alignment) {
+	std::vector< std::pair<size_t, size_t> > intervals;
+	BayesicSpace::readBED(bedFileName, intervals);
+	if (referenceSample != "unset") {
+		const CoordinateIndex sampleCoordinates{alignment.coordinateIndex(referenceSample)};
+		for (auto &eachInterval : intervals) {
+			if ( eachInterval.second > sampleCoordinates.sequenceLength() ) {
+				throw std::string("ERROR: BED interval extends past the end of the reference sample in ") +
+					std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+			}
+			const size_t endColumn = sampleCoordinates.toAlignmentColumn(eachInterval.second - 1) + 1;
+			eachInterval.first     = sampleCoordinates.toAlignmentColumn(eachInterval.first);
+			eachInterval.second    = endColumn;
+		}
+	}
+	alignment.maskColumns(intervals);
+}
+
+void BayesicSpace::readFeatures(const std::string &featureFileName, const std::string &featureType, std::vector<GenomicFeature> &features) {
+	features.clear();
+	std::fstream featureFile;
+	featureFile.open(featureFileName, std::ios::in);
+	if ( !featureFile.is_open() ) {
+		throw std::string("ERROR: cannot open file ") + featureFileName + std::string(" in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const auto extensionPos = featureFileName.find_last_of('.');
+	const std::string extension = extensionPos == std::string::npos ? std::string() : featureFileName.substr(extensionPos);
+	const bool isGFF            = (extension == ".gff") || (extension == ".gff3") || (extension == ".gtf");
+	std::string featureLine;
+	while ( std::getline(featureFile, featureLine) ) {
+		if ( featureLine.empty() || (featureLine[0] == '#') || (featureLine.compare(0, 5, "track") == 0) || (featureLine.compare(0, 7, "browser") == 0) ) {
+			continue;
+		}
+		std::vector<std::string> fields;
+		std::stringstream lineStream(featureLine);
+		std::string field;
+		while ( std::getline(lineStream, field, '\t') ) {
+			fields.push_back(field);
+		}
+		GenomicFeature feature{};
+		try {
+			if (isGFF) {
+				// GFF and GTF: 1-based closed intervals, type in column 3, name in the attributes
+				constexpr size_t nGFFfields{9};
+				if (fields.size() < nGFFfields) {
+					throw std::string("too few fields");
+				}
+				feature.type  = fields[2];
+				feature.start = std::stoul(fields[3]) - 1;
+				feature.end   = std::stoul(fields[4]);
+				for (const auto &nameKey : {std::string("ID="), std::string("Name="), std::string("gene_id \"")}) {
+					const auto keyPos = fields[8].find(nameKey);
+					if (keyPos != std::string::npos) {
+						const size_t nameStart = keyPos + nameKey.size();
+						feature.name = fields[8].substr( nameStart, fields[8].find_first_of(";\"", nameStart) - nameStart );
+						break;
+					}
+				}
+			} else {
+				// BED: 0-based half-open intervals, optional name in column 4
+				constexpr size_t nBEDfields{3};
+				if (fields.size() < nBEDfields) {
+					throw std::string("too few fields");
+				}
+				feature.start = std::stoul(fields[1]);
+				feature.end   = std::stoul(fields[2]);
+				feature.name  = fields.size() > nBEDfields ? fields[nBEDfields] : std::string();
+				feature.type  = "region";
+			}
+		} catch (const std::exception &problem) {
+			throw std::string("ERROR: malformed feature line '") + featureLine + std::string("' in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		} catch (const std::string &problem) {
+			throw std::string("ERROR: malformed feature line '") + featureLine + std::string("' (") + problem + std::string(") in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		if ( (featureType != "unset") && (feature.type != featureType) ) {
+			continue;
+		}
+		if ( feature.name.empty() ) {
+			feature.name = feature.type + ":" + std::to_string(feature.start + 1) + "-" + std::to_string(feature.end);
+		}
+		features.push_back( std::move(feature) );
+	}
+	featureFile.close();
+}
+
+void BayesicSpace::saveFeatureStatistics(const std::vector<FeatureStatistics> &featureStats, const FeatureIndex &features, std::fstream &outFile) {
+	outFile << "name\ttype\tstart\tend\tunmasked\tvariable_sites\thaplotypes\tpi\n";
+	for (const auto &eachStat : featureStats) {
+		const GenomicFeature &feature = features.feature(eachStat.featureIdx);
+		outFile << feature.name << "\t" << feature.type << "\t" << feature.start + 1 << "\t" << feature.end << "\t" << eachStat.unmaskedColumns << "\t" <<
+			eachStat.variableSites << "\t" << eachStat.haplotypes << "\t" << eachStat.nucleotideDiversity << "\n";
+	}
+}
+
+WindowEngine BayesicSpace::parseWindowEngine(const std::string &engineName) {
+	if (engineName == "auto") {
+		return WindowEngine::automatic;
+	}
+	if (engineName == "hash") {
+		return WindowEngine::hash;
+	}
+	if (engineName == "projection") {
+		return WindowEngine::projection;
+	}
+	if (engineName == "packed") {
+		return WindowEngine::packed;
+	}
+	if (engineName == "prefix-hash") {
+		return WindowEngine::prefixHash;
+	}
+	throw std::string("ERROR: unknown window engine '") + engineName + std::string("' (must be auto, hash, projection, packed, or prefix-hash) in ") +
+		std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+}
+
+std::string BayesicSpace::describeWindowPlan(const WindowPlan &plan) {
+	std::string engineName("hash");
+	if (plan.engine == WindowEngine::projection) {
+		engineName = "projection";
+	} else if (plan.engine == WindowEngine::packed) {
+		engineName = "packed";
+	} else if (plan.engine == WindowEngine::prefixHash) {
+		engineName = "prefix-hash";
+	}
+	std::stringstream planStream;
+	planStream << "window engine " << engineName << ", " << plan.threads <<
+		(plan.threads == 1 ? " thread" : " threads") << " (polymorphic column fraction " << plan.polymorphicFraction <<
+		", duplication rate " << plan.duplicationRate << ")";
+	return planStream.str();
+}
+
+void BayesicSpace::parseShard(const std::string &shardSpecification, size_t &shardIdx, size_t &shardNumber) {
+	const size_t slashPosition = shardSpecification.find('/');
+	const std::string digits("0123456789");
+	if ( (slashPosition == 0) || (slashPosition == std::string::npos) || (slashPosition + 1 == shardSpecification.size() ) ||
+			(shardSpecification.find_first_not_of(digits) != slashPosition) || (shardSpecification.find_first_not_of(digits, slashPosition + 1) != std::string::npos) ) {
+		throw std::string("ERROR: shard must be specified as i/N, got '") + shardSpecification + std::string("' in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	shardIdx    = std::stoul( shardSpecification.substr(0, slashPosition) );
+	shardNumber = std::stoul( shardSpecification.substr(slashPosition + 1) );
+	if ( (shardIdx == 0) || (shardIdx > shardNumber) ) {
+		throw std::string("ERROR: shard index must be between 1 and the number of shards in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+}
+
+std::pair<size_t, size_t> BayesicSpace::parseRegion(const std::string &regionSpecification) {
+	const size_t dashPosition = regionSpecification.find('-');
+	const std::string digits("0123456789");
+	if ( (dashPosition == 0) || (dashPosition == std::string::npos) || (dashPosition + 1 == regionSpecification.size() ) ||
+			(regionSpecification.find_first_not_of(digits) != dashPosition) || (regionSpecification.find_first_not_of(digits, dashPosition + 1) != std::string::npos) ) {
+		throw std::string("ERROR: region must be specified as start-end, got '") + regionSpecification + std::string("' in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const size_t regionStart = std::stoul( regionSpecification.substr(0, dashPosition) );
+	const size_t regionEnd   = std::stoul( regionSpecification.substr(dashPosition + 1) );
+	if ( (regionStart == 0) || (regionStart > regionEnd) ) {
+		throw std::string("ERROR: region start must be between 1 and the region end in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	return std::pair<size_t, size_t>{regionStart - 1, regionEnd};
+}
+
+std::pair<size_t, size_t> BayesicSpace::shardColumnRange(const size_t &shardIdx, const size_t &shardNumber, const size_t &alignmentLength, const size_t &windowSize, const size_t &stepSize) {
+	if ( (shardIdx == 0) || (shardIdx > shardNumber) || (windowSize == 0) || (stepSize == 0) ) {
+		throw std::string("ERROR: shard index must be between 1 and the number of shards, window and step sizes must be positive in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	// same windows as ParseFASTA::diversityInWindows(): start at multiples of the step, end before the last column
+	const size_t windowNumber = alignmentLength > windowSize ? (alignmentLength - windowSize - 1) / stepSize + 1 : 0;
+	const size_t firstWindow  = windowNumber * (shardIdx - 1) / shardNumber;
+	const size_t endWindow    = windowNumber * shardIdx / shardNumber;
+	if (firstWindow == endWindow) {
+		return std::pair<size_t, size_t>{0, 0};
+	}
+	const size_t firstColumn = firstWindow * stepSize;
+	// one column past the last window keeps the window end condition identical to the whole-alignment scan
+	const size_t endColumn   = (endWindow - 1) * stepSize + windowSize + 1;
+	return std::pair<size_t, size_t>{firstColumn, endColumn - firstColumn};
+}
+
+void BayesicSpace::mergeShardTables(const std::vector<std::string> &shardFileNames, std::fstream &outFile) {
+	std::string headerLine;
+	for (const auto &eachFileName : shardFileNames) {
+		std::fstream shardFile;
+		shardFile.open(eachFileName, std::ios::in);
+		if ( !shardFile.is_open() ) {
+			throw std::string("ERROR: cannot open shard file ") + eachFileName + std::string(" in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		std::string shardLine;
+		if ( !std::getline(shardFile, shardLine) ) {
+			throw std::string("ERROR: shard file ") + eachFileName + std::string(" has no header line in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		if ( headerLine.empty() ) {
+			headerLine = shardLine;
+			outFile << headerLine << "\n";
+		} else if (shardLine != headerLine) {
+			throw std::string("ERROR: header of shard file ") + eachFileName + std::string(" does not match the first shard in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		while ( std::getline(shardFile, shardLine) ) {
+			outFile << shardLine << "\n";
+		}
+		shardFile.close();
+	}
+}
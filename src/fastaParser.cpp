@@ -30,58 +30,547 @@
 #include <iterator>
 #include <vector>
 #include <unordered_map>
+#include <set>
 #include <utility> // for std::pair
 #include <string>
 #include <fstream>
+#include <sstream>
 #include <algorithm>
+#include <array>
+#include <numeric>
+#include <thread>
+#include <functional>
+#include <cctype>
+#include <cmath>
+#include <limits>
 
 #include "fastaParser.hpp"
+#include "coordinateIndex.hpp"
+#include "queryCache.hpp"
 #include "ssw_cpp.h"
 
 #include <iostream>
 
 using namespace BayesicSpace;
 
-ParseFASTA::ParseFASTA(const std::string &fastaFileName) {
-	std::fstream fastaFile;
-	std::string fastaLine;
-	fastaFile.open(fastaFileName, std::ios::in);
-	// get the first line and examine it (skip any empty lines)
-	while ( std::getline(fastaFile, fastaLine) && fastaLine.empty() ) {
+namespace {
+	// striped Smith-Waterman scoring parameters (the library defaults)
+	constexpr uint8_t swMatchScore{2};
+	constexpr uint8_t swMismatchPenalty{2};
+	constexpr uint8_t swGapOpenPenalty{3};
+	constexpr uint8_t swGapExtendPenalty{1};
+	constexpr int32_t swMinMaskLen{15};
+	// protein Smith-Waterman gap penalties for BLOSUM62
+	constexpr uint8_t proteinGapOpenPenalty{11};
+	constexpr uint8_t proteinGapExtendPenalty{1};
+
+	/** \brief Amino acid alphabet in BLOSUM62 matrix order */
+	const std::string blosumAlphabet("ARNDCQEGHILKMFPSTWYVBZX*");
+	constexpr int32_t blosumSize{24};
+	constexpr int32_t asciiSize{128};
+	/** \brief BLOSUM62 substitution matrix */
+	constexpr std::array<int8_t, 576> blosum62{
+	//  A   R   N   D   C   Q   E   G   H   I   L   K   M   F   P   S   T   W   Y   V   B   Z   X   *
+		 4, -1, -2, -2,  0, -1, -1,  0, -2, -1, -1, -1, -1, -2, -1,  1,  0, -3, -2,  0, -2, -1,  0, -4, // A
+		-1,  5,  0, -2, -3,  1,  0, -2,  0, -3, -2,  2, -1, -3, -2, -1, -1, -3, -2, -3, -1,  0, -1, -4, // R
+		-2,  0,  6,  1, -3,  0,  0,  0,  1, -3, -3,  0, -2, -3, -2,  1,  0, -4, -2, -3,  3,  0, -1, -4, // N
+		-2, -2,  1,  6, -3,  0,  2, -1, -1, -3, -4, -1, -3, -3, -1,  0, -1, -4, -3, -3,  4,  1, -1, -4, // D
+		 0, -3, -3, -3,  9, -3, -4, -3, -3, -1, -1, -3, -1, -2, -3, -1, -1, -2, -2, -1, -3, -3, -2, -4, // C
+		-1,  1,  0,  0, -3,  5,  2, -2,  0, -3, -2,  1,  0, -3, -1,  0, -1, -2, -1, -2,  0,  3, -1, -4, // Q
+		-1,  0,  0,  2, -4,  2,  5, -2,  0, -3, -3,  1, -2, -3, -1,  0, -1, -3, -2, -2,  1,  4, -1, -4, // E
+		 0, -2,  0, -1, -3, -2, -2,  6, -2, -4, -4, -2, -3, -3, -2,  0, -2, -2, -3, -3, -1, -2, -1, -4, // G
+		-2,  0,  1, -1, -3,  0,  0, -2,  8, -3, -3, -1, -2, -1, -2, -1, -2, -2,  2, -3,  0,  0, -1, -4, // H
+		-1, -3, -3, -3, -1, -3, -3, -4, -3,  4,  2, -3,  1,  0, -3, -2, -1, -3, -1,  3, -3, -3, -1, -4, // I
+		-1, -2, -3, -4, -1, -2, -3, -4, -3,  2,  4, -2,  2,  0, -3, -2, -1, -2, -1,  1, -4, -3, -1, -4, // L
+		-1,  2,  0, -1, -3,  1,  1, -2, -1, -3, -2,  5, -1, -3, -1,  0, -1, -3, -2, -2,  0,  1, -1, -4, // K
+		-1, -1, -2, -3, -1,  0, -2, -3, -2,  1,  2, -1,  5,  0, -2, -1, -1, -1, -1,  1, -3, -1, -1, -4, // M
+		-2, -3, -3, -3, -2, -3, -3, -3, -1,  0,  0, -3,  0,  6, -4, -2, -2,  1,  3, -1, -3, -3, -1, -4, // F
+		-1, -2, -2, -1, -3, -1, -1, -2, -2, -3, -3, -1, -2, -4,  7, -1, -1, -4, -3, -2, -2, -1, -2, -4, // P
+		 1, -1,  1,  0, -1,  0,  0,  0, -1, -2, -2,  0, -1, -2, -1,  4,  1, -3, -2, -2,  0,  0,  0, -4, // S
+		 0, -1,  0, -1, -1, -1, -1, -2, -2, -1, -1, -1, -1, -2, -1,  1,  5, -2, -2,  0, -1, -1,  0, -4, // T
+		-3, -3, -4, -4, -2, -2, -3, -2, -2, -3, -2, -3, -1,  1, -4, -3, -2, 11,  2, -3, -4, -3, -2, -4, // W
+		-2, -2, -2, -3, -2, -1, -2, -3,  2, -1, -1, -2, -1,  3, -3, -2, -2,  2,  7, -1, -3, -2, -1, -4, // Y
+		 0, -3, -3, -3, -1, -2, -2, -3, -3,  3,  1, -2,  1, -1, -2, -2,  0, -3, -1,  4, -3, -2, -1, -4, // V
+		-2, -1,  3,  4, -3,  0,  1, -1,  0, -3, -4,  0, -3, -3, -2,  0, -1, -4, -3, -3,  4,  1, -1, -4, // B
+		-1,  0,  0,  1, -3,  3,  4, -2,  0, -3, -3,  1, -1, -3, -1,  0, -1, -3, -2, -2,  1,  4, -1, -4, // Z
+		 0, -1, -1, -1, -2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -2,  0,  0, -2, -1, -1, -1, -1, -1, -4, // X
+		-4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4,  1  // *
+	};
+	/** \brief Standard genetic code
+	 *
+	 * Codons are indexed as 16 * first + 4 * second + third, with nucleotides in TCAG order.
+	 */
+	const std::string geneticCode("FFLLSSSSYY**CC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG");
+
+	/** \brief Translate a nucleotide sequence
+	 *
+	 * Codons with non-ACGT nucleotides translate to X.
+	 *
+	 * \param[in] nucleotides nucleotide sequence
+	 * \param[in] frame reading frame offset (0, 1, or 2)
+	 * \return amino acid sequence
+	 */
+	std::string translate(const std::string &nucleotides, const size_t &frame) {
+		constexpr size_t codonLength{3};
+		const std::string tcag("TCAG");
+		std::string protein;
+		protein.reserve(nucleotides.size() / codonLength);
+		for (size_t iCodon = frame; iCodon + codonLength <= nucleotides.size(); iCodon += codonLength) {
+			size_t codonIdx{0};
+			for (size_t iNuc = iCodon; iNuc < iCodon + codonLength; ++iNuc) {
+				const auto nucPos = tcag.find( static_cast<char>( std::toupper( static_cast<unsigned char>(nucleotides[iNuc]) ) ) );
+				if (nucPos == std::string::npos) {
+					codonIdx = geneticCode.size();
+					break;
+				}
+				codonIdx = codonIdx * tcag.size() + nucPos;
+			}
+			protein.push_back(codonIdx < geneticCode.size() ? geneticCode[codonIdx] : 'X');
+		}
+		return protein;
 	}
-	if ( fastaLine.empty() || fastaFile.eof() ) {
-		throw std::string("ERROR: all lines in ") + fastaFileName + std::string(" are empty in ") +
-			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+
+	// minimizer seeding and chaining parameters for long queries
+	constexpr size_t minimizerK{15};
+	constexpr size_t minimizerW{10};
+	constexpr size_t maxSeedOccurrences{64};
+	constexpr size_t chainLookback{50};
+	constexpr size_t chainMaxGap{5000};
+	constexpr size_t chainBandwidth{500};
+	constexpr size_t extensionBand{64};
+	constexpr int32_t extensionXdrop{100};
+
+	/** \brief Invertible 64-bit integer hash
+	 *
+	 * Scrambles packed k-mers so that minimizers are not biased towards low-complexity sequence.
+	 *
+	 * \param[in] key value to hash
+	 * \param[in] mask bit mask for the k-mer width
+	 * \return hashed value
+	 */
+	uint64_t kmerHash(uint64_t key, const uint64_t &mask) noexcept {
+		key = (~key + (key << 21)) & mask;
+		key = key ^ (key >> 24);
+		key = ( (key + (key << 3)) + (key << 8) ) & mask;
+		key = key ^ (key >> 14);
+		key = ( (key + (key << 2)) + (key << 4) ) & mask;
+		key = key ^ (key >> 28);
+		key = (key + (key << 31)) & mask;
+		return key;
+	}
+
+	/** \brief Sequence minimizers
+	 *
+	 * (w, k)-minimizers of a nucleotide sequence: the smallest hashed k-mer in each run of w consecutive k-mers.
+	 * K-mers with non-ACGT characters are skipped.
+	 *
+	 * \param[in] sequence nucleotide sequence
+	 * \return vector of minimizer hashes and k-mer start positions
+	 */
+	std::vector< std::pair<uint64_t, size_t> > minimizers(const std::string &sequence) {
+		constexpr uint64_t invalidKmer{std::numeric_limits<uint64_t>::max()};
+		constexpr uint64_t bitsPerNuc{2};
+		const uint64_t mask{(1ULL << (bitsPerNuc * minimizerK)) - 1};
+		std::vector< std::pair<uint64_t, size_t> > result;
+		if (sequence.size() < minimizerK) {
+			return result;
+		}
+		const size_t nKmers = sequence.size() - minimizerK + 1;
+		std::vector<uint64_t> kmerHashes(nKmers, invalidKmer);
+		uint64_t packedKmer{0};
+		size_t validLength{0};
+		for (size_t iNuc = 0; iNuc < sequence.size(); ++iNuc) {
+			uint64_t code{0};
+			switch ( std::toupper( static_cast<unsigned char>(sequence[iNuc]) ) ) {
+				case 'A': code = 0; break;
+				case 'C': code = 1; break;
+				case 'G': code = 2; break;
+				case 'T': code = 3; break;
+				default:  code = invalidKmer;
+			}
+			if (code == invalidKmer) {
+				validLength = 0;
+				packedKmer  = 0;
+				continue;
+			}
+			packedKmer = ( (packedKmer << bitsPerNuc) | code ) & mask;
+			++validLength;
+			if (validLength >= minimizerK) {
+				kmerHashes[iNuc + 1 - minimizerK] = kmerHash(packedKmer, mask);
+			}
+		}
+		const size_t windowSpan = std::min(minimizerW, nKmers);
+		size_t lastPosition{nKmers};
+		for (size_t iWindow = 0; iWindow + windowSpan <= nKmers; ++iWindow) {
+			size_t minPosition{iWindow};
+			for (size_t iKmer = iWindow + 1; iKmer < iWindow + windowSpan; ++iKmer) {
+				if (kmerHashes[iKmer] < kmerHashes[minPosition]) {
+					minPosition = iKmer;
+				}
+			}
+			if ( (kmerHashes[minPosition] != invalidKmer) && (minPosition != lastPosition) ) {
+				result.emplace_back(kmerHashes[minPosition], minPosition);
+				lastPosition = minPosition;
+			}
+		}
+		return result;
+	}
+
+	/** \brief Banded extension alignment
+	 *
+	 * Extends an alignment from the start of both sequences with linear gap penalties, restricted to a diagonal band and stopped by an X-drop rule.
+	 * Scores follow the nucleotide Smith-Waterman parameters.
+	 *
+	 * \param[in] query query segment, starting at the alignment boundary
+	 * \param[in] reference reference segment, starting at the alignment boundary
+	 * \return numbers of query and reference residues in the best-scoring extension
+	 */
+	std::pair<size_t, size_t> bandedExtension(const std::string &query, const std::string &reference) {
+		constexpr int32_t negativeInfinity{std::numeric_limits<int32_t>::min() / 2};
+		const int32_t match{swMatchScore};
+		const int32_t mismatch{-static_cast<int32_t>(swMismatchPenalty)};
+		const int32_t gap{-static_cast<int32_t>(swGapOpenPenalty)};
+		const size_t bandWidth{2 * extensionBand + 1};
+		// row-wise DP over query positions; column j of the band corresponds to reference position i + j - extensionBand
+		std::vector<int32_t> previousRow(bandWidth, negativeInfinity);
+		std::vector<int32_t> currentRow(bandWidth, negativeInfinity);
+		std::pair<size_t, size_t> best{0, 0};
+		int32_t bestScore{0};
+		for (size_t iBand = extensionBand; (iBand < bandWidth) && (iBand - extensionBand <= reference.size()); ++iBand) {
+			previousRow[iBand] = gap * static_cast<int32_t>(iBand - extensionBand);
+		}
+		for (size_t iQuery = 1; iQuery <= query.size(); ++iQuery) {
+			int32_t rowMax{negativeInfinity};
+			std::fill(currentRow.begin(), currentRow.end(), negativeInfinity);
+			for (size_t iBand = 0; iBand < bandWidth; ++iBand) {
+				if (iQuery + iBand < extensionBand) {
+					continue;
+				}
+				const size_t iRef = iQuery + iBand - extensionBand;
+				if ( iRef > reference.size() ) {
+					break;
+				}
+				int32_t cellScore{negativeInfinity};
+				// vertical move (gap in reference) comes from the same reference position in the previous row
+				if ( (iBand + 1 < bandWidth) && (previousRow[iBand + 1] > negativeInfinity) ) {
+					cellScore = previousRow[iBand + 1] + gap;
+				}
+				if (iRef > 0) {
+					if (previousRow[iBand] > negativeInfinity) {
+						const bool isMatch = std::toupper( static_cast<unsigned char>(query[iQuery - 1]) ) == std::toupper( static_cast<unsigned char>(reference[iRef - 1]) );
+						cellScore          = std::max(cellScore, previousRow[iBand] + (isMatch ? match : mismatch) );
+					}
+					if ( (iBand > 0) && (currentRow[iBand - 1] > negativeInfinity) ) {
+						cellScore = std::max(cellScore, currentRow[iBand - 1] + gap);
+					}
+				}
+				currentRow[iBand] = cellScore;
+				rowMax            = std::max(rowMax, cellScore);
+				if (cellScore > bestScore) {
+					bestScore = cellScore;
+					best      = std::make_pair(iQuery, iRef);
+				}
+			}
+			if (rowMax < bestScore - extensionXdrop) {
+				break;
+			}
+			std::swap(previousRow, currentRow);
+		}
+		return best;
+	}
+
+	/** \brief Reverse complement of a nucleotide sequence
+	 *
+	 * Non-ACGT characters are kept as is.
+	 *
+	 * \param[in] nucleotides nucleotide sequence
+	 * \return reverse complement
+	 */
+	std::string reverseComplement(const std::string &nucleotides) {
+		std::string result;
+		result.reserve( nucleotides.size() );
+		std::transform(nucleotides.crbegin(), nucleotides.crend(), std::back_inserter(result),
+			[](unsigned char nuc){
+				switch ( std::toupper(nuc) ) {
+					case 'A': return 'T';
+					case 'C': return 'G';
+					case 'G': return 'C';
+					case 'T': return 'A';
+					default:  return static_cast<char>(nuc);
+				}
+			});
+		return result;
+	}
+
+	constexpr uint64_t fnvOffsetBasis{0xcbf29ce484222325ULL};
+	constexpr uint64_t fnvPrime{0x100000001b3ULL};
+	/** \brief FNV-1a hash update
+	 *
+	 * \param[in] toHash string to add to the hash
+	 * \param[in] hash current hash value
+	 * \return updated hash
+	 */
+	uint64_t fnv1aUpdate(const std::string &toHash, uint64_t hash) noexcept {
+		for (const auto &eachChar : toHash) {
+			hash ^= static_cast<unsigned char>(eachChar);
+			hash *= fnvPrime;
+		}
+		// separator so that concatenations of different strings do not collide
+		hash ^= 0xFFULL;
+		hash *= fnvPrime;
+		return hash;
+	}
+
+	// bits per word of column bit vectors
+	constexpr size_t wordSize{64};
+	// residues per word of packed window keys
+	constexpr size_t residuesPerWord{32};
+
+	// Mersenne prime modulus and the two bases of the prefix hashes
+	constexpr uint64_t hashModulus{(1ULL << 61) - 1};
+	constexpr std::array<uint64_t, 2> hashBases{911382323ULL, 972663749ULL};
+
+	/** \brief Multiply modulo the Mersenne prime 2^61 - 1
+	 *
+	 * Splits the factors at bit 31 so that no partial product overflows 64 bits.
+	 *
+	 * \param[in] first first factor, less than the modulus
+	 * \param[in] second second factor, less than the modulus
+	 * \return product modulo 2^61 - 1
+	 */
+	uint64_t mulMod61(const uint64_t &first, const uint64_t &second) noexcept {
+		constexpr uint64_t mask30{(1ULL << 30) - 1};
+		constexpr uint64_t mask31{(1ULL << 31) - 1};
+		const uint64_t firstHigh  = first >> 31;
+		const uint64_t firstLow   = first & mask31;
+		const uint64_t secondHigh = second >> 31;
+		const uint64_t secondLow  = second & mask31;
+		const uint64_t middle     = firstLow * secondHigh + firstHigh * secondLow;
+		const uint64_t product    = firstHigh * secondHigh * 2 + (middle >> 30) + ( (middle & mask30) << 31 ) + firstLow * secondLow;
+		const uint64_t reduced    = (product >> 61) + (product & hashModulus);
+		return reduced >= hashModulus ? reduced - hashModulus : reduced;
+	}
+	/** \brief Powers of the prefix-hash bases
+	 *
+	 * Computed by squaring and multiplying, in time logarithmic in the exponent.
+	 *
+	 * \param[in] exponent power to raise the bases to
+	 * \return each base raised to `exponent`, modulo 2^61 - 1
+	 */
+	std::array<uint64_t, 2> hashPower(size_t exponent) noexcept {
+		std::array<uint64_t, 2> result{{1, 1}};
+		std::array<uint64_t, 2> square{hashBases};
+		while (exponent > 0) {
+			if ( (exponent & 1) != 0 ) {
+				for (size_t iBase = 0; iBase < hashBases.size(); ++iBase) {
+					result[iBase] = mulMod61(result[iBase], square[iBase]);
+				}
+			}
+			for (size_t iBase = 0; iBase < hashBases.size(); ++iBase) {
+				square[iBase] = mulMod61(square[iBase], square[iBase]);
+			}
+			exponent >>= 1;
+		}
+		return result;
+	}
+	/** \brief Append a residue to a polynomial hash
+	 *
+	 * \param[in] hash hash of the preceding residues
+	 * \param[in] residue residue to append
+	 * \param[in] base hash base
+	 * \return updated hash
+	 */
+	uint64_t appendResidue(const uint64_t &hash, const char &residue, const uint64_t &base) noexcept {
+		const uint64_t extended = mulMod61(hash, base) + static_cast<uint64_t>( static_cast<unsigned char>(residue) ) + 1;
+		return extended >= hashModulus ? extended - hashModulus : extended;
+	}
+	/** \brief Hash of packed window keys */
+	struct PackedKeyHash {
+		/** \brief Hash a key
+		 *
+		 * \tparam nWords number of key words
+		 * \param[in] key packed key
+		 * \return hash value
+		 */
+		template <size_t nWords>
+		size_t operator()(const std::array<uint64_t, nWords> &key) const noexcept {
+			// multiplicative (Fibonacci) hashing of each word in turn
+			constexpr uint64_t goldenRatio{0x9E3779B97F4A7C15ULL};
+			uint64_t hash{0};
+			for (const auto &eachWord : key) {
+				hash = (hash ^ eachWord) * goldenRatio;
+				hash ^= hash >> 32;
+			}
+			return hash;
+		}
+	};
+	/** \brief Two-bit nucleotide code
+	 *
+	 * \param[in] residue nucleotide
+	 * \return 0 to 3 for A, C, G, T; 4 for anything else, including lower case
+	 */
+	uint64_t twoBitCode(const char &residue) noexcept {
+		switch (residue) {
+			case 'A':
+				return 0;
+			case 'C':
+				return 1;
+			case 'G':
+				return 2;
+			case 'T':
+				return 3;
+			default:
+				return 4;
+		}
 	}
-	if (fastaLine[0] != '>') {
-		throw std::string("ERROR: file ") + fastaFileName + std::string(" does not appear to be a FASTA file (no > on the first line) in ") +
+}
+
+std::vector<FastaIndexRecord> BayesicSpace::indexFASTA(const std::string &fastaFileName) {
+	std::vector<FastaIndexRecord> result;
+	std::fstream indexFile;
+	indexFile.open(fastaFileName + ".fai", std::ios::in);
+	if ( indexFile.is_open() ) {
+		std::string indexLine;
+		while ( std::getline(indexFile, indexLine) ) {
+			if ( indexLine.empty() ) {
+				continue;
+			}
+			std::stringstream lineStream(indexLine);
+			FastaIndexRecord record{};
+			std::getline(lineStream, record.name, '\t');
+			lineStream >> record.length >> record.offset >> record.lineBases >> record.lineBytes;
+			if ( lineStream.fail() || (record.lineBases == 0) || (record.lineBytes <= record.lineBases) ) {
+				throw std::string("ERROR: malformed index line '") + indexLine + std::string("' in ") +
+					std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+			}
+			result.push_back( std::move(record) );
+		}
+		indexFile.close();
+		return result;
+	}
+	std::fstream fastaFile;
+	fastaFile.open(fastaFileName, std::ios::in | std::ios::binary);
+	if ( !fastaFile.is_open() ) {
+		throw std::string("ERROR: cannot open file ") + fastaFileName + std::string(" in ") +
 			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
 	}
-	fastaLine.erase(0, 1);                                                                               // erase the ">" at the beginning
-	const auto firstNonSpace = fastaLine.find_first_not_of(' ');
-	if (firstNonSpace == std::string::npos) {
-		throw std::string("ERROR: some non-space characters required in a FASTA header in ") +
+	std::string fastaLine;
+	size_t bytePosition{0};
+	bool shortLineSeen{false};                                                                           // only the last line of a record may be short
+	while ( std::getline(fastaFile, fastaLine) ) {
+		const size_t lineBytes = fastaLine.size() + 1;
+		if ( !fastaLine.empty() && (fastaLine.back() == '\r') ) {
+			fastaLine.pop_back();
+		}
+		if ( fastaLine.empty() ) {
+			// a blank line breaks the fixed line layout unless no more sequence follows in the record
+			shortLineSeen = true;
+			bytePosition += lineBytes;
+			continue;
+		}
+		if (fastaLine[0] == '>') {
+			fastaLine.erase(0, 1);                                                                       // erase the ">" at the beginning
+			const auto firstNonSpace = fastaLine.find_first_not_of(' ');
+			fastaLine.erase( 0, std::min( firstNonSpace, fastaLine.size() ) );
+			result.push_back( FastaIndexRecord{fastaLine, 0, bytePosition + lineBytes, 0, 0} );
+			shortLineSeen = false;
+		} else if ( result.empty() ) {
+			throw std::string("ERROR: file ") + fastaFileName + std::string(" does not appear to be a FASTA file (no > on the first line) in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		} else {
+			FastaIndexRecord &record = result.back();
+			if ( shortLineSeen || ( (record.lineBases > 0) && (fastaLine.size() > record.lineBases) ) ) {
+				throw std::string("ERROR: sequence lines of ") + record.name + std::string(" must have equal length for indexing in ") +
+					std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+			}
+			if (record.lineBases == 0) {
+				record.lineBases = fastaLine.size();
+				record.lineBytes = lineBytes;
+			}
+			shortLineSeen  = fastaLine.size() < record.lineBases;
+			record.length += fastaLine.size();
+		}
+		bytePosition += lineBytes;
+	}
+	fastaFile.close();
+	return result;
+}
+
+void BayesicSpace::readFASTA(const std::string &fastaFileName, const std::function<void(std::string &&, std::string &&)> &processRecord) {
+	std::fstream fastaFile;
+	fastaFile.open(fastaFileName, std::ios::in);
+	if ( !fastaFile.is_open() ) {
+		throw std::string("ERROR: cannot open file ") + fastaFileName + std::string(" in ") +
 			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
 	}
-	fastaLine.erase(0, firstNonSpace);
-	fastaAlignment_.emplace_back(fastaLine, "");
+	std::string fastaLine;
+	std::string sequenceHeader;
+	std::string alignedSequence;
+	bool inRecord{false};
 	while ( std::getline(fastaFile, fastaLine) ) {
 		if ( fastaLine.empty() ) {
 			continue;
 		}
 		if (fastaLine[0] == '>') {
+			if (inRecord) {
+				processRecord( std::move(sequenceHeader), std::move(alignedSequence) );
+			}
 			fastaLine.erase(0, 1);                                                                       // erase the ">" at the beginning
-			const auto locFirstNonSpace = fastaLine.find_first_not_of(' ');
-			if (locFirstNonSpace == std::string::npos) {
+			const auto firstNonSpace = fastaLine.find_first_not_of(' ');
+			if (firstNonSpace == std::string::npos) {
 				throw std::string("ERROR: some non-space characters required in a FASTA header in ") +
 					std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
 			}
-			fastaLine.erase(0, locFirstNonSpace);
-			fastaAlignment_.emplace_back(fastaLine, "");
+			sequenceHeader = fastaLine.substr(firstNonSpace);
+			alignedSequence.clear();
+			inRecord = true;
+		} else if (inRecord) {
+			alignedSequence += fastaLine;
 		} else {
-			fastaAlignment_.back().second += fastaLine;
+			throw std::string("ERROR: file ") + fastaFileName + std::string(" does not appear to be a FASTA file (no > on the first line) in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
 		}
 	}
+	fastaFile.close();
+	if (inRecord) {
+		processRecord( std::move(sequenceHeader), std::move(alignedSequence) );
+	}
+}
+
+bool BayesicSpace::byCountThenSequence(const std::pair<std::string, uint32_t> &first, const std::pair<std::string, uint32_t> &second) noexcept {
+	return first.second != second.second ? first.second > second.second : first.first < second.first;
+}
+
+uint8_t BayesicSpace::iupacMask(const char &residue) noexcept {
+	constexpr uint8_t maskA{1};
+	constexpr uint8_t maskC{2};
+	constexpr uint8_t maskG{4};
+	constexpr uint8_t maskT{8};
+	switch ( std::toupper( static_cast<unsigned char>(residue) ) ) {
+		case 'A': return maskA;
+		case 'C': return maskC;
+		case 'G': return maskG;
+		case 'T': return maskT;
+		case 'U': return maskT;
+		case 'R': return maskA | maskG;
+		case 'Y': return maskC | maskT;
+		case 'S': return maskC | maskG;
+		case 'W': return maskA | maskT;
+		case 'K': return maskG | maskT;
+		case 'M': return maskA | maskC;
+		case 'B': return maskC | maskG | maskT;
+		case 'D': return maskA | maskG | maskT;
+		case 'H': return maskA | maskC | maskT;
+		case 'V': return maskA | maskC | maskG;
+		case '-': return 0;
+		default:  return maskA | maskC | maskG | maskT;
+	}
+}
+
+ParseFASTA::ParseFASTA(const std::string &fastaFileName) {
+	readFASTA(fastaFileName, [this](std::string &&sequenceHeader, std::string &&alignedSequence){
+		fastaAlignment_.emplace_back( std::move(sequenceHeader), std::move(alignedSequence) );
+	});
 	if (fastaAlignment_.size() < 2) {
 		throw std::string("ERROR: alignment file ") + fastaFileName + std::string(" must have at least two sequence records in ") +
 			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
@@ -93,8 +582,74 @@ ParseFASTA::ParseFASTA(const std::string &fastaFileName) {
 				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
 		}
 	}
+	makeConsensus_();
+	makeMissingData_();
+}
+
+ParseFASTA::ParseFASTA(const std::string &fastaFileName, const std::vector<FastaIndexRecord> &fastaIndex, const size_t &firstColumn, const size_t &nColumns) {
+	if (fastaIndex.size() < 2) {
+		throw std::string("ERROR: alignment file ") + fastaFileName + std::string(" must have at least two sequence records in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	for (const auto &eachRecord : fastaIndex) {
+		if (eachRecord.length != fastaIndex[0].length) {
+			throw std::string("ERROR: all sequences in file ") + fastaFileName + std::string(" must be the same length in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+	}
+	if ( (nColumns == 0) || (firstColumn + nColumns > fastaIndex[0].length) ) {
+		throw std::string("ERROR: column range must be non-empty and within the alignment in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	std::fstream fastaFile;
+	fastaFile.open(fastaFileName, std::ios::in | std::ios::binary);
+	if ( !fastaFile.is_open() ) {
+		throw std::string("ERROR: cannot open file ") + fastaFileName + std::string(" in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	constexpr size_t headerLookBack{256};
+	const size_t lastColumn = firstColumn + nColumns - 1;
+	for (const auto &eachRecord : fastaIndex) {
+		// line breaks inside the range are read and then dropped
+		const size_t startByte = eachRecord.offset + firstColumn / eachRecord.lineBases * eachRecord.lineBytes + firstColumn % eachRecord.lineBases;
+		const size_t endByte   = eachRecord.offset + lastColumn / eachRecord.lineBases * eachRecord.lineBytes + lastColumn % eachRecord.lineBases + 1;
+		std::string columns(endByte - startByte, '\0');
+		fastaFile.seekg( static_cast<std::streamoff>(startByte) );
+		fastaFile.read( &columns[0], static_cast<std::streamsize>( columns.size() ) );
+		columns.erase( std::remove_if( columns.begin(), columns.end(), [](char eachChar){return (eachChar == '\n') || (eachChar == '\r');} ), columns.end() );
+		if ( !fastaFile || (columns.size() != nColumns) ) {
+			throw std::string("ERROR: cannot read the column range of sequence ") + eachRecord.name + std::string(" in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		// samtools index names are only the first word of the header, so the full header line is read back from the record offset
+		std::string header;
+		size_t lookBack{headerLookBack};
+		while (true) {
+			const size_t readStart = eachRecord.offset > lookBack ? eachRecord.offset - lookBack : 0;
+			std::string headerBytes(eachRecord.offset - readStart, '\0');
+			fastaFile.seekg( static_cast<std::streamoff>(readStart) );
+			fastaFile.read( &headerBytes[0], static_cast<std::streamsize>( headerBytes.size() ) );
+			while ( !headerBytes.empty() && ( (headerBytes.back() == '\n') || (headerBytes.back() == '\r') ) ) {
+				headerBytes.pop_back();
+			}
+			const size_t lineStart = headerBytes.rfind('\n');
+			if ( (lineStart != std::string::npos) || (readStart == 0) ) {
+				header = headerBytes.substr(lineStart == std::string::npos ? 0 : lineStart + 1);
+				break;
+			}
+			lookBack *= 4;
+		}
+		if ( !fastaFile || header.empty() || (header[0] != '>') ) {
+			throw std::string("ERROR: cannot read the header of sequence ") + eachRecord.name + std::string(" in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		header.erase(0, 1);                                                                              // erase the ">" at the beginning
+		header.erase( 0, std::min( header.find_first_not_of(' '), header.size() ) );
+		fastaAlignment_.emplace_back( std::move(header), std::move(columns) );
+	}
 	fastaFile.close();
 	makeConsensus_();
+	makeMissingData_();
 }
 
 ParseFASTA::ParseFASTA(const ParseFASTA &toCopy) {
@@ -107,26 +662,207 @@ ParseFASTA::ParseFASTA(ParseFASTA &&toMove) noexcept {
 
 ParseFASTA& ParseFASTA::operator=(const ParseFASTA &toCopy) {
 	if (this != &toCopy) {
-		fastaAlignment_ = toCopy.fastaAlignment_;
-		consensus_      = toCopy.consensus_;
+		fastaAlignment_     = toCopy.fastaAlignment_;
+		consensus_          = toCopy.consensus_;
+		variableSites_      = toCopy.variableSites_;
+		polymorphicColumns_ = toCopy.polymorphicColumns_;
+		mask_               = toCopy.mask_;
+		diversityPrefix_    = toCopy.diversityPrefix_;
+		storageIndex_       = toCopy.storageIndex_;
+		missingData_        = toCopy.missingData_;
+		maxMissing_         = toCopy.maxMissing_;
+		groupCompatible_    = toCopy.groupCompatible_;
+		sampleSelection_    = toCopy.sampleSelection_;
+		checkpointSpacing_  = toCopy.checkpointSpacing_;
+		prefixCheckpoints_  = toCopy.prefixCheckpoints_;
 	}
 	return *this;
 }
 
 ParseFASTA& ParseFASTA::operator=(ParseFASTA &&toMove) noexcept {
 	if (this != &toMove) {
-		fastaAlignment_ = std::move(toMove.fastaAlignment_);
-		consensus_      = std::move(toMove.consensus_);
+		fastaAlignment_     = std::move(toMove.fastaAlignment_);
+		consensus_          = std::move(toMove.consensus_);
+		variableSites_      = std::move(toMove.variableSites_);
+		polymorphicColumns_ = std::move(toMove.polymorphicColumns_);
+		mask_               = std::move(toMove.mask_);
+		diversityPrefix_    = std::move(toMove.diversityPrefix_);
+		storageIndex_       = std::move(toMove.storageIndex_);
+		missingData_        = std::move(toMove.missingData_);
+		maxMissing_         = toMove.maxMissing_;
+		groupCompatible_    = toMove.groupCompatible_;
+		sampleSelection_    = std::move(toMove.sampleSelection_);
+		checkpointSpacing_  = toMove.checkpointSpacing_;
+		prefixCheckpoints_  = std::move(toMove.prefixCheckpoints_);
 	}
 	return *this;
 }
 
+size_t ParseFASTA::sequenceIndex(const std::string &sequenceHeader) const {
+	for (size_t iSeq = 0; iSeq < fastaAlignment_.size(); ++iSeq) {
+		if (this->header(iSeq) == sequenceHeader) {
+			return iSeq;
+		}
+	}
+	throw std::string("ERROR: no sequence with header ") + sequenceHeader + std::string(" in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+}
+
+CoordinateIndex ParseFASTA::coordinateIndex(const std::string &sequenceHeader) const {
+	return CoordinateIndex( this->sequence( this->sequenceIndex(sequenceHeader) ) );
+}
+
+bool ParseFASTA::isVariable(const size_t &alignmentColumn) const {
+	if ( alignmentColumn >= consensus_.size() ) {
+		throw std::string("ERROR: alignment column is past alignment length in " ) +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	return ( variableSites_[alignmentColumn / wordSize] & ( 1ULL << (alignmentColumn % wordSize) ) ) != 0;
+}
+
+void ParseFASTA::maskColumns(const std::vector< std::pair<size_t, size_t> > &maskedIntervals) {
+	const size_t alignLength = this->alignmentLength();
+	for (const auto &eachInterval : maskedIntervals) {
+		if ( (eachInterval.first >= eachInterval.second) || (eachInterval.second > alignLength) ) {
+			throw std::string("ERROR: mask intervals must be non-empty and within the alignment in " ) +
+					std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+	}
+	if ( mask_.empty() ) {
+		mask_.resize( (alignLength + wordSize - 1) / wordSize, 0 );
+	}
+	for (const auto &eachInterval : maskedIntervals) {
+		for (size_t iCol = eachInterval.first; iCol < eachInterval.second; ++iCol) {
+			mask_[iCol / wordSize] |= 1ULL << (iCol % wordSize);
+		}
+	}
+	consensus_.clear();
+	this->makeConsensus_();
+	if (checkpointSpacing_ > 0) {
+		this->buildPrefixHashIndex(checkpointSpacing_);
+	}
+}
+
+size_t ParseFASTA::unmaskedColumns(const size_t &startIdx, const size_t &windowLength) const {
+	const size_t windowEnd = std::min( startIdx + windowLength, this->alignmentLength() );
+	if (startIdx >= windowEnd) {
+		return 0;
+	}
+	if ( mask_.empty() ) {
+		return windowEnd - startIdx;
+	}
+	// masked bits in [startIdx, windowEnd), a word at a time with partial words trimmed
+	size_t maskedCount{0};
+	const size_t firstWord = startIdx / wordSize;
+	const size_t lastWord  = (windowEnd - 1) / wordSize;
+	for (size_t iWord = firstWord; iWord <= lastWord; ++iWord) {
+		uint64_t word = mask_[iWord];
+		if (iWord == firstWord) {
+			word &= ~0ULL << (startIdx % wordSize);
+		}
+		if ( (iWord == lastWord) && (windowEnd % wordSize != 0) ) {
+			word &= ( 1ULL << (windowEnd % wordSize) ) - 1;
+		}
+		maskedCount += static_cast<size_t>( __builtin_popcountll(word) );
+	}
+	return windowEnd - startIdx - maskedCount;
+}
+
+size_t ParseFASTA::missingColumns(const size_t &sequenceIdx, const size_t &startIdx, const size_t &windowLength) const {
+	return this->missingInWindow_(missingData_.at( this->storageIdx_(sequenceIdx) ), startIdx, windowLength);
+}
+
+size_t ParseFASTA::missingInWindow_(const std::vector<uint64_t> &missingBits, const size_t &startIdx, const size_t &windowLength) const {
+	const size_t windowEnd = std::min( startIdx + windowLength, this->alignmentLength() );
+	if (startIdx >= windowEnd) {
+		return 0;
+	}
+	size_t missingCount{0};
+	const size_t firstWord = startIdx / wordSize;
+	const size_t lastWord  = (windowEnd - 1) / wordSize;
+	for (size_t iWord = firstWord; iWord <= lastWord; ++iWord) {
+		uint64_t word = mask_.empty() ? missingBits[iWord] : missingBits[iWord] & ~mask_[iWord];
+		if (iWord == firstWord) {
+			word &= ~0ULL << (startIdx % wordSize);
+		}
+		if ( (iWord == lastWord) && (windowEnd % wordSize != 0) ) {
+			word &= ( 1ULL << (windowEnd % wordSize) ) - 1;
+		}
+		missingCount += static_cast<size_t>( __builtin_popcountll(word) );
+	}
+	return missingCount;
+}
+
+void ParseFASTA::filterMissing(const double &maxMissingFraction) {
+	if ( (maxMissingFraction < 0.0) || (maxMissingFraction > 1.0) ) {
+		throw std::string("ERROR: missing data fraction must be between 0 and 1 in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	maxMissing_ = maxMissingFraction;
+}
+
+void ParseFASTA::groupCompatible(const bool &groupCompatible) noexcept {
+	groupCompatible_ = groupCompatible;
+}
+
+void ParseFASTA::selectSamples(const std::vector<uint64_t> &sampleBits) {
+	if ( sampleBits.empty() ) {
+		sampleSelection_.clear();
+		return;
+	}
+	if ( sampleBits.size() != (fastaAlignment_.size() + wordSize - 1) / wordSize ) {
+		throw std::string("ERROR: sample selection must have one bit per sequence in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	sampleSelection_.assign(sampleBits.size(), 0);
+	for (size_t iSeq = 0; iSeq < fastaAlignment_.size(); ++iSeq) {
+		if ( ( sampleBits[iSeq / wordSize] & ( 1ULL << (iSeq % wordSize) ) ) != 0 ) {
+			const size_t storageIdx = this->storageIdx_(iSeq);
+			sampleSelection_[storageIdx / wordSize] |= 1ULL << (storageIdx % wordSize);
+		}
+	}
+}
+
+uint32_t ParseFASTA::variableSiteNumber(const size_t &startIdx, const size_t &windowLength) const {
+	const size_t windowEnd = std::min( startIdx + windowLength, this->alignmentLength() );
+	if (startIdx >= windowEnd) {
+		return 0;
+	}
+	uint32_t result{0};
+	const size_t firstWord = startIdx / wordSize;
+	const size_t lastWord  = (windowEnd - 1) / wordSize;
+	for (size_t iWord = firstWord; iWord <= lastWord; ++iWord) {
+		uint64_t word = variableSites_[iWord];
+		if (iWord == firstWord) {
+			word &= ~0ULL << (startIdx % wordSize);
+		}
+		if ( (iWord == lastWord) && (windowEnd % wordSize != 0) ) {
+			word &= ( 1ULL << (windowEnd % wordSize) ) - 1;
+		}
+		result += static_cast<uint32_t>( __builtin_popcountll(word) );
+	}
+	return result;
+}
+
+double ParseFASTA::nucleotideDiversity(const size_t &startIdx, const size_t &windowLength) const {
+	const size_t windowEnd = std::min( startIdx + windowLength, this->alignmentLength() );
+	const size_t nColumns  = this->unmaskedColumns(startIdx, windowLength);
+	if (nColumns == 0) {
+		return 0.0;
+	}
+	return (diversityPrefix_[windowEnd] - diversityPrefix_[startIdx]) / static_cast<double>(nColumns);
+}
+
 std::string ParseFASTA::extractConsensusWindow(const size_t &startIdx, const size_t &windowLength) const {
 	if ( startIdx >= consensus_.size() ) {
 		throw std::string("ERROR: window start is past alignment length in " ) +
 				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
 	}
 	std::string window;
+	if ( !mask_.empty() ) {
+		this->appendUnmasked_(consensus_, startIdx, windowLength, window);
+		return window;
+	}
 	auto first = consensus_.cbegin() + static_cast<std::string::difference_type>(startIdx);
 	std::copy_n( first, windowLength, std::back_inserter(window) );
 	return window;
@@ -137,106 +873,981 @@ std::vector< std::pair< size_t, std::vector<uint32_t> > > ParseFASTA::diversityI
 	size_t windowStart{0};
 	size_t windowEnd{windowSize};
 	while ( windowEnd < this->alignmentLength() ) {
-		std::unordered_map<std::string, uint32_t> sequenceTable;
-		for (const auto &eachSeq : fastaAlignment_) {
-			++sequenceTable[eachSeq.second.substr(windowStart, windowSize)];
-		}
-		std::vector<uint32_t> counts;
-		counts.reserve( sequenceTable.size() );
-		for (const auto &eachSequence : sequenceTable) {
-			counts.push_back(eachSequence.second);
-		}
-		result.emplace_back( windowStart, std::move(counts) );
+		result.emplace_back( windowStart, this->windowCounts_(windowStart, windowSize, WindowEngine::hash) );
 		windowStart += stepSize;
 		windowEnd   += stepSize;
 	}
 	return result;
 }
 
-std::unordered_map<std::string, uint32_t> ParseFASTA::extractWindow(const size_t &windowStartPosition, const size_t &windowSize) const {
-	if ( windowStartPosition >= this->alignmentLength() ) {
-		throw std::string("ERROR: window start is past alignment length in " ) +
-				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+size_t ParseFASTA::diversityInWindows(const size_t &windowSize, const size_t &stepSize, const size_t &coarseStride, const WindowPlan &plan,
+										const std::function<bool(const size_t &, std::vector<uint32_t> &&)> &windowCallback) const {
+	if (stepSize == 0) {
+		throw std::string("ERROR: step size must be positive in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
 	}
-	std::unordered_map<std::string, uint32_t> result;
-	for (const auto &eachSeq : fastaAlignment_) {
-		++result[eachSeq.second.substr(windowStartPosition, windowSize)];
+	// same windows as the table version: start at multiples of the step, end before the last column
+	const size_t windowNumber = this->alignmentLength() > windowSize ? (this->alignmentLength() - windowSize - 1) / stepSize + 1 : 0;
+	const WindowEngine engine = plan.engine == WindowEngine::automatic ? WindowEngine::hash : plan.engine;
+	const size_t threadCount  = std::max(std::min(plan.threads, windowNumber), size_t{1});
+	// threads count a batch of windows that is then reported in order; one thread reports each window as soon as it is done
+	constexpr size_t windowsPerThread{16};
+	const size_t batchSize = threadCount == 1 ? size_t{1} : threadCount * windowsPerThread;
+	size_t firstStride{1};
+	while (firstStride <= coarseStride / 2) {
+		firstStride *= 2;
 	}
-	return result;
+	std::vector<size_t> batchStarts;
+	std::vector< std::vector<uint32_t> > batchCounts;
+	batchStarts.reserve(batchSize);
+	auto countWindows = [this, &batchStarts, &batchCounts, &windowSize, &engine, threadCount](const size_t &firstWindow){
+		for (size_t iWindow = firstWindow; iWindow < batchStarts.size(); iWindow += threadCount) {
+			batchCounts[iWindow] = this->windowCounts_(batchStarts[iWindow], windowSize, engine);
+		}
+	};
+	std::vector<std::thread> windowThreads;
+	windowThreads.reserve(threadCount - 1);
+	size_t nEvaluated{0};
+	for (size_t levelStride = firstStride; levelStride > 0; levelStride /= 2) {
+		// later passes skip the windows at even multiples of their stride, already reported by coarser passes
+		const size_t firstWindow = levelStride == firstStride ? 0 : levelStride;
+		const size_t windowStep  = levelStride == firstStride ? levelStride : 2 * levelStride;
+		for (size_t batchWindow = firstWindow; batchWindow < windowNumber; batchWindow += batchSize * windowStep) {
+			batchStarts.clear();
+			for (size_t iWindow = batchWindow; (iWindow < windowNumber) && (batchStarts.size() < batchSize); iWindow += windowStep) {
+				batchStarts.push_back(iWindow * stepSize);
+			}
+			batchCounts.assign( batchStarts.size(), std::vector<uint32_t>() );
+			for (size_t iThread = 1; iThread < std::min( threadCount, batchStarts.size() ); ++iThread) {
+				windowThreads.emplace_back(countWindows, iThread);
+			}
+			countWindows(0);
+			for (auto &eachThread : windowThreads) {
+				eachThread.join();
+			}
+			windowThreads.clear();
+			for (size_t iBatch = 0; iBatch < batchStarts.size(); ++iBatch) {
+				++nEvaluated;
+				if ( !windowCallback( batchStarts[iBatch], std::move(batchCounts[iBatch]) ) ) {
+					return nEvaluated;
+				}
+			}
+		}
+	}
+	return nEvaluated;
 }
 
-std::vector< std::pair<std::string, uint32_t> > ParseFASTA::extractWindowSorted(const size_t &windowStartPosition, const size_t &windowSize) const {
-	std::unordered_map<std::string, uint32_t> mapResult{this->extractWindow(windowStartPosition, windowSize)};
-	std::vector< std::pair<std::string, uint32_t> > result;
-	result.reserve( mapResult.size() );
-	for (auto &eachSeq : mapResult) {
-		result.emplace_back( std::move(eachSeq) );
+WindowPlan ParseFASTA::planWindows(const size_t &windowSize, const size_t &windowNumber, const size_t &nThreads, const WindowEngine &engine) const {
+	if ( (windowSize == 0) || (nThreads == 0) ) {
+		throw std::string("ERROR: window size and thread number must be positive in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
 	}
-	std::sort(
-				result.begin(),
-				result.end(),
-				[](const std::pair<std::string, uint32_t> &first, const std::pair<std::string, uint32_t> &second){return first.second > second.second;}
-			);
-	return result;
+	// statistics come from up to sampleWindows evenly spaced windows and up to sampleSequences evenly spaced sequences in each
+	constexpr size_t sampleWindows{8};
+	constexpr size_t sampleSequences{512};
+	// fewer sequences per thread than this do not pay for splitting a window
+	constexpr size_t minSequencesPerThread{1024};
+	const size_t windowSpan     = std::min( windowSize, this->alignmentLength() );
+	const size_t nSequences     = fastaAlignment_.size();
+	const size_t sequenceStride = std::max(nSequences / sampleSequences, size_t{1});
+	size_t nUnmasked{0};
+	size_t nPolymorphic{0};
+	size_t nSampled{0};
+	size_t nUnique{0};
+	for (size_t iWindow = 0; iWindow < sampleWindows; ++iWindow) {
+		const size_t windowStart = (this->alignmentLength() - windowSpan) * iWindow / (sampleWindows - 1);
+		const std::vector<size_t> columns{this->projectionColumns_(windowStart, windowSpan)};
+		nUnmasked    += this->unmaskedColumns(windowStart, windowSpan);
+		nPolymorphic += columns.size();
+		std::unordered_map<std::string, uint32_t> projections;
+		for (size_t iSeq = 0; iSeq < nSequences; iSeq += sequenceStride) {
+			std::string projection;
+			projection.reserve( columns.size() );
+			for (const auto &iCol : columns) {
+				projection.push_back(fastaAlignment_[iSeq].second[iCol]);
+			}
+			++projections[projection];
+			++nSampled;
+		}
+		nUnique += projections.size();
+	}
+	WindowPlan plan{WindowEngine::hash, 1, 0.0, 0.0};
+	plan.polymorphicFraction = nUnmasked > 0 ? static_cast<double>(nPolymorphic) / static_cast<double>(nUnmasked) : 0.0;
+	plan.duplicationRate     = nSampled > 0 ? 1.0 - static_cast<double>(nUnique) / static_cast<double>(nSampled) : 0.0;
+	// per-window costs in residues touched: hashing reads whole windows, projection reads polymorphic columns and the column bits,
+	// then window extraction rebuilds whole windows for the distinct sequences
+	const double unmaskedWidth  = static_cast<double>(nUnmasked) / static_cast<double>(sampleWindows);
+	const double sequenceNumber = static_cast<double>(nSequences);
+	const double hashCost       = sequenceNumber * unmaskedWidth;
+	double projectionCost       = sequenceNumber * ( plan.polymorphicFraction * unmaskedWidth + static_cast<double>(windowSpan) / static_cast<double>(wordSize) );
+	if (windowNumber <= 1) {
+		projectionCost += sequenceNumber * (1.0 - plan.duplicationRate) * unmaskedWidth;
+	}
+	// a prefix-hash index reads at most one checkpoint interval at each window end, for each of the two moduli
+	double prefixHashCost = std::numeric_limits<double>::max();
+	if (checkpointSpacing_ > 0) {
+		prefixHashCost = sequenceNumber * 4.0 * static_cast<double>(checkpointSpacing_);
+		if (windowNumber <= 1) {
+			prefixHashCost += sequenceNumber * (1.0 - plan.duplicationRate) * unmaskedWidth;
+		}
+	}
+	if (windowNumber > 1) {
+		plan.threads = std::max(std::min(nThreads, windowNumber), size_t{1});
+		plan.engine  = projectionCost < hashCost ? WindowEngine::projection : WindowEngine::hash;
+		if ( prefixHashCost < std::min(projectionCost, hashCost) ) {
+			plan.engine = WindowEngine::prefixHash;
+		}
+	} else {
+		// only hashing splits a single window among threads
+		const size_t hashThreads = std::max(std::min(nThreads, nSequences / minSequencesPerThread), size_t{1});
+		const double threadedHashCost = hashCost / static_cast<double>(hashThreads);
+		plan.engine                   = projectionCost < threadedHashCost ? WindowEngine::projection : WindowEngine::hash;
+		if ( prefixHashCost < std::min(projectionCost, threadedHashCost) ) {
+			plan.engine = WindowEngine::prefixHash;
+		}
+		plan.threads = plan.engine == WindowEngine::hash ? hashThreads : 1;
+	}
+	// projections short enough for integer keys are packed
+	if ( (plan.engine == WindowEngine::projection) && (plan.polymorphicFraction * unmaskedWidth <= static_cast<double>(2 * residuesPerWord) ) ) {
+		plan.engine = WindowEngine::packed;
+	}
+	if (engine != WindowEngine::automatic) {
+		if ( (engine == WindowEngine::prefixHash) && (checkpointSpacing_ == 0) ) {
+			throw std::string("ERROR: the prefix-hash engine needs a prefix-hash index in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		plan.engine = engine;
+		if ( (windowNumber <= 1) && (engine != WindowEngine::hash) ) {
+			plan.threads = 1;
+		}
+	}
+	return plan;
 }
 
-AlignmentStatistics ParseFASTA::extractSequence(const std::string &querySequence) const {
-	static const int32_t minMaskLen{15};
-	int32_t maskLen{static_cast<int32_t>(querySequence.size() / 2)};
-	maskLen = maskLen < minMaskLen ? minMaskLen : maskLen;
-	StripedSmithWaterman::Aligner aligner;
-	StripedSmithWaterman::Filter filter;
-	StripedSmithWaterman::Alignment alignment;
-	aligner.Align(querySequence.c_str(), consensus_.c_str(), static_cast<int32_t>( consensus_.size() ), filter, &alignment, maskLen);
-	if (alignment.ref_begin < 0) {
-		throw std::string("ERROR: matching reference start value cannot be negative in ") +
+void ParseFASTA::buildPrefixHashIndex(const size_t &checkpointSpacing) {
+	if (checkpointSpacing == 0) {
+		throw std::string("ERROR: checkpoint spacing must be positive in ") +
 			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
 	}
-	if (alignment.ref_end < alignment.ref_begin) {
-		throw std::string("ERROR: matching reference end must be greater than start in ") +
+	const size_t alignLength = this->alignmentLength();
+	prefixCheckpoints_.assign( fastaAlignment_.size(), std::vector< std::array<uint64_t, 2> >{} );
+	for (size_t iSeq = 0; iSeq < fastaAlignment_.size(); ++iSeq) {
+		const std::string &alignedSequence = fastaAlignment_[iSeq].second;
+		prefixCheckpoints_[iSeq].reserve(alignLength / checkpointSpacing + 1);
+		std::array<uint64_t, 2> prefixHash{{0, 0}};
+		for (size_t iCol = 0; iCol < alignLength; ++iCol) {
+			if (iCol % checkpointSpacing == 0) {
+				prefixCheckpoints_[iSeq].push_back(prefixHash);
+			}
+			// masked columns are left out, as in window sequences
+			if ( this->isMasked_(iCol) ) {
+				continue;
+			}
+			for (size_t iBase = 0; iBase < hashBases.size(); ++iBase) {
+				prefixHash[iBase] = appendResidue(prefixHash[iBase], alignedSequence[iCol], hashBases[iBase]);
+			}
+		}
+		if (alignLength % checkpointSpacing == 0) {
+			prefixCheckpoints_[iSeq].push_back(prefixHash);
+		}
+	}
+	checkpointSpacing_ = checkpointSpacing;
+}
+
+std::array<uint64_t, 2> ParseFASTA::windowHash(const size_t &sequenceIdx, const size_t &startIdx, const size_t &windowLength) const {
+	if (checkpointSpacing_ == 0) {
+		throw std::string("ERROR: no prefix-hash index in ") +
 			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
 	}
-	if (alignment.query_begin < 0) {
-		throw std::string("ERROR: query start value cannot be negative in ") +
+	if ( sequenceIdx >= fastaAlignment_.size() ) {
+		throw std::string("ERROR: sequence index out of range in ") +
 			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
 	}
-	if (alignment.query_end < alignment.query_begin) {
-		throw std::string("ERROR: query end must be greater than start in ") +
+	const size_t windowEnd = std::min( startIdx + windowLength, this->alignmentLength() );
+	const size_t storageIdx = this->storageIdx_(sequenceIdx);
+	if (startIdx >= windowEnd) {
+		return std::array<uint64_t, 2>{{0, 0}};
+	}
+	return this->rangeHash_( storageIdx, startIdx, windowEnd, hashPower( this->unmaskedColumns(startIdx, windowEnd - startIdx) ) );
+}
+
+std::vector< std::pair< size_t, std::vector<uint32_t> > > ParseFASTA::diversityInWindows(const size_t &windowSize, const size_t &stepSize, const WindowPlan &plan) const {
+	if (stepSize == 0) {
+		throw std::string("ERROR: step size must be positive in ") +
 			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
 	}
-	AlignmentStatistics result{
-		static_cast<size_t>(alignment.ref_begin),
-		static_cast<size_t>(alignment.ref_end - alignment.ref_begin),
-		static_cast<size_t>(alignment.query_begin),
-		static_cast<size_t>(alignment.query_end - alignment.query_begin),
+	const size_t windowNumber = this->alignmentLength() > windowSize ? (this->alignmentLength() - windowSize - 1) / stepSize + 1 : 0;
+	const WindowEngine engine = plan.engine == WindowEngine::automatic ? WindowEngine::hash : plan.engine;
+	const size_t threadCount  = std::max(std::min(plan.threads, windowNumber), size_t{1});
+	std::vector< std::pair< size_t, std::vector<uint32_t> > > result(windowNumber);
+	// windows are dealt out in turn, so each thread gets a share of every region of the alignment
+	auto countWindows = [this, &result, &windowSize, &stepSize, &engine, windowNumber, threadCount](const size_t &firstWindow){
+		for (size_t iWindow = firstWindow; iWindow < windowNumber; iWindow += threadCount) {
+			result[iWindow].first  = iWindow * stepSize;
+			result[iWindow].second = this->windowCounts_(iWindow * stepSize, windowSize, engine);
+		}
 	};
+	std::vector<std::thread> windowThreads;
+	windowThreads.reserve(threadCount - 1);
+	for (size_t iThread = 1; iThread < threadCount; ++iThread) {
+		windowThreads.emplace_back(countWindows, iThread);
+	}
+	countWindows(0);
+	for (auto &eachThread : windowThreads) {
+		eachThread.join();
+	}
 	return result;
 }
 
-void ParseFASTA::imputeMissing() {
-	const std::string standardNucleotides("AaCcTtGg-");
-	for (auto &eachSeq : fastaAlignment_) {
-		std::transform(
-			eachSeq.second.cbegin(), eachSeq.second.cend(),
-			consensus_.cbegin(),
+std::unordered_map<std::string, uint32_t> ParseFASTA::extractWindow(const size_t &windowStartPosition, const size_t &windowSize, const WindowPlan &plan) const {
+	if ( (plan.engine == WindowEngine::hash) || (plan.engine == WindowEngine::automatic) ) {
+		return this->extractWindow(windowStartPosition, windowSize, plan.threads);
+	}
+	if ( windowStartPosition >= this->alignmentLength() ) {
+		throw std::string("ERROR: window start is past alignment length in " ) +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	std::unordered_map<std::string, uint32_t> result;
+	if (plan.engine == WindowEngine::prefixHash) {
+		for ( const auto &eachGroup : this->hashedWindow_(windowStartPosition, windowSize) ) {
+			result.emplace(this->windowSequence_(fastaAlignment_[eachGroup.second].second, windowStartPosition, windowSize), eachGroup.first);
+		}
+	} else {
+		for ( const auto &eachProjection : this->projectedWindow_(windowStartPosition, windowSize, plan.engine) ) {
+			result.emplace(this->windowSequence_(fastaAlignment_[eachProjection.second.second].second, windowStartPosition, windowSize), eachProjection.second.first);
+		}
+	}
+	if (groupCompatible_) {
+		return this->compatibleGroups_( std::move(result) );
+	}
+	return result;
+}
+
+std::vector< std::pair<std::string, uint32_t> > ParseFASTA::extractWindowSorted(const size_t &windowStartPosition, const size_t &windowSize, const WindowPlan &plan) const {
+	if ( (plan.engine == WindowEngine::hash) || (plan.engine == WindowEngine::automatic) ) {
+		return this->extractWindowSorted(windowStartPosition, windowSize, plan.threads);
+	}
+	std::unordered_map<std::string, uint32_t> mapResult{this->extractWindow(windowStartPosition, windowSize, plan)};
+	std::vector< std::pair<std::string, uint32_t> > result( std::make_move_iterator( mapResult.begin() ), std::make_move_iterator( mapResult.end() ) );
+	std::sort(
+				result.begin(),
+				result.end(),
+				byCountThenSequence
+			);
+	return result;
+}
+
+std::vector<size_t> ParseFASTA::polymorphicColumns(const size_t &windowStartPosition, const size_t &windowSize) const {
+	if ( windowStartPosition >= this->alignmentLength() ) {
+		throw std::string("ERROR: window start is past alignment length in " ) +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	return this->projectionColumns_(windowStartPosition, windowSize);
+}
+
+std::unordered_map<std::string, uint32_t> ParseFASTA::extractPolymorphicWindow(const size_t &windowStartPosition, const size_t &windowSize) const {
+	const WindowPlan packedPlan{WindowEngine::packed, 1, 0.0, 0.0};
+	return this->extractPolymorphicWindow(windowStartPosition, windowSize, packedPlan);
+}
+
+std::unordered_map<std::string, uint32_t> ParseFASTA::extractPolymorphicWindow(const size_t &windowStartPosition, const size_t &windowSize, const WindowPlan &plan) const {
+	if ( windowStartPosition >= this->alignmentLength() ) {
+		throw std::string("ERROR: window start is past alignment length in " ) +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	std::unordered_map<std::string, uint32_t> result;
+	if ( (plan.engine == WindowEngine::projection) || (plan.engine == WindowEngine::packed) ) {
+		// monomorphic columns do not change grouping, so compatible groups are the same for projections and full windows
+		for ( auto &eachProjection : this->projectedWindow_(windowStartPosition, windowSize, plan.engine) ) {
+			result.emplace(eachProjection.first, eachProjection.second.first);
+		}
+		if (groupCompatible_) {
+			return this->compatibleGroups_( std::move(result) );
+		}
+		return result;
+	}
+	// the hash engines count whole windows, which are then reduced to the polymorphic columns; window strings skip masked columns
+	const std::vector<size_t> columns{this->projectionColumns_(windowStartPosition, windowSize)};
+	std::vector<size_t> windowOffsets;
+	windowOffsets.reserve( columns.size() );
+	size_t unmaskedColumns{0};
+	size_t iCol{windowStartPosition};
+	for (const auto &eachColumn : columns) {
+		for (; iCol < eachColumn; ++iCol) {
+			unmaskedColumns += this->isMasked_(iCol) ? size_t{0} : size_t{1};
+		}
+		windowOffsets.push_back(unmaskedColumns);
+	}
+	std::string haplotype;
+	for ( const auto &eachWindow : this->extractWindow(windowStartPosition, windowSize, plan) ) {
+		haplotype.clear();
+		for (const auto &eachOffset : windowOffsets) {
+			haplotype.push_back(eachWindow.first[eachOffset]);
+		}
+		result[haplotype] += eachWindow.second;
+	}
+	return result;
+}
+
+std::vector< std::pair<std::string, uint32_t> > ParseFASTA::extractPolymorphicWindowSorted(const size_t &windowStartPosition, const size_t &windowSize, const WindowPlan &plan) const {
+	std::unordered_map<std::string, uint32_t> mapResult{this->extractPolymorphicWindow(windowStartPosition, windowSize, plan)};
+	std::vector< std::pair<std::string, uint32_t> > result( std::make_move_iterator( mapResult.begin() ), std::make_move_iterator( mapResult.end() ) );
+	std::sort(result.begin(), result.end(), byCountThenSequence);
+	return result;
+}
+
+std::unordered_map<std::string, uint32_t> ParseFASTA::extractWindow(const size_t &windowStartPosition, const size_t &windowSize) const {
+	if ( windowStartPosition >= this->alignmentLength() ) {
+		throw std::string("ERROR: window start is past alignment length in " ) +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	std::unordered_map<std::string, uint32_t> result;
+	for (size_t iSeq = 0; iSeq < fastaAlignment_.size(); ++iSeq) {
+		if ( this->isExcluded_(iSeq, windowStartPosition, windowSize) ) {
+			continue;
+		}
+		++result[this->windowSequence_(fastaAlignment_[iSeq].second, windowStartPosition, windowSize)];
+	}
+	if (groupCompatible_) {
+		return this->compatibleGroups_( std::move(result) );
+	}
+	return result;
+}
+
+std::vector< std::pair<std::string, uint32_t> > ParseFASTA::extractWindowSorted(const size_t &windowStartPosition, const size_t &windowSize) const {
+	std::unordered_map<std::string, uint32_t> mapResult{this->extractWindow(windowStartPosition, windowSize)};
+	std::vector< std::pair<std::string, uint32_t> > result;
+	result.reserve( mapResult.size() );
+	for (auto &eachSeq : mapResult) {
+		result.emplace_back( std::move(eachSeq) );
+	}
+	std::sort(
+				result.begin(),
+				result.end(),
+				byCountThenSequence
+			);
+	return result;
+}
+
+std::unordered_map<std::string, uint32_t> ParseFASTA::extractWindow(const size_t &windowStartPosition, const size_t &windowSize, const size_t &nThreads) const {
+	const size_t threadCount = std::min( nThreads, fastaAlignment_.size() );
+	if (threadCount <= 1) {
+		return this->extractWindow(windowStartPosition, windowSize);
+	}
+	if ( windowStartPosition >= this->alignmentLength() ) {
+		throw std::string("ERROR: window start is past alignment length in " ) +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	auto partitions = this->windowPartitions_(windowStartPosition, windowSize, threadCount);
+	std::unordered_map<std::string, uint32_t> result{std::move( partitions.front() )};
+	for (auto partitionIt = partitions.begin() + 1; partitionIt != partitions.end(); ++partitionIt) {
+		for (auto &eachWindow : *partitionIt) {
+			result.emplace( std::move(eachWindow) );
+		}
+	}
+	if (groupCompatible_) {
+		return this->compatibleGroups_( std::move(result) );
+	}
+	return result;
+}
+
+std::vector< std::pair<std::string, uint32_t> > ParseFASTA::extractWindowSorted(const size_t &windowStartPosition, const size_t &windowSize, const size_t &nThreads) const {
+	const size_t threadCount = std::min( nThreads, fastaAlignment_.size() );
+	if (threadCount <= 1) {
+		return this->extractWindowSorted(windowStartPosition, windowSize);
+	}
+	if ( windowStartPosition >= this->alignmentLength() ) {
+		throw std::string("ERROR: window start is past alignment length in " ) +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if (groupCompatible_) {
+		// compatible groups span hash partitions, so they are resolved on the whole table before sorting
+		std::unordered_map<std::string, uint32_t> groupTable{this->extractWindow(windowStartPosition, windowSize, threadCount)};
+		std::vector< std::pair<std::string, uint32_t> > groups( std::make_move_iterator( groupTable.begin() ), std::make_move_iterator( groupTable.end() ) );
+		std::sort(groups.begin(), groups.end(), byCountThenSequence);
+		return groups;
+	}
+	auto partitions = this->windowPartitions_(windowStartPosition, windowSize, threadCount);
+	// lay the partitions out contiguously, then sort each in its own thread
+	std::vector<size_t> runStarts{0};
+	for (const auto &eachPartition : partitions) {
+		runStarts.push_back( runStarts.back() + eachPartition.size() );
+	}
+	std::vector< std::pair<std::string, uint32_t> > result;
+	result.reserve( runStarts.back() );
+	for (auto &eachPartition : partitions) {
+		for (auto &eachWindow : eachPartition) {
+			result.emplace_back( std::move(eachWindow) );
+		}
+		eachPartition.clear();
+	}
+	using DiffType = std::vector< std::pair<std::string, uint32_t> >::difference_type;
+	std::vector<std::thread> sortThreads;
+	sortThreads.reserve(threadCount);
+	for (size_t iRun = 0; iRun < threadCount; ++iRun) {
+		sortThreads.emplace_back(
+			[&result, &runStarts, iRun](){
+				std::sort(result.begin() + static_cast<DiffType>(runStarts[iRun]), result.begin() + static_cast<DiffType>(runStarts[iRun + 1]), byCountThenSequence);
+			}
+		);
+	}
+	for (auto &eachThread : sortThreads) {
+		eachThread.join();
+	}
+	// merge neighboring sorted runs pairwise, in parallel within each round
+	for (size_t runStep = 1; runStep < threadCount; runStep *= 2) {
+		std::vector<std::thread> mergeThreads;
+		for (size_t iRun = 0; iRun + runStep < threadCount; iRun += 2 * runStep) {
+			const size_t middle = runStarts[iRun + runStep];
+			const size_t end    = runStarts[std::min(iRun + 2 * runStep, threadCount)];
+			const size_t begin  = runStarts[iRun];
+			mergeThreads.emplace_back(
+				[&result, begin, middle, end](){
+					std::inplace_merge(result.begin() + static_cast<DiffType>(begin), result.begin() + static_cast<DiffType>(middle), result.begin() + static_cast<DiffType>(end), byCountThenSequence);
+				}
+			);
+		}
+		for (auto &eachThread : mergeThreads) {
+			eachThread.join();
+		}
+	}
+	return result;
+}
+
+AlignmentStatistics ParseFASTA::extractSequence(const std::string &querySequence) const {
+	int32_t maskLen{static_cast<int32_t>(querySequence.size() / 2)};
+	maskLen = maskLen < swMinMaskLen ? swMinMaskLen : maskLen;
+	StripedSmithWaterman::Aligner aligner(swMatchScore, swMismatchPenalty, swGapOpenPenalty, swGapExtendPenalty);
+	StripedSmithWaterman::Filter filter;
+	StripedSmithWaterman::Alignment alignment;
+	aligner.Align(querySequence.c_str(), consensus_.c_str(), static_cast<int32_t>( consensus_.size() ), filter, &alignment, maskLen);
+	if (alignment.ref_begin < 0) {
+		throw std::string("ERROR: matching reference start value cannot be negative in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if (alignment.ref_end < alignment.ref_begin) {
+		throw std::string("ERROR: matching reference end must be greater than start in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if (alignment.query_begin < 0) {
+		throw std::string("ERROR: query start value cannot be negative in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if (alignment.query_end < alignment.query_begin) {
+		throw std::string("ERROR: query end must be greater than start in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	AlignmentStatistics result{
+		static_cast<size_t>(alignment.ref_begin),
+		static_cast<size_t>(alignment.ref_end - alignment.ref_begin),
+		static_cast<size_t>(alignment.query_begin),
+		static_cast<size_t>(alignment.query_end - alignment.query_begin),
+	};
+	return result;
+}
+
+AlignmentStatistics ParseFASTA::extractSequence(const std::string &querySequence, QueryCache &cache) const {
+	const std::string swParameters = std::to_string(swMatchScore) + ":" + std::to_string(swMismatchPenalty) + ":" +
+		std::to_string(swGapOpenPenalty) + ":" + std::to_string(swGapExtendPenalty) + ":" + std::to_string(swMinMaskLen);
+	// the query is aligned to the consensus, so the key covers everything that changes it (masks, imputation, placement) at the cost of one consensus pass
+	uint64_t key = fnv1aUpdate(consensus_, fnvOffsetBasis);
+	key          = fnv1aUpdate(swParameters, key);
+	key          = fnv1aUpdate(querySequence, key);
+	AlignmentStatistics result{};
+	if ( cache.find(key, result) ) {
+		return result;
+	}
+	result = this->extractSequence(querySequence);
+	cache.insert(key, result);
+	return result;
+}
+
+AlignmentStatistics ParseFASTA::extractProteinSequence(const std::string &proteinQuery) const {
+	constexpr size_t nFrames{6};
+	constexpr size_t nForwardFrames{3};
+	constexpr size_t codonLength{3};
+	std::string ungapped;
+	std::vector<size_t> columnIndexes;
+	this->ungappedConsensus_(ungapped, columnIndexes);
+	if (ungapped.size() < codonLength) {
+		throw std::string("ERROR: the gap-free consensus is shorter than a codon in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const std::string reverseStrand{reverseComplement(ungapped)};
+	std::array<std::string, nFrames> frameProteins;
+	for (size_t iFrame = 0; iFrame < nFrames; ++iFrame) {
+		frameProteins[iFrame] = translate(iFrame < nForwardFrames ? ungapped : reverseStrand, iFrame % nForwardFrames);
+	}
+	std::array<int8_t, asciiSize> translationMatrix{};
+	translationMatrix.fill( static_cast<int8_t>( blosumAlphabet.find('X') ) );
+	for (size_t iAA = 0; iAA < blosumAlphabet.size(); ++iAA) {
+		const auto aminoAcid = static_cast<unsigned char>(blosumAlphabet[iAA]);
+		translationMatrix[aminoAcid]                                      = static_cast<int8_t>(iAA);
+		translationMatrix[static_cast<size_t>( std::tolower(aminoAcid) )] = static_cast<int8_t>(iAA);
+	}
+	int32_t maskLen{static_cast<int32_t>(proteinQuery.size() / 2)};
+	maskLen = maskLen < swMinMaskLen ? swMinMaskLen : maskLen;
+	// each frame gets its own aligner, so the frames can be searched concurrently
+	std::array<StripedSmithWaterman::Alignment, nFrames> frameAlignments;
+	std::vector<std::thread> frameThreads;
+	frameThreads.reserve(nFrames);
+	for (size_t iFrame = 0; iFrame < nFrames; ++iFrame) {
+		if ( frameProteins[iFrame].empty() ) {
+			continue;
+		}
+		frameThreads.emplace_back(
+			[&proteinQuery, &frameProteins, &frameAlignments, &translationMatrix, maskLen, iFrame](){
+				StripedSmithWaterman::Aligner aligner( blosum62.data(), blosumSize, translationMatrix.data(), asciiSize );
+				aligner.SetGapPenalty(proteinGapOpenPenalty, proteinGapExtendPenalty);
+				StripedSmithWaterman::Filter filter;
+				aligner.Align(proteinQuery.c_str(), frameProteins[iFrame].c_str(), static_cast<int32_t>( frameProteins[iFrame].size() ),
+								filter, &frameAlignments[iFrame], maskLen);
+			}
+		);
+	}
+	for (auto &eachThread : frameThreads) {
+		eachThread.join();
+	}
+	size_t bestFrame{0};
+	for (size_t iFrame = 1; iFrame < nFrames; ++iFrame) {
+		if (frameAlignments[iFrame].sw_score > frameAlignments[bestFrame].sw_score) {
+			bestFrame = iFrame;
+		}
+	}
+	const StripedSmithWaterman::Alignment &alignment = frameAlignments[bestFrame];
+	if ( (alignment.ref_begin < 0) || (alignment.query_begin < 0) ) {
+		throw std::string("ERROR: matching start values cannot be negative in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if ( (alignment.ref_end < alignment.ref_begin) || (alignment.query_end < alignment.query_begin) ) {
+		throw std::string("ERROR: matching end must be greater than start in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	// first and last nucleotides of the hit on the translated strand
+	const size_t frameOffset = bestFrame % nForwardFrames;
+	size_t firstNucleotide   = frameOffset + codonLength * static_cast<size_t>(alignment.ref_begin);
+	size_t lastNucleotide    = frameOffset + codonLength * static_cast<size_t>(alignment.ref_end) + codonLength - 1;
+	if (bestFrame >= nForwardFrames) {
+		const size_t reverseFirst = ungapped.size() - 1 - lastNucleotide;
+		lastNucleotide            = ungapped.size() - 1 - firstNucleotide;
+		firstNucleotide           = reverseFirst;
+	}
+	AlignmentStatistics result{
+		columnIndexes[firstNucleotide],
+		columnIndexes[lastNucleotide] - columnIndexes[firstNucleotide],
+		static_cast<size_t>(alignment.query_begin),
+		static_cast<size_t>(alignment.query_end - alignment.query_begin),
+	};
+	return result;
+}
+
+AlignmentStatistics ParseFASTA::extractLongSequence(const std::string &querySequence) const {
+	std::string ungapped;
+	std::vector<size_t> columnIndexes;
+	this->ungappedConsensus_(ungapped, columnIndexes);
+	// index consensus minimizers
+	std::unordered_map< uint64_t, std::vector<size_t> > minimizerIndex;
+	for (const auto &eachMinimizer : minimizers(ungapped)) {
+		minimizerIndex[eachMinimizer.first].push_back(eachMinimizer.second);
+	}
+	// anchors are (reference, query) positions of shared minimizers; repetitive minimizers are ignored
+	std::vector< std::pair<size_t, size_t> > anchors;
+	for (const auto &eachMinimizer : minimizers(querySequence)) {
+		const auto indexIt = minimizerIndex.find(eachMinimizer.first);
+		if ( ( indexIt == minimizerIndex.end() ) || (indexIt->second.size() > maxSeedOccurrences) ) {
+			continue;
+		}
+		for (const auto &refPosition : indexIt->second) {
+			anchors.emplace_back(refPosition, eachMinimizer.second);
+		}
+	}
+	if ( anchors.empty() ) {
+		return this->extractSequence(querySequence);
+	}
+	std::sort( anchors.begin(), anchors.end() );
+	// colinear chaining with concave gap costs
+	const auto kmerScore = static_cast<double>(minimizerK);
+	std::vector<double> chainScores( anchors.size() );
+	std::vector<size_t> predecessors( anchors.size() );
+	size_t bestAnchor{0};
+	for (size_t iAnchor = 0; iAnchor < anchors.size(); ++iAnchor) {
+		chainScores[iAnchor]  = kmerScore;
+		predecessors[iAnchor] = iAnchor;
+		const size_t firstCandidate = iAnchor > chainLookback ? iAnchor - chainLookback : 0;
+		for (size_t jAnchor = iAnchor; jAnchor > firstCandidate; --jAnchor) {
+			const auto &previous = anchors[jAnchor - 1];
+			const auto &current  = anchors[iAnchor];
+			if ( (previous.first >= current.first) || (previous.second >= current.second) ) {
+				continue;
+			}
+			const size_t refDistance   = current.first - previous.first;
+			const size_t queryDistance = current.second - previous.second;
+			if ( (refDistance > chainMaxGap) || (queryDistance > chainMaxGap) ) {
+				continue;
+			}
+			const size_t gapLength = refDistance > queryDistance ? refDistance - queryDistance : queryDistance - refDistance;
+			if (gapLength > chainBandwidth) {
+				continue;
+			}
+			const auto matchedBases = static_cast<double>( std::min( std::min(refDistance, queryDistance), minimizerK ) );
+			const double gapCost    = gapLength == 0 ? 0.0 : 0.01 * kmerScore * static_cast<double>(gapLength) + 0.5 * std::log2( static_cast<double>(gapLength) );
+			const double candidate  = chainScores[jAnchor - 1] + matchedBases - gapCost;
+			if (candidate > chainScores[iAnchor]) {
+				chainScores[iAnchor]  = candidate;
+				predecessors[iAnchor] = jAnchor - 1;
+			}
+		}
+		if (chainScores[iAnchor] > chainScores[bestAnchor]) {
+			bestAnchor = iAnchor;
+		}
+	}
+	size_t firstAnchor{bestAnchor};
+	while (predecessors[firstAnchor] != firstAnchor) {
+		firstAnchor = predecessors[firstAnchor];
+	}
+	// the chain covers [first anchor start, last anchor end); extend both ends into the flanking sequence
+	size_t refBegin   = anchors[firstAnchor].first;
+	size_t queryBegin = anchors[firstAnchor].second;
+	size_t refEnd     = anchors[bestAnchor].first + minimizerK;
+	size_t queryEnd   = anchors[bestAnchor].second + minimizerK;
+	const size_t leftRefStart = refBegin > queryBegin + extensionBand ? refBegin - queryBegin - extensionBand : 0;
+	std::string leftQuery( querySequence.crend() - static_cast<std::string::difference_type>(queryBegin), querySequence.crend() );
+	std::string leftReference( ungapped.crend() - static_cast<std::string::difference_type>(refBegin),
+								ungapped.crend() - static_cast<std::string::difference_type>(leftRefStart) );
+	const auto leftExtension = bandedExtension(leftQuery, leftReference);
+	queryBegin -= leftExtension.first;
+	refBegin   -= leftExtension.second;
+	const size_t rightRefLength = std::min(ungapped.size() - refEnd, querySequence.size() - queryEnd + extensionBand);
+	const auto rightExtension   = bandedExtension( querySequence.substr(queryEnd), ungapped.substr(refEnd, rightRefLength) );
+	queryEnd += rightExtension.first;
+	refEnd   += rightExtension.second;
+	AlignmentStatistics result{
+		columnIndexes[refBegin],
+		columnIndexes[refEnd - 1] - columnIndexes[refBegin],
+		queryBegin,
+		queryEnd - 1 - queryBegin,
+	};
+	return result;
+}
+
+std::vector<ConservedRegion> ParseFASTA::conservedRegions(const size_t &windowSize, const uint32_t &maxVariableSites, const double &minGC, const double &maxGC) const {
+	if ( (windowSize == 0) || ( windowSize > this->alignmentLength() ) ) {
+		throw std::string("ERROR: window size must be positive and no larger than the alignment length in " ) +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if (minGC > maxGC) {
+		throw std::string("ERROR: minimal GC content must not exceed the maximum in " ) +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	// per-column counts: variable site, consensus G or C, consensus A, C, G, or T
+	auto columnCounts = [this](size_t iCol, uint32_t &variable, uint32_t &gc, uint32_t &nucleotides){
+		variable    = this->isVariable(iCol) ? 1 : 0;
+		const uint8_t consensusMask = iupacMask(consensus_[iCol]);
+		nucleotides = __builtin_popcount(consensusMask) == 1 ? 1 : 0;
+		gc          = (consensusMask == 2) || (consensusMask == 4) ? 1 : 0;
+	};
+	uint32_t windowVariable{0};
+	uint32_t windowGC{0};
+	uint32_t windowNucleotides{0};
+	uint32_t colVariable{0};
+	uint32_t colGC{0};
+	uint32_t colNucleotides{0};
+	for (size_t iCol = 0; iCol < windowSize; ++iCol) {
+		columnCounts(iCol, colVariable, colGC, colNucleotides);
+		windowVariable    += colVariable;
+		windowGC          += colGC;
+		windowNucleotides += colNucleotides;
+	}
+	std::vector<ConservedRegion> result;
+	size_t windowStart{0};
+	while (true) {
+		if (windowVariable <= maxVariableSites) {
+			const double gcContent = windowNucleotides > 0 ? static_cast<double>(windowGC) / static_cast<double>(windowNucleotides) : 0.0;
+			if ( (gcContent >= minGC) && (gcContent <= maxGC) ) {
+				result.push_back( ConservedRegion{windowStart, windowSize, windowVariable, gcContent} );
+			}
+		}
+		if ( windowStart + windowSize >= this->alignmentLength() ) {
+			break;
+		}
+		columnCounts(windowStart, colVariable, colGC, colNucleotides);
+		windowVariable    -= colVariable;
+		windowGC          -= colGC;
+		windowNucleotides -= colNucleotides;
+		columnCounts(windowStart + windowSize, colVariable, colGC, colNucleotides);
+		windowVariable    += colVariable;
+		windowGC          += colGC;
+		windowNucleotides += colNucleotides;
+		++windowStart;
+	}
+	const double middleGC = (minGC + maxGC) / 2.0;
+	std::sort(
+		result.begin(),
+		result.end(),
+		[middleGC](const ConservedRegion &first, const ConservedRegion &second){
+			if (first.variableSites != second.variableSites) {
+				return first.variableSites < second.variableSites;
+			}
+			const double firstDistance  = std::fabs(first.gcContent - middleGC);
+			const double secondDistance = std::fabs(second.gcContent - middleGC);
+			if (firstDistance != secondDistance) {
+				return firstDistance < secondDistance;
+			}
+			return first.start < second.start;
+		});
+	// keep a window only if it does not overlap a higher-ranked one, so shifted copies of a region do not crowd the top of the list
+	std::set<size_t> keptStarts;
+	std::vector<ConservedRegion> distinctRegions;
+	for (const auto &eachRegion : result) {
+		const auto nextKept = keptStarts.lower_bound(eachRegion.start);
+		if ( ( nextKept != keptStarts.end() ) && (*nextKept < eachRegion.start + windowSize) ) {
+			continue;
+		}
+		if ( ( nextKept != keptStarts.begin() ) && (*std::prev(nextKept) + windowSize > eachRegion.start) ) {
+			continue;
+		}
+		keptStarts.insert(eachRegion.start);
+		distinctRegions.push_back(eachRegion);
+	}
+	return distinctRegions;
+}
+
+std::vector<PlacementStatistics> ParseFASTA::placeSequences(const std::vector< std::pair<std::string, std::string> > &newSequences, const size_t &nThreads) {
+	std::vector<std::string> queries;
+	queries.reserve( newSequences.size() );
+	for (const auto &eachSequence : newSequences) {
+		std::string query;
+		std::copy_if( eachSequence.second.cbegin(), eachSequence.second.cend(), std::back_inserter(query), [](char residue){return residue != '-';} );
+		if ( query.empty() ) {
+			throw std::string("ERROR: sequence ") + eachSequence.first + std::string(" has no residues in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		queries.push_back( std::move(query) );
+	}
+	std::string ungappedConsensus;
+	std::vector<size_t> columnIndexes;
+	this->ungappedConsensus_(ungappedConsensus, columnIndexes);
+	std::vector<StripedSmithWaterman::Alignment> swAlignments( queries.size() );
+	const size_t threadCount = std::max( size_t{1}, std::min( nThreads, queries.size() ) );
+	std::vector<std::thread> placementThreads;
+	placementThreads.reserve(threadCount);
+	for (size_t iThread = 0; iThread < threadCount; ++iThread) {
+		placementThreads.emplace_back(
+			[&queries, &ungappedConsensus, &swAlignments, iThread, threadCount](){
+				StripedSmithWaterman::Aligner aligner(swMatchScore, swMismatchPenalty, swGapOpenPenalty, swGapExtendPenalty);
+				StripedSmithWaterman::Filter filter;
+				for (size_t iQuery = iThread; iQuery < queries.size(); iQuery += threadCount) {
+					int32_t maskLen{static_cast<int32_t>(queries[iQuery].size() / 2)};
+					maskLen = maskLen < swMinMaskLen ? swMinMaskLen : maskLen;
+					aligner.Align(queries[iQuery].c_str(), ungappedConsensus.c_str(), static_cast<int32_t>( ungappedConsensus.size() ), filter, &swAlignments[iQuery], maskLen);
+				}
+			}
+		);
+	}
+	for (auto &eachThread : placementThreads) {
+		eachThread.join();
+	}
+	// project each alignment into the consensus columns by walking its CIGAR string
+	std::vector<PlacementStatistics> result;
+	result.reserve( queries.size() );
+	for (size_t iQuery = 0; iQuery < queries.size(); ++iQuery) {
+		const auto &swAlignment = swAlignments[iQuery];
+		if ( (swAlignment.ref_begin < 0) || (swAlignment.query_begin < 0) || (swAlignment.query_end < swAlignment.query_begin) ) {
+			throw std::string("ERROR: sequence ") + newSequences[iQuery].first + std::string(" cannot be aligned to the consensus in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		std::string alignedSequence(consensus_.size(), '-');
+		auto queryPosition     = static_cast<size_t>(swAlignment.query_begin);
+		auto consensusPosition = static_cast<size_t>(swAlignment.ref_begin);
+		PlacementStatistics placement{0, 0, 0};
+		size_t opLength{0};
+		for (const auto &cigarChar : swAlignment.cigar_string) {
+			if ( std::isdigit( static_cast<unsigned char>(cigarChar) ) ) {
+				opLength = opLength * 10 + static_cast<size_t>(cigarChar - '0');
+				continue;
+			}
+			switch (cigarChar) {
+				case 'M':
+				case '=':
+				case 'X':
+					for (size_t iOp = 0; (iOp < opLength) && ( consensusPosition < columnIndexes.size() ) && ( queryPosition < queries[iQuery].size() ); ++iOp) {
+						alignedSequence[columnIndexes[consensusPosition]] = queries[iQuery][queryPosition];
+						++consensusPosition;
+						++queryPosition;
+						++placement.placedResidues;
+					}
+					break;
+				case 'I':
+					queryPosition               += opLength;
+					placement.droppedInsertions += opLength;
+					break;
+				case 'D':
+					consensusPosition += opLength;
+					break;
+				default:                                                                                 // soft clips are accounted for by the alignment start and end
+					break;
+			}
+			opLength = 0;
+		}
+		placement.clippedResidues = queries[iQuery].size() - placement.placedResidues - placement.droppedInsertions;
+		if ( !storageIndex_.empty() ) {
+			storageIndex_.push_back( fastaAlignment_.size() );
+		}
+		if ( !sampleSelection_.empty() ) {
+			sampleSelection_.resize(fastaAlignment_.size() / wordSize + 1, 0);
+			sampleSelection_[fastaAlignment_.size() / wordSize] |= 1ULL << (fastaAlignment_.size() % wordSize);
+		}
+		fastaAlignment_.emplace_back( newSequences[iQuery].first, std::move(alignedSequence) );
+		result.push_back(placement);
+	}
+	consensus_.clear();
+	this->makeConsensus_();
+	this->makeMissingData_();
+	if (checkpointSpacing_ > 0) {
+		this->buildPrefixHashIndex(checkpointSpacing_);
+	}
+	return result;
+}
+
+void ParseFASTA::reorderBySimilarity() {
+	// order holds storage positions; each variable column is a stable counting sort on the residue
+	std::vector<size_t> order( fastaAlignment_.size() );
+	std::iota(order.begin(), order.end(), 0);
+	std::vector<size_t> nextOrder( order.size() );
+	constexpr size_t nChars{256};
+	std::array<size_t, nChars + 1> bucketStarts{};
+	for (size_t iCol = 0; iCol < consensus_.size(); ++iCol) {
+		if ( !this->isVariable(iCol) ) {
+			continue;
+		}
+		bucketStarts.fill(0);
+		for (const auto &storageIdx : order) {
+			++bucketStarts[static_cast<unsigned char>(fastaAlignment_[storageIdx].second[iCol]) + 1];
+		}
+		std::partial_sum( bucketStarts.begin(), bucketStarts.end(), bucketStarts.begin() );
+		for (const auto &storageIdx : order) {
+			nextOrder[bucketStarts[static_cast<unsigned char>(fastaAlignment_[storageIdx].second[iCol])]++] = storageIdx;
+		}
+		order.swap(nextOrder);
+	}
+	std::vector<size_t> newPosition( order.size() );
+	std::vector< std::pair<std::string, std::string> > reorderedAlignment;
+	reorderedAlignment.reserve( fastaAlignment_.size() );
+	for (size_t iNew = 0; iNew < order.size(); ++iNew) {
+		newPosition[order[iNew]] = iNew;
+		reorderedAlignment.push_back( std::move(fastaAlignment_[order[iNew]]) );
+	}
+	std::vector< std::vector<uint64_t> > reorderedMissing;
+	reorderedMissing.reserve( missingData_.size() );
+	for (const auto &storageIdx : order) {
+		reorderedMissing.push_back( std::move(missingData_[storageIdx]) );
+	}
+	missingData_ = std::move(reorderedMissing);
+	if ( !prefixCheckpoints_.empty() ) {
+		std::vector< std::vector< std::array<uint64_t, 2> > > reorderedCheckpoints;
+		reorderedCheckpoints.reserve( prefixCheckpoints_.size() );
+		for (const auto &storageIdx : order) {
+			reorderedCheckpoints.push_back( std::move(prefixCheckpoints_[storageIdx]) );
+		}
+		prefixCheckpoints_ = std::move(reorderedCheckpoints);
+	}
+	if ( !sampleSelection_.empty() ) {
+		std::vector<uint64_t> reorderedSelection(sampleSelection_.size(), 0);
+		for (size_t iNew = 0; iNew < order.size(); ++iNew) {
+			if ( ( sampleSelection_[order[iNew] / wordSize] & ( 1ULL << (order[iNew] % wordSize) ) ) != 0 ) {
+				reorderedSelection[iNew / wordSize] |= 1ULL << (iNew % wordSize);
+			}
+		}
+		sampleSelection_ = std::move(reorderedSelection);
+	}
+	if ( storageIndex_.empty() ) {
+		storageIndex_ = std::move(newPosition);
+	} else {
+		for (auto &eachPosition : storageIndex_) {
+			eachPosition = newPosition[eachPosition];
+		}
+	}
+	fastaAlignment_ = std::move(reorderedAlignment);
+}
+
+uint64_t ParseFASTA::alignmentHash() const noexcept {
+	uint64_t hash{fnvOffsetBasis};
+	for (size_t iSeq = 0; iSeq < fastaAlignment_.size(); ++iSeq) {
+		const auto &eachSeq = fastaAlignment_[storageIndex_.empty() ? iSeq : storageIndex_[iSeq]];
+		hash = fnv1aUpdate(eachSeq.first, hash);
+		hash = fnv1aUpdate(eachSeq.second, hash);
+	}
+	return hash;
+}
+
+void ParseFASTA::imputeMissing() {
+	const std::string standardNucleotides("AaCcTtGg-");
+	for (auto &eachSeq : fastaAlignment_) {
+		std::transform(
+			eachSeq.second.cbegin(), eachSeq.second.cend(),
+			consensus_.cbegin(),
 			eachSeq.second.begin(),
 			[&standardNucleotides](char nuc1, char nuc2){
 				return standardNucleotides.find_first_of(nuc1)== std::string::npos ? nuc2 : nuc1;
 			});
 	}
+	// diversity and variable sites change with the imputed residues
+	consensus_.clear();
+	this->makeConsensus_();
+	this->makeMissingData_();
+	if (checkpointSpacing_ > 0) {
+		this->buildPrefixHashIndex(checkpointSpacing_);
+	}
 }
 
 void ParseFASTA::makeConsensus_() {
 	const size_t alignLength = this->alignmentLength();
 	const std::string standardNucleotides("AaCcTtGgNn-");
+	variableSites_.assign( (alignLength + wordSize - 1) / wordSize, 0 );
+	polymorphicColumns_.assign( (alignLength + wordSize - 1) / wordSize, 0 );
+	diversityPrefix_.assign(alignLength + 1, 0.0);
 	for (size_t iNuc = 0; iNuc < alignLength; ++iNuc) {
+		diversityPrefix_[iNuc + 1] = diversityPrefix_[iNuc];
+		if ( this->isMasked_(iNuc) ) {
+			consensus_.push_back('N');
+			continue;
+		}
 		std::unordered_map<char, uint32_t> nucleotides;
+		uint8_t columnStates{0};
+		std::array<uint32_t, 4> alleleCounts{0, 0, 0, 0};
+		const char firstResidue{fastaAlignment_.front().second.at(iNuc)};
+		bool polymorphic{false};
 		for (const auto &eachSeq : fastaAlignment_) {
 			char curNucleotide{eachSeq.second.at(iNuc)};
+			polymorphic = polymorphic || (curNucleotide != firstResidue);
 			const auto cnPos = standardNucleotides.find_first_of(curNucleotide);
 			if (cnPos != std::string::npos) {
 				++nucleotides[curNucleotide];
 			}
+			// gaps get their own state bit; ambiguous residues are not counted
+			const uint8_t nucMask = curNucleotide == '-' ? uint8_t{16} : iupacMask(curNucleotide);
+			if (__builtin_popcount(nucMask) == 1) {
+				columnStates |= nucMask;
+				if (nucMask < 16) {
+					++alleleCounts[static_cast<size_t>( __builtin_ctz(nucMask) )];
+				}
+			}
+		}
+		if (__builtin_popcount(columnStates) > 1) {
+			variableSites_[iNuc / wordSize] |= 1ULL << (iNuc % wordSize);
+		}
+		if (polymorphic) {
+			polymorphicColumns_[iNuc / wordSize] |= 1ULL << (iNuc % wordSize);
+		}
+		// expected heterozygosity with the sample size correction, among called nucleotides
+		double nAlleles{0.0};
+		double sumSquares{0.0};
+		for (const auto &eachCount : alleleCounts) {
+			nAlleles   += static_cast<double>(eachCount);
+			sumSquares += static_cast<double>(eachCount) * static_cast<double>(eachCount);
+		}
+		if (nAlleles > 1.0) {
+			diversityPrefix_[iNuc + 1] += (nAlleles * nAlleles - sumSquares) / ( nAlleles * (nAlleles - 1.0) );
 		}
 		auto maxCountIt = std::max_element(nucleotides.begin(), nucleotides.end(), 
 			[](std::pair<char, uint32_t> count1, std::pair<char, uint32_t> count2){
@@ -249,3 +1860,434 @@ void ParseFASTA::makeConsensus_() {
 		}
 	}
 }
+
+bool ParseFASTA::isMasked_(const size_t &alignmentColumn) const noexcept {
+	return !mask_.empty() && ( ( mask_[alignmentColumn / wordSize] & ( 1ULL << (alignmentColumn % wordSize) ) ) != 0 );
+}
+
+void ParseFASTA::appendUnmasked_(const std::string &alignedSequence, const size_t &startIdx, const size_t &windowLength, std::string &window) const {
+	const size_t windowEnd = std::min( startIdx + windowLength, alignedSequence.size() );
+	size_t iCol            = startIdx;
+	while (iCol < windowEnd) {
+		const size_t wordEnd = std::min( (iCol / wordSize + 1) * wordSize, windowEnd );
+		uint64_t maskedBits  = mask_[iCol / wordSize] >> (iCol % wordSize);           // bit 0 is the current column
+		// alternate between runs of unmasked and masked columns within the word
+		while (iCol < wordEnd) {
+			const size_t unmaskedRun = maskedBits == 0 ? wordSize : static_cast<size_t>( __builtin_ctzll(maskedBits) );
+			const size_t unmaskedEnd = std::min(iCol + unmaskedRun, wordEnd);
+			window.append(alignedSequence, iCol, unmaskedEnd - iCol);
+			maskedBits = unmaskedEnd - iCol < wordSize ? maskedBits >> (unmaskedEnd - iCol) : 0;
+			iCol       = unmaskedEnd;
+			if (iCol >= wordEnd) {
+				break;
+			}
+			const size_t maskedRun = ~maskedBits == 0 ? wordSize : static_cast<size_t>( __builtin_ctzll(~maskedBits) );
+			const size_t maskedEnd = std::min(iCol + maskedRun, wordEnd);
+			maskedBits = maskedEnd - iCol < wordSize ? maskedBits >> (maskedEnd - iCol) : 0;
+			iCol       = maskedEnd;
+		}
+	}
+}
+
+void ParseFASTA::makeMissingData_() {
+	std::array<bool, 256> isMissing{};
+	for (size_t iChar = 0; iChar < isMissing.size(); ++iChar) {
+		isMissing[iChar] = __builtin_popcount( iupacMask( static_cast<char>(iChar) ) ) != 1;
+	}
+	const size_t nWords = (this->alignmentLength() + wordSize - 1) / wordSize;
+	missingData_.assign( fastaAlignment_.size(), std::vector<uint64_t>(nWords, 0) );
+	for (size_t iSeq = 0; iSeq < fastaAlignment_.size(); ++iSeq) {
+		const std::string &alignedSequence = fastaAlignment_[iSeq].second;
+		for (size_t iCol = 0; iCol < alignedSequence.size(); ++iCol) {
+			if ( isMissing[static_cast<unsigned char>(alignedSequence[iCol])] ) {
+				missingData_[iSeq][iCol / wordSize] |= 1ULL << (iCol % wordSize);
+			}
+		}
+	}
+}
+
+bool ParseFASTA::tooMuchMissing_(const size_t &storageIdx, const size_t &startIdx, const size_t &windowLength) const {
+	if (maxMissing_ >= 1.0) {
+		return false;
+	}
+	const size_t nUnmasked = this->unmaskedColumns(startIdx, windowLength);
+	if (nUnmasked == 0) {
+		return false;
+	}
+	return static_cast<double>( this->missingInWindow_(missingData_[storageIdx], startIdx, windowLength) ) > maxMissing_ * static_cast<double>(nUnmasked);
+}
+
+bool ParseFASTA::isExcluded_(const size_t &storageIdx, const size_t &startIdx, const size_t &windowLength) const {
+	if ( !sampleSelection_.empty() && ( ( sampleSelection_[storageIdx / wordSize] & ( 1ULL << (storageIdx % wordSize) ) ) == 0 ) ) {
+		return true;
+	}
+	return this->tooMuchMissing_(storageIdx, startIdx, windowLength);
+}
+
+std::unordered_map<std::string, uint32_t> ParseFASTA::compatibleGroups_(std::unordered_map<std::string, uint32_t> &&windowTable) const {
+	if (windowTable.size() < 2) {
+		return std::move(windowTable);
+	}
+	// allowed states of a residue: IUPAC nucleotide bits, gap is 16; N and other unknown characters allow everything
+	constexpr size_t nStates{5};
+	constexpr uint8_t gapState{16};
+	constexpr uint8_t anyState{31};
+	constexpr uint8_t anyNucleotide{15};
+	auto stateMask = [](char residue){
+		if (residue == '-') {
+			return gapState;
+		}
+		const uint8_t nucMask = iupacMask(residue);
+		return nucMask == anyNucleotide ? anyState : nucMask;
+	};
+	// all windows have the same unmasked columns, so the same length
+	const size_t windowLength = windowTable.cbegin()->first.size();
+	const size_t nWords       = (windowLength + wordSize - 1) / wordSize;
+	const uint64_t lastWord   = windowLength % wordSize == 0 ? ~0ULL : ( 1ULL << (windowLength % wordSize) ) - 1;
+	// each haplotype is nStates bit planes of nWords words; a set bit allows the state at the position
+	struct Haplotype {
+		std::vector<uint64_t> stateBits;
+		uint32_t count;
+		size_t definiteSites;
+		std::string window;
+	};
+	std::vector<Haplotype> haplotypes;
+	haplotypes.reserve( windowTable.size() );
+	for (auto &eachWindow : windowTable) {
+		Haplotype haplotype{std::vector<uint64_t>(nStates * nWords, 0), eachWindow.second, 0, eachWindow.first};
+		for (size_t iPos = 0; iPos < windowLength; ++iPos) {
+			const uint8_t mask = stateMask(eachWindow.first[iPos]);
+			haplotype.definiteSites += __builtin_popcount(mask) == 1 ? 1 : 0;
+			for (size_t iState = 0; iState < nStates; ++iState) {
+				if ( ( mask & (1U << iState) ) != 0 ) {
+					haplotype.stateBits[iState * nWords + iPos / wordSize] |= 1ULL << (iPos % wordSize);
+				}
+			}
+		}
+		haplotypes.push_back( std::move(haplotype) );
+	}
+	// the most complete windows seed groups first
+	std::sort(haplotypes.begin(), haplotypes.end(), [](const Haplotype &first, const Haplotype &second){
+		if (first.definiteSites != second.definiteSites) {
+			return first.definiteSites > second.definiteSites;
+		}
+		if (first.count != second.count) {
+			return first.count > second.count;
+		}
+		return first.window < second.window;
+	});
+	// windows are compatible if every position allows a common state
+	auto compatible = [nWords, lastWord](const std::vector<uint64_t> &first, const std::vector<uint64_t> &second){
+		for (size_t iWord = 0; iWord < nWords; ++iWord) {
+			uint64_t sharedState{0};
+			for (size_t iState = 0; iState < nStates; ++iState) {
+				sharedState |= first[iState * nWords + iWord] & second[iState * nWords + iWord];
+			}
+			if ( sharedState != (iWord + 1 == nWords ? lastWord : ~0ULL) ) {
+				return false;
+			}
+		}
+		return true;
+	};
+	// a group keeps the states allowed by all its members, so compatibility with the group means compatibility with every member
+	std::vector<Haplotype> groups;
+	for (auto &eachHaplotype : haplotypes) {
+		Haplotype *bestGroup{nullptr};
+		for (auto &eachGroup : groups) {
+			if ( ( (bestGroup == nullptr) || (eachGroup.count > bestGroup->count) ) && compatible(eachGroup.stateBits, eachHaplotype.stateBits) ) {
+				bestGroup = &eachGroup;
+			}
+		}
+		if (bestGroup == nullptr) {
+			groups.push_back( std::move(eachHaplotype) );
+			continue;
+		}
+		for (size_t iWord = 0; iWord < bestGroup->stateBits.size(); ++iWord) {
+			bestGroup->stateBits[iWord] &= eachHaplotype.stateBits[iWord];
+		}
+		bestGroup->count += eachHaplotype.count;
+	}
+	// each group is reported as its resolved sequence: nucleotides or gaps where known, IUPAC codes where still ambiguous
+	std::array<char, anyState + 1> stateCodes{};
+	stateCodes.fill('N');
+	for (const char &eachCode : std::string("ACGTRYSWKMBDHV") ) {
+		stateCodes[iupacMask(eachCode)] = eachCode;
+	}
+	stateCodes[gapState] = '-';
+	std::unordered_map<std::string, uint32_t> result;
+	for (const auto &eachGroup : groups) {
+		std::string resolved(windowLength, 'N');
+		for (size_t iPos = 0; iPos < windowLength; ++iPos) {
+			size_t mask{0};
+			for (size_t iState = 0; iState < nStates; ++iState) {
+				mask |= ( ( eachGroup.stateBits[iState * nWords + iPos / wordSize] >> (iPos % wordSize) ) & 1ULL ) << iState;
+			}
+			resolved[iPos] = stateCodes[mask];
+		}
+		result[resolved] += eachGroup.count;
+	}
+	return result;
+}
+
+std::string ParseFASTA::windowSequence_(const std::string &alignedSequence, const size_t &startIdx, const size_t &windowLength) const {
+	if ( mask_.empty() ) {
+		return alignedSequence.substr(startIdx, windowLength);
+	}
+	std::string window;
+	this->appendUnmasked_(alignedSequence, startIdx, windowLength, window);
+	return window;
+}
+
+std::vector<uint32_t> ParseFASTA::windowCounts_(const size_t &windowStartPosition, const size_t &windowSize, const WindowEngine &engine) const {
+	std::unordered_map<std::string, uint32_t> sequenceTable;
+	if ( (engine == WindowEngine::projection) || (engine == WindowEngine::packed) ) {
+		// monomorphic columns are the same in every sequence, so counts (and compatibility) depend only on the projection
+		for (auto &eachProjection : this->projectedWindow_(windowStartPosition, windowSize, engine) ) {
+			sequenceTable.emplace(eachProjection.first, eachProjection.second.first);
+		}
+	} else if (engine == WindowEngine::prefixHash) {
+		const std::vector< std::pair<uint32_t, size_t> > groups{this->hashedWindow_(windowStartPosition, windowSize)};
+		if (!groupCompatible_) {
+			std::vector<uint32_t> counts;
+			counts.reserve( groups.size() );
+			for (const auto &eachGroup : groups) {
+				counts.push_back(eachGroup.first);
+			}
+			return counts;
+		}
+		// compatibility needs the residues, so only then are the distinct windows built
+		for (const auto &eachGroup : groups) {
+			sequenceTable.emplace(this->windowSequence_(fastaAlignment_[eachGroup.second].second, windowStartPosition, windowSize), eachGroup.first);
+		}
+	} else {
+		for (size_t iSeq = 0; iSeq < fastaAlignment_.size(); ++iSeq) {
+			if ( this->isExcluded_(iSeq, windowStartPosition, windowSize) ) {
+				continue;
+			}
+			++sequenceTable[this->windowSequence_(fastaAlignment_[iSeq].second, windowStartPosition, windowSize)];
+		}
+	}
+	if (groupCompatible_) {
+		sequenceTable = this->compatibleGroups_( std::move(sequenceTable) );
+	}
+	std::vector<uint32_t> counts;
+	counts.reserve( sequenceTable.size() );
+	for (const auto &eachSequence : sequenceTable) {
+		counts.push_back(eachSequence.second);
+	}
+	return counts;
+}
+
+std::vector<size_t> ParseFASTA::projectionColumns_(const size_t &windowStartPosition, const size_t &windowSize) const {
+	const size_t windowEnd = std::min( windowStartPosition + windowSize, this->alignmentLength() );
+	std::vector<size_t> columns;
+	if (windowStartPosition >= windowEnd) {
+		return columns;
+	}
+	const size_t firstWord = windowStartPosition / wordSize;
+	const size_t lastWord  = (windowEnd - 1) / wordSize;
+	for (size_t iWord = firstWord; iWord <= lastWord; ++iWord) {
+		uint64_t word = polymorphicColumns_[iWord];
+		if (iWord == firstWord) {
+			word &= ~0ULL << (windowStartPosition % wordSize);
+		}
+		if ( (iWord == lastWord) && (windowEnd % wordSize != 0) ) {
+			word &= ( 1ULL << (windowEnd % wordSize) ) - 1;
+		}
+		while (word != 0) {
+			columns.push_back( iWord * wordSize + static_cast<size_t>( __builtin_ctzll(word) ) );
+			word &= word - 1;
+		}
+	}
+	return columns;
+}
+
+std::unordered_map< std::string, std::pair<uint32_t, size_t> > ParseFASTA::projectedWindow_(const size_t &windowStartPosition, const size_t &windowSize,
+																								const WindowEngine &engine) const {
+	const std::vector<size_t> columns{this->projectionColumns_(windowStartPosition, windowSize)};
+	if (engine == WindowEngine::packed) {
+		if (columns.size() <= residuesPerWord) {
+			return this->packedWindow_<1>(windowStartPosition, windowSize, columns);
+		}
+		if (columns.size() <= 2 * residuesPerWord) {
+			return this->packedWindow_<2>(windowStartPosition, windowSize, columns);
+		}
+	}
+	std::unordered_map< std::string, std::pair<uint32_t, size_t> > projections;
+	std::string projection;
+	for (size_t iSeq = 0; iSeq < fastaAlignment_.size(); ++iSeq) {
+		if ( this->isExcluded_(iSeq, windowStartPosition, windowSize) ) {
+			continue;
+		}
+		projection.clear();
+		for (const auto &iCol : columns) {
+			projection.push_back(fastaAlignment_[iSeq].second[iCol]);
+		}
+		auto projectionIt = projections.find(projection);
+		if ( projectionIt == projections.end() ) {
+			projections.emplace( projection, std::pair<uint32_t, size_t>{1, iSeq} );
+		} else {
+			++projectionIt->second.first;
+		}
+	}
+	return projections;
+}
+
+template <size_t nWords>
+std::unordered_map< std::string, std::pair<uint32_t, size_t> > ParseFASTA::packedWindow_(const size_t &windowStartPosition, const size_t &windowSize,
+																							const std::vector<size_t> &columns) const {
+	std::unordered_map< std::string, std::pair<uint32_t, size_t> > projections;
+	std::unordered_map<std::array<uint64_t, nWords>, std::pair<uint32_t, size_t>, PackedKeyHash> packedKeys;
+	std::string projection;
+	for (size_t iSeq = 0; iSeq < fastaAlignment_.size(); ++iSeq) {
+		if ( this->isExcluded_(iSeq, windowStartPosition, windowSize) ) {
+			continue;
+		}
+		const std::string &alignedSequence = fastaAlignment_[iSeq].second;
+		std::array<uint64_t, nWords> key{};
+		bool packable{true};
+		for (size_t iCol = 0; iCol < columns.size(); ++iCol) {
+			const uint64_t code = twoBitCode(alignedSequence[columns[iCol]]);
+			if (code > 3) {
+				packable = false;
+				break;
+			}
+			key[iCol / residuesPerWord] |= code << ( 2 * (iCol % residuesPerWord) );
+		}
+		if (packable) {
+			auto &entry = packedKeys.emplace( key, std::pair<uint32_t, size_t>{0, iSeq} ).first->second;
+			++entry.first;
+			continue;
+		}
+		// strings with other residues never match a packed key
+		projection.clear();
+		for (const auto &iCol : columns) {
+			projection.push_back(alignedSequence[iCol]);
+		}
+		auto projectionIt = projections.find(projection);
+		if ( projectionIt == projections.end() ) {
+			projections.emplace( projection, std::pair<uint32_t, size_t>{1, iSeq} );
+		} else {
+			++projectionIt->second.first;
+		}
+	}
+	// only the distinct keys are turned into strings, from their first sequence
+	for (const auto &eachKey : packedKeys) {
+		const std::string &firstSequence = fastaAlignment_[eachKey.second.second].second;
+		projection.clear();
+		for (const auto &iCol : columns) {
+			projection.push_back(firstSequence[iCol]);
+		}
+		projections.emplace(projection, eachKey.second);
+	}
+	return projections;
+}
+
+std::array<uint64_t, 2> ParseFASTA::prefixHash_(const size_t &storageIdx, const size_t &alignmentColumn) const {
+	const size_t checkpointIdx = alignmentColumn / checkpointSpacing_;
+	std::array<uint64_t, 2> prefixHash{prefixCheckpoints_[storageIdx][checkpointIdx]};
+	const std::string &alignedSequence = fastaAlignment_[storageIdx].second;
+	for (size_t iCol = checkpointIdx * checkpointSpacing_; iCol < alignmentColumn; ++iCol) {
+		if ( this->isMasked_(iCol) ) {
+			continue;
+		}
+		for (size_t iBase = 0; iBase < hashBases.size(); ++iBase) {
+			prefixHash[iBase] = appendResidue(prefixHash[iBase], alignedSequence[iCol], hashBases[iBase]);
+		}
+	}
+	return prefixHash;
+}
+
+std::array<uint64_t, 2> ParseFASTA::rangeHash_(const size_t &storageIdx, const size_t &startIdx, const size_t &endIdx, const std::array<uint64_t, 2> &lengthPower) const {
+	const std::array<uint64_t, 2> startHash{this->prefixHash_(storageIdx, startIdx)};
+	const std::array<uint64_t, 2> endHash{this->prefixHash_(storageIdx, endIdx)};
+	std::array<uint64_t, 2> result{};
+	for (size_t iBase = 0; iBase < hashBases.size(); ++iBase) {
+		const uint64_t shifted = mulMod61(startHash[iBase], lengthPower[iBase]);
+		result[iBase]          = endHash[iBase] >= shifted ? endHash[iBase] - shifted : endHash[iBase] + hashModulus - shifted;
+	}
+	return result;
+}
+
+std::vector< std::pair<uint32_t, size_t> > ParseFASTA::hashedWindow_(const size_t &windowStartPosition, const size_t &windowSize) const {
+	if (checkpointSpacing_ == 0) {
+		throw std::string("ERROR: no prefix-hash index in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const size_t windowEnd = std::min( windowStartPosition + windowSize, this->alignmentLength() );
+	const std::array<uint64_t, 2> lengthPower{hashPower( this->unmaskedColumns(windowStartPosition, windowSize) )};
+	std::unordered_map<std::array<uint64_t, 2>, std::pair<uint32_t, size_t>, PackedKeyHash> groups;
+	for (size_t iSeq = 0; iSeq < fastaAlignment_.size(); ++iSeq) {
+		if ( this->isExcluded_(iSeq, windowStartPosition, windowSize) ) {
+			continue;
+		}
+		auto &entry = groups.emplace( this->rangeHash_(iSeq, windowStartPosition, windowEnd, lengthPower), std::pair<uint32_t, size_t>{0, iSeq} ).first->second;
+		++entry.first;
+	}
+	std::vector< std::pair<uint32_t, size_t> > result;
+	result.reserve( groups.size() );
+	for (const auto &eachGroup : groups) {
+		result.push_back(eachGroup.second);
+	}
+	return result;
+}
+
+std::vector< std::unordered_map<std::string, uint32_t> > ParseFASTA::windowPartitions_(const size_t &windowStartPosition, const size_t &windowSize, const size_t &nThreads) const {
+	// each thread counts a block of sequences into thread-local tables, one per hash partition
+	std::vector< std::vector< std::unordered_map<std::string, uint32_t> > > localTables( nThreads, std::vector< std::unordered_map<std::string, uint32_t> >(nThreads) );
+	const size_t blockSize = (fastaAlignment_.size() + nThreads - 1) / nThreads;
+	std::vector<std::thread> countThreads;
+	countThreads.reserve(nThreads);
+	for (size_t iThread = 0; iThread < nThreads; ++iThread) {
+		countThreads.emplace_back(
+			[this, &localTables, &windowStartPosition, &windowSize, blockSize, nThreads, iThread](){
+				const std::hash<std::string> windowHash;
+				const size_t blockEnd = std::min( (iThread + 1) * blockSize, fastaAlignment_.size() );
+				for (size_t iSeq = iThread * blockSize; iSeq < blockEnd; ++iSeq) {
+					if ( this->isExcluded_(iSeq, windowStartPosition, windowSize) ) {
+						continue;
+					}
+					std::string window{this->windowSequence_(fastaAlignment_[iSeq].second, windowStartPosition, windowSize)};
+					const size_t partition = windowHash(window) % nThreads;
+					++localTables[iThread][partition][std::move(window)];
+				}
+			}
+		);
+	}
+	for (auto &eachThread : countThreads) {
+		eachThread.join();
+	}
+	// partitions are disjoint, so each thread merges one of them with no locking
+	std::vector< std::unordered_map<std::string, uint32_t> > result(nThreads);
+	std::vector<std::thread> mergeThreads;
+	mergeThreads.reserve(nThreads);
+	for (size_t iPartition = 0; iPartition < nThreads; ++iPartition) {
+		mergeThreads.emplace_back(
+			[&localTables, &result, nThreads, iPartition](){
+				for (size_t iThread = 0; iThread < nThreads; ++iThread) {
+					for (auto &eachWindow : localTables[iThread][iPartition]) {
+						result[iPartition][eachWindow.first] += eachWindow.second;
+					}
+					localTables[iThread][iPartition].clear();
+				}
+			}
+		);
+	}
+	for (auto &eachThread : mergeThreads) {
+		eachThread.join();
+	}
+	return result;
+}
+
+void ParseFASTA::ungappedConsensus_(std::string &ungappedConsensus, std::vector<size_t> &columnIndexes) const {
+	ungappedConsensus.clear();
+	columnIndexes.clear();
+	ungappedConsensus.reserve( consensus_.size() );
+	columnIndexes.reserve( consensus_.size() );
+	for (size_t iCol = 0; iCol < consensus_.size(); ++iCol) {
+		if (consensus_[iCol] != '-') {
+			ungappedConsensus.push_back(consensus_[iCol]);
+			columnIndexes.push_back(iCol);
+		}
+	}
+}
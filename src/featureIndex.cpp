@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Annotation feature interval index
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Implementation of an interval index of annotation features and per-feature alignment statistics.
+ *
+ */
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <numeric>
+#include <thread>
+
+#include "featureIndex.hpp"
+#include "fastaParser.hpp"
+#include "coordinateIndex.hpp"
+
+using namespace BayesicSpace;
+
+FeatureIndex::FeatureIndex(std::vector<GenomicFeature> features) : features_{std::move(features)} {
+	for (const auto &eachFeature : features_) {
+		if (eachFeature.end <= eachFeature.start) {
+			throw std::string("ERROR: feature ") + eachFeature.name + std::string(" must end after its start in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+	}
+	this->index_();
+}
+
+std::vector<size_t> FeatureIndex::overlapping(const size_t &start, const size_t &end) const {
+	std::vector<size_t> result;
+	this->overlappingRange_(0, features_.size(), start, end, result);
+	return result;
+}
+
+void FeatureIndex::liftOver(const CoordinateIndex &sampleCoordinates) {
+	for (auto &eachFeature : features_) {
+		if ( eachFeature.end > sampleCoordinates.sequenceLength() ) {
+			throw std::string("ERROR: feature ") + eachFeature.name + std::string(" extends past the end of the sample sequence in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		const size_t endColumn = sampleCoordinates.toAlignmentColumn(eachFeature.end - 1) + 1;
+		eachFeature.start      = sampleCoordinates.toAlignmentColumn(eachFeature.start);
+		eachFeature.end        = endColumn;
+	}
+	// coordinate conversion preserves order, but the subtree maxima change
+	this->index_();
+}
+
+std::vector<FeatureStatistics> FeatureIndex::statistics(const ParseFASTA &alignment, const size_t &nThreads) const {
+	std::vector<size_t> featureIdxs( features_.size() );
+	std::iota(featureIdxs.begin(), featureIdxs.end(), 0);
+	return this->statistics(alignment, nThreads, featureIdxs);
+}
+
+std::vector<FeatureStatistics> FeatureIndex::statistics(const ParseFASTA &alignment, const size_t &nThreads, const std::vector<size_t> &featureIdxs) const {
+	for (const auto &featureIdx : featureIdxs) {
+		if ( featureIdx >= features_.size() ) {
+			throw std::string("ERROR: feature index out of range in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		if ( features_[featureIdx].end > alignment.alignmentLength() ) {
+			throw std::string("ERROR: feature ") + features_[featureIdx].name + std::string(" extends past the end of the alignment in ") +
+				std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+	}
+	std::vector<FeatureStatistics> result( featureIdxs.size() );
+	const size_t threadCount = std::max( size_t{1}, std::min( nThreads, featureIdxs.size() ) );
+	std::vector<std::thread> featureThreads;
+	featureThreads.reserve(threadCount);
+	for (size_t iThread = 0; iThread < threadCount; ++iThread) {
+		featureThreads.emplace_back(
+			[this, &alignment, &featureIdxs, &result, iThread, threadCount](){
+				for (size_t iResult = iThread; iResult < featureIdxs.size(); iResult += threadCount) {
+					const size_t iFeature = featureIdxs[iResult];
+					const size_t start    = features_[iFeature].start;
+					const size_t length   = features_[iFeature].end - start;
+					result[iResult].featureIdx          = iFeature;
+					result[iResult].unmaskedColumns     = alignment.unmaskedColumns(start, length);
+					result[iResult].variableSites       = alignment.variableSiteNumber(start, length);
+					result[iResult].haplotypes          = static_cast<uint32_t>( alignment.extractWindow(start, length).size() );
+					result[iResult].nucleotideDiversity = alignment.nucleotideDiversity(start, length);
+				}
+			}
+		);
+	}
+	for (auto &eachThread : featureThreads) {
+		eachThread.join();
+	}
+	return result;
+}
+
+void FeatureIndex::index_() {
+	std::stable_sort( features_.begin(), features_.end(),
+		[](const GenomicFeature &first, const GenomicFeature &second){return first.start < second.start;} );
+	subtreeMaxEnds_.assign(features_.size(), 0);
+	this->indexRange_( 0, features_.size() );
+}
+
+size_t FeatureIndex::indexRange_(const size_t &rangeStart, const size_t &rangeEnd) {
+	if (rangeStart >= rangeEnd) {
+		return 0;
+	}
+	const size_t middle     = rangeStart + (rangeEnd - rangeStart) / 2;
+	const size_t leftMax    = this->indexRange_(rangeStart, middle);
+	const size_t rightMax   = this->indexRange_(middle + 1, rangeEnd);
+	subtreeMaxEnds_[middle] = std::max( features_[middle].end, std::max(leftMax, rightMax) );
+	return subtreeMaxEnds_[middle];
+}
+
+void FeatureIndex::overlappingRange_(const size_t &rangeStart, const size_t &rangeEnd, const size_t &start, const size_t &end, std::vector<size_t> &result) const {
+	if (rangeStart >= rangeEnd) {
+		return;
+	}
+	const size_t middle = rangeStart + (rangeEnd - rangeStart) / 2;
+	// no feature in the range reaches past the interval start
+	if (subtreeMaxEnds_[middle] <= start) {
+		return;
+	}
+	this->overlappingRange_(rangeStart, middle, start, end, result);
+	// features from the middle on start at or after the interval end
+	if (features_[middle].start >= end) {
+		return;
+	}
+	if (features_[middle].end > start) {
+		result.push_back(middle);
+	}
+	this->overlappingRange_(middle + 1, rangeEnd, start, end, result);
+}
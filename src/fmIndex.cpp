@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// FM-index of aligned sequences
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Implementation of an FM-index over all gap-stripped sequences in an alignment, used for exact motif search.
+ *
+ */
+
+#include <array>
+#include <vector>
+#include <utility> // for std::pair
+#include <string>
+#include <numeric>
+#include <algorithm>
+#include <limits>
+
+#include "fmIndex.hpp"
+#include "fastaParser.hpp"
+#include "coordinateIndex.hpp"
+
+using namespace BayesicSpace;
+
+FMindex::FMindex(const ParseFASTA &alignment) {
+	constexpr uint8_t terminator{0};
+	constexpr uint8_t separator{1};
+	// concatenate gap-stripped sequences, each followed by a separator; the last one by the terminator
+	std::vector<uint8_t> text;
+	text.reserve( alignment.sequenceNumber() * alignment.alignmentLength() );
+	coordinates_.reserve( alignment.sequenceNumber() );
+	for (size_t iSeq = 0; iSeq < alignment.sequenceNumber(); ++iSeq) {
+		sequenceStarts_.push_back( text.size() );
+		coordinates_.emplace_back( alignment.sequence(iSeq) );
+		for (const auto &eachResidue : alignment.sequence(iSeq)) {
+			if (eachResidue != '-') {
+				text.push_back( symbolCode_(eachResidue) );
+			}
+		}
+		text.push_back(iSeq + 1 < alignment.sequenceNumber() ? separator : terminator);
+	}
+	textLength_ = text.size();
+	if ( textLength_ >= std::numeric_limits<uint32_t>::max() ) {
+		throw std::string("ERROR: too many residues for a 32-bit suffix array in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	// the terminator is unique and smallest, as induced sorting requires
+	const size_t alphabetSize{nSymbols_};
+	std::vector<uint32_t> suffixArray;
+	suffixArrayIS_(text, alphabetSize, suffixArray);
+	// BWT, symbol counts, and suffix array samples
+	const size_t nWords = textLength_ / wordSize_ + 1;
+	std::array<size_t, nSymbols_> symbolCounts{};
+	bwt_.resize(textLength_);
+	for (uint8_t iSymbol = firstResidue_; iSymbol < nSymbols_; ++iSymbol) {
+		symbolBits_[iSymbol].resize(nWords, 0);
+	}
+	sampledRows_.resize(nWords, 0);
+	for (size_t iRow = 0; iRow < textLength_; ++iRow) {
+		const uint32_t suffix = suffixArray[iRow];
+		bwt_[iRow]            = suffix == 0 ? terminator : text[suffix - 1];
+		++symbolCounts[text[suffix]];
+		if (bwt_[iRow] >= firstResidue_) {
+			symbolBits_[bwt_[iRow]][iRow / wordSize_] |= 1ULL << (iRow % wordSize_);
+		}
+		// rows at sequence starts are always sampled, so LF steps never cross a separator
+		if ( (suffix % sampleRate_ == 0) || (bwt_[iRow] < firstResidue_) ) {
+			sampledRows_[iRow / wordSize_] |= 1ULL << (iRow % wordSize_);
+			suffixSamples_.push_back(suffix);
+		}
+	}
+	size_t cumulativeCount{0};
+	for (size_t iSymbol = 0; iSymbol < nSymbols_; ++iSymbol) {
+		symbolStarts_[iSymbol] = cumulativeCount;
+		cumulativeCount       += symbolCounts[iSymbol];
+	}
+	for (uint8_t iSymbol = firstResidue_; iSymbol < nSymbols_; ++iSymbol) {
+		symbolRanks_[iSymbol].reserve(nWords);
+		uint32_t symbolRank{0};
+		for (const auto &eachWord : symbolBits_[iSymbol]) {
+			symbolRanks_[iSymbol].push_back(symbolRank);
+			symbolRank += static_cast<uint32_t>( __builtin_popcountll(eachWord) );
+		}
+	}
+	sampledRanks_.reserve(nWords);
+	uint32_t sampleRank{0};
+	for (const auto &eachWord : sampledRows_) {
+		sampledRanks_.push_back(sampleRank);
+		sampleRank += static_cast<uint32_t>( __builtin_popcountll(eachWord) );
+	}
+}
+
+template <typename SymbolType>
+void FMindex::suffixArrayIS_(const std::vector<SymbolType> &text, const size_t &alphabetSize, std::vector<uint32_t> &suffixArray) {
+	constexpr uint32_t empty{std::numeric_limits<uint32_t>::max()};
+	const size_t textLength = text.size();
+	suffixArray.assign(textLength, empty);
+	if (textLength == 0) {
+		return;
+	}
+	if (textLength == 1) {
+		suffixArray[0] = 0;
+		return;
+	}
+	// S-type suffixes are smaller than the next suffix, L-type larger; LMS suffixes are S-type with an L-type predecessor
+	std::vector<bool> sType(textLength, false);
+	sType[textLength - 1] = true;
+	for (size_t iPos = textLength - 1; iPos > 0; --iPos) {
+		sType[iPos - 1] = (text[iPos - 1] < text[iPos]) || ( (text[iPos - 1] == text[iPos]) && sType[iPos] );
+	}
+	auto isLMS = [&sType](size_t position){
+		return (position > 0) && sType[position] && !sType[position - 1];
+	};
+	std::vector<uint32_t> bucketStarts(alphabetSize + 1, 0);
+	for (const auto &eachSymbol : text) {
+		++bucketStarts[static_cast<size_t>(eachSymbol) + 1];
+	}
+	std::partial_sum( bucketStarts.begin(), bucketStarts.end(), bucketStarts.begin() );
+	std::vector<uint32_t> bucketPointers(alphabetSize);
+	// LMS suffixes go to the ends of their buckets in the given order, then L- and S-type suffixes are induced from them
+	auto induce = [&](const std::vector<uint32_t> &lmsSuffixes){
+		std::fill(suffixArray.begin(), suffixArray.end(), empty);
+		std::copy(bucketStarts.cbegin() + 1, bucketStarts.cend(), bucketPointers.begin());
+		for (auto lmsIt = lmsSuffixes.crbegin(); lmsIt != lmsSuffixes.crend(); ++lmsIt) {
+			suffixArray[--bucketPointers[text[*lmsIt]]] = *lmsIt;
+		}
+		std::copy(bucketStarts.cbegin(), bucketStarts.cend() - 1, bucketPointers.begin());
+		for (size_t iRow = 0; iRow < textLength; ++iRow) {
+			const uint32_t suffix = suffixArray[iRow];
+			if ( (suffix != empty) && (suffix > 0) && !sType[suffix - 1] ) {
+				suffixArray[bucketPointers[text[suffix - 1]]++] = suffix - 1;
+			}
+		}
+		std::copy(bucketStarts.cbegin() + 1, bucketStarts.cend(), bucketPointers.begin());
+		for (size_t iRow = textLength; iRow > 0; --iRow) {
+			const uint32_t suffix = suffixArray[iRow - 1];
+			if ( (suffix != empty) && (suffix > 0) && sType[suffix - 1] ) {
+				suffixArray[--bucketPointers[text[suffix - 1]]] = suffix - 1;
+			}
+		}
+	};
+	std::vector<uint32_t> lmsPositions;
+	for (size_t iPos = 1; iPos < textLength; ++iPos) {
+		if ( isLMS(iPos) ) {
+			lmsPositions.push_back( static_cast<uint32_t>(iPos) );
+		}
+	}
+	// induced sorting in text order sorts the LMS substrings, which are then named by rank
+	induce(lmsPositions);
+	std::vector<uint32_t> substringNames(textLength, empty);
+	uint32_t nameCount{0};
+	size_t previousLMS{textLength};
+	for (const auto &suffix : suffixArray) {
+		if ( !isLMS(suffix) ) {
+			continue;
+		}
+		bool sameSubstring = previousLMS < textLength;
+		for (size_t iOffset = 0; sameSubstring; ++iOffset) {
+			const size_t current  = suffix + iOffset;
+			const size_t previous = previousLMS + iOffset;
+			if ( (text[current] != text[previous]) || (sType[current] != sType[previous]) ) {
+				sameSubstring = false;
+			} else if ( (iOffset > 0) && isLMS(current) ) {
+				break;
+			}
+		}
+		if (!sameSubstring) {
+			++nameCount;
+		}
+		substringNames[suffix] = nameCount - 1;
+		previousLMS            = suffix;
+	}
+	// the LMS suffix order comes from the suffix array of the string of names, recursively if names repeat
+	std::vector<uint32_t> reducedText;
+	reducedText.reserve( lmsPositions.size() );
+	for (const auto &eachLMS : lmsPositions) {
+		reducedText.push_back(substringNames[eachLMS]);
+	}
+	substringNames.clear();
+	substringNames.shrink_to_fit();
+	std::vector<uint32_t> reducedArray;
+	if ( nameCount < lmsPositions.size() ) {
+		suffixArrayIS_(reducedText, nameCount, reducedArray);
+	} else {
+		reducedArray.resize( reducedText.size() );
+		for (size_t iLMS = 0; iLMS < reducedText.size(); ++iLMS) {
+			reducedArray[reducedText[iLMS]] = static_cast<uint32_t>(iLMS);
+		}
+	}
+	for (auto &eachSuffix : reducedArray) {
+		eachSuffix = lmsPositions[eachSuffix];
+	}
+	induce(reducedArray);
+}
+
+size_t FMindex::count(const std::string &motif) const {
+	const auto rowRange = this->backwardSearch_(motif);
+	return rowRange.second - rowRange.first;
+}
+
+std::vector<MotifHit> FMindex::locate(const std::string &motif) const {
+	const auto rowRange = this->backwardSearch_(motif);
+	std::vector<MotifHit> result;
+	result.reserve(rowRange.second - rowRange.first);
+	for (size_t iRow = rowRange.first; iRow < rowRange.second; ++iRow) {
+		const size_t textPosition = this->textPosition_(iRow);
+		const auto sequenceIt     = std::upper_bound(sequenceStarts_.cbegin(), sequenceStarts_.cend(), textPosition) - 1;
+		const auto sequenceIdx    = static_cast<size_t>( std::distance(sequenceStarts_.cbegin(), sequenceIt) );
+		const size_t position     = textPosition - *sequenceIt;
+		result.push_back( MotifHit{sequenceIdx, position, coordinates_[sequenceIdx].toAlignmentColumn(position)} );
+	}
+	std::sort(result.begin(), result.end(),
+		[](const MotifHit &hit1, const MotifHit &hit2){
+			return hit1.sequenceIdx != hit2.sequenceIdx ? hit1.sequenceIdx < hit2.sequenceIdx : hit1.sequencePosition < hit2.sequencePosition;
+		});
+	return result;
+}
+
+std::vector<uint32_t> FMindex::countPerSequence(const std::string &motif) const {
+	std::vector<uint32_t> result(sequenceStarts_.size(), 0);
+	for (const auto &eachHit : this->locate(motif)) {
+		++result[eachHit.sequenceIdx];
+	}
+	return result;
+}
+
+uint8_t FMindex::symbolCode_(const char &residue) noexcept {
+	switch (residue) {
+		case 'A': case 'a': return 2;
+		case 'C': case 'c': return 3;
+		case 'G': case 'g': return 4;
+		case 'T': case 't': return 5;
+		default:            return 6;
+	}
+}
+
+size_t FMindex::occurrences_(const uint8_t &symbol, const size_t &bwtPosition) const noexcept {
+	const size_t wordIdx   = bwtPosition / wordSize_;
+	const size_t bitOffset = bwtPosition % wordSize_;
+	size_t result          = symbolRanks_[symbol][wordIdx];
+	if (bitOffset > 0) {
+		result += static_cast<size_t>( __builtin_popcountll( symbolBits_[symbol][wordIdx] & ( (1ULL << bitOffset) - 1 ) ) );
+	}
+	return result;
+}
+
+std::pair<size_t, size_t> FMindex::backwardSearch_(const std::string &motif) const {
+	if ( motif.empty() ) {
+		throw std::string("ERROR: motif must not be empty in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	size_t firstRow{0};
+	size_t lastRow{textLength_};
+	for (auto motifIt = motif.crbegin(); motifIt != motif.crend(); ++motifIt) {
+		const uint8_t symbol = symbolCode_(*motifIt);
+		firstRow             = symbolStarts_[symbol] + this->occurrences_(symbol, firstRow);
+		lastRow              = symbolStarts_[symbol] + this->occurrences_(symbol, lastRow);
+		if (firstRow >= lastRow) {
+			return std::make_pair(firstRow, firstRow);
+		}
+	}
+	return std::make_pair(firstRow, lastRow);
+}
+
+size_t FMindex::textPosition_(size_t bwtRow) const {
+	size_t nSteps{0};
+	while ( ( sampledRows_[bwtRow / wordSize_] & ( 1ULL << (bwtRow % wordSize_) ) ) == 0 ) {
+		const uint8_t symbol = bwt_[bwtRow];
+		bwtRow               = symbolStarts_[symbol] + this->occurrences_(symbol, bwtRow);
+		++nSteps;
+	}
+	const size_t wordIdx   = bwtRow / wordSize_;
+	const size_t bitOffset = bwtRow % wordSize_;
+	size_t sampleIdx       = sampledRanks_[wordIdx];
+	if (bitOffset > 0) {
+		sampleIdx += static_cast<size_t>( __builtin_popcountll( sampledRows_[wordIdx] & ( (1ULL << bitOffset) - 1 ) ) );
+	}
+	return suffixSamples_[sampleIdx] + nSteps;
+}
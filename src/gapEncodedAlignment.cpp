@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Gap run-length encoded alignment
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Implementation of an alignment stored as gap runs and residues.
+ *
+ */
+
+#include <vector>
+#include <unordered_map>
+#include <string>
+#include <array>
+#include <algorithm>
+#include <utility> // for std::pair
+#include <cstdint>
+
+#include "gapEncodedAlignment.hpp"
+#include "fastaParser.hpp"
+
+using namespace BayesicSpace;
+
+std::vector<GapRun> BayesicSpace::findGapRuns(const std::string &alignedSequence) {
+	std::vector<GapRun> runs;
+	size_t gapTotal{0};
+	size_t gapStart = alignedSequence.find('-');
+	while (gapStart != std::string::npos) {
+		const size_t gapEnd = std::min( alignedSequence.find_first_not_of('-', gapStart), alignedSequence.size() );
+		runs.push_back( GapRun{gapStart, gapEnd, gapTotal} );
+		gapTotal += gapEnd - gapStart;
+		gapStart  = alignedSequence.find('-', gapEnd);
+	}
+	return runs;
+}
+
+GapEncodedAlignment::GapEncodedAlignment(const std::string &fastaFileName) {
+	readFASTA(fastaFileName, [this](const std::string &sequenceHeader, const std::string &alignedSequence){
+		this->addSequence_(sequenceHeader, alignedSequence);
+	});
+	if (headers_.size() < 2) {
+		throw std::string("ERROR: alignment file ") + fastaFileName + std::string(" must have at least two sequence records in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+}
+
+GapEncodedAlignment::GapEncodedAlignment(const ParseFASTA &alignment) {
+	for (size_t iSeq = 0; iSeq < alignment.sequenceNumber(); ++iSeq) {
+		this->addSequence_( alignment.header(iSeq), alignment.sequence(iSeq) );
+	}
+}
+
+size_t GapEncodedAlignment::storageBytes() const noexcept {
+	size_t result{0};
+	for (size_t iSeq = 0; iSeq < headers_.size(); ++iSeq) {
+		result += residues_[iSeq].size() + gapRuns_[iSeq].size() * sizeof(GapRun);
+	}
+	return result;
+}
+
+std::string GapEncodedAlignment::window(const size_t &sequenceIdx, const size_t &windowStartPosition, const size_t &windowSize) const {
+	if ( sequenceIdx >= headers_.size() ) {
+		throw std::string("ERROR: sequence index out of range in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if (windowStartPosition >= alignmentLength_) {
+		throw std::string("ERROR: window start is past alignment length in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const size_t windowEnd = std::min(alignmentLength_, windowStartPosition + windowSize);
+	const std::vector<GapRun> &runs = gapRuns_[sequenceIdx];
+	// first run that ends after the window start
+	auto runIt = std::upper_bound( runs.cbegin(), runs.cend(), windowStartPosition, [](size_t column, const GapRun &run){return column < run.end;} );
+	size_t gapsBefore = runIt == runs.cend() ? ( runs.empty() ? 0 : runs.back().gapsBefore + runs.back().end - runs.back().start ) : runIt->gapsBefore;
+	std::string result;
+	result.reserve(windowEnd - windowStartPosition);
+	size_t iCol = windowStartPosition;
+	while (iCol < windowEnd) {
+		if ( (runIt != runs.cend() ) && (runIt->start <= iCol) ) {
+			const size_t gapEnd = std::min(runIt->end, windowEnd);
+			result.append(gapEnd - iCol, '-');
+			gapsBefore = runIt->gapsBefore + runIt->end - runIt->start;
+			iCol       = gapEnd;
+			++runIt;
+			continue;
+		}
+		const size_t residueEnd = runIt == runs.cend() ? windowEnd : std::min(runIt->start, windowEnd);
+		result.append(residues_[sequenceIdx], iCol - gapsBefore, residueEnd - iCol);
+		iCol = residueEnd;
+	}
+	return result;
+}
+
+std::unordered_map<std::string, uint32_t> GapEncodedAlignment::extractWindow(const size_t &windowStartPosition, const size_t &windowSize) const {
+	std::unordered_map<std::string, uint32_t> result;
+	for (size_t iSeq = 0; iSeq < headers_.size(); ++iSeq) {
+		++result[this->window(iSeq, windowStartPosition, windowSize)];
+	}
+	return result;
+}
+
+std::vector< std::pair<std::string, uint32_t> > GapEncodedAlignment::extractWindowSorted(const size_t &windowStartPosition, const size_t &windowSize) const {
+	const auto windowCounts{this->extractWindow(windowStartPosition, windowSize)};
+	std::vector< std::pair<std::string, uint32_t> > result( windowCounts.cbegin(), windowCounts.cend() );
+	std::sort(result.begin(), result.end(), byCountThenSequence);
+	return result;
+}
+
+std::string GapEncodedAlignment::consensus() const {
+	if (alignmentLength_ == 0) {
+		return std::string{};
+	}
+	return this->consensusWindow(0, alignmentLength_);
+}
+
+std::string GapEncodedAlignment::consensusWindow(const size_t &windowStartPosition, const size_t &windowSize) const {
+	if (windowStartPosition >= alignmentLength_) {
+		throw std::string("ERROR: window start is past alignment length in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const std::string stateOrder("ACGTNacgtn");
+	constexpr size_t nChars{256};
+	std::array<size_t, nChars> stateIdx{};
+	stateIdx.fill( stateOrder.size() );
+	for (size_t iState = 0; iState < stateOrder.size(); ++iState) {
+		stateIdx[static_cast<unsigned char>(stateOrder[iState])] = iState;
+	}
+	const size_t windowEnd   = std::min(alignmentLength_, windowStartPosition + windowSize);
+	const size_t windowWidth = windowEnd - windowStartPosition;
+	// residue counts per column, then gap counts from a difference array over the runs
+	const size_t nStates = stateOrder.size() + 1;
+	std::vector<uint32_t> stateCounts(windowWidth * nStates, 0);
+	std::vector<int64_t> gapDifferences(windowWidth + 1, 0);
+	for (size_t iSeq = 0; iSeq < headers_.size(); ++iSeq) {
+		const std::vector<GapRun> &runs = gapRuns_[iSeq];
+		// first run that ends after the window start
+		auto runIt = std::upper_bound( runs.cbegin(), runs.cend(), windowStartPosition, [](size_t column, const GapRun &run){return column < run.end;} );
+		size_t gapsBefore = runIt == runs.cend() ? ( runs.empty() ? 0 : runs.back().gapsBefore + runs.back().end - runs.back().start ) : runIt->gapsBefore;
+		size_t iCol = windowStartPosition;
+		while (iCol < windowEnd) {
+			if ( (runIt != runs.cend() ) && (runIt->start <= iCol) ) {
+				const size_t gapEnd = std::min(runIt->end, windowEnd);
+				++gapDifferences[iCol - windowStartPosition];
+				--gapDifferences[gapEnd - windowStartPosition];
+				gapsBefore = runIt->gapsBefore + runIt->end - runIt->start;
+				iCol       = gapEnd;
+				++runIt;
+				continue;
+			}
+			const size_t residueEnd = runIt == runs.cend() ? windowEnd : std::min(runIt->start, windowEnd);
+			for (; iCol < residueEnd; ++iCol) {
+				++stateCounts[(iCol - windowStartPosition) * nStates + stateIdx[static_cast<unsigned char>(residues_[iSeq][iCol - gapsBefore])]];
+			}
+		}
+	}
+	std::string result(windowWidth, 'N');
+	int64_t gapCount{0};
+	for (size_t iCol = 0; iCol < windowWidth; ++iCol) {
+		gapCount += gapDifferences[iCol];
+		uint32_t maxCount{0};
+		for (size_t iState = 0; iState < stateOrder.size(); ++iState) {
+			if (stateCounts[iCol * nStates + iState] > maxCount) {
+				maxCount     = stateCounts[iCol * nStates + iState];
+				result[iCol] = stateOrder[iState];
+			}
+		}
+		if (static_cast<uint32_t>(gapCount) > maxCount) {
+			result[iCol] = '-';
+		}
+	}
+	return result;
+}
+
+void GapEncodedAlignment::addSequence_(const std::string &sequenceHeader, const std::string &alignedSequence) {
+	if ( headers_.empty() ) {
+		alignmentLength_ = alignedSequence.size();
+	} else if (alignedSequence.size() != alignmentLength_) {
+		throw std::string("ERROR: all sequences must be the same length in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	std::vector<GapRun> runs{findGapRuns(alignedSequence)};
+	std::string residues;
+	residues.reserve( alignedSequence.size() - ( runs.empty() ? 0 : runs.back().gapsBefore + runs.back().end - runs.back().start ) );
+	size_t iCol{0};
+	for (const auto &eachRun : runs) {
+		residues.append(alignedSequence, iCol, eachRun.start - iCol);
+		iCol = eachRun.end;
+	}
+	residues.append(alignedSequence, iCol, std::string::npos);
+	runs.shrink_to_fit();
+	residues.shrink_to_fit();
+	headers_.push_back(sequenceHeader);
+	gapRuns_.push_back( std::move(runs) );
+	residues_.push_back( std::move(residues) );
+}
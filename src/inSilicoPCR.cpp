@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// In-silico PCR
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Implementation of in-silico PCR with degenerate primers against every sequence in an alignment.
+ *
+ */
+
+#include <array>
+#include <vector>
+#include <utility> // for std::pair
+#include <string>
+#include <thread>
+#include <algorithm>
+
+#include "inSilicoPCR.hpp"
+#include "fastaParser.hpp"
+#include "coordinateIndex.hpp"
+
+using namespace BayesicSpace;
+
+InSilicoPCR::InSilicoPCR(const std::string &forwardPrimer, const std::string &reversePrimer, const uint32_t &maxMismatches, const size_t &maxAmpliconLength) :
+							forwardLength_{forwardPrimer.size()}, reverseLength_{reversePrimer.size()}, maxMismatches_{maxMismatches}, maxAmpliconLength_{maxAmpliconLength} {
+	constexpr size_t maxPrimerLength{64};
+	if ( forwardPrimer.empty() || reversePrimer.empty() ) {
+		throw std::string("ERROR: primers must not be empty in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if ( (forwardLength_ > maxPrimerLength) || (reverseLength_ > maxPrimerLength) ) {
+		throw std::string("ERROR: primers must not be longer than 64 nucleotides in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if ( (maxMismatches_ >= forwardLength_) || (maxMismatches_ >= reverseLength_) ) {
+		throw std::string("ERROR: the number of mismatches must be smaller than primer length in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if ( ( forwardPrimer.find('-') != std::string::npos ) || ( reversePrimer.find('-') != std::string::npos ) ) {
+		throw std::string("ERROR: primers must not contain gaps in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	// the complement of a nucleotide set reverses the order of its four bits (A <-> T, C <-> G)
+	auto complementMask = [](uint8_t nucMask){
+		return static_cast<uint8_t>( ( (nucMask & 1) << 3 ) | ( (nucMask & 2) << 1 ) | ( (nucMask & 4) >> 1 ) | ( (nucMask & 8) >> 3 ) );
+	};
+	for (size_t iChar = 0; iChar < nChars_; ++iChar) {
+		const uint8_t charMask = iupacMask( static_cast<char>(iChar) );
+		// only a definite template nucleotide can match; ambiguity codes, N, gaps, and unknown characters are mismatches
+		if (__builtin_popcount(charMask) != 1) {
+			continue;
+		}
+		for (size_t iPos = 0; iPos < forwardLength_; ++iPos) {
+			if ( (iupacMask(forwardPrimer[iPos]) & charMask) != 0 ) {
+				forwardMasks_[iChar] |= 1ULL << iPos;
+			}
+		}
+		// the reverse primer binds the forward strand as its reverse complement
+		for (size_t iPos = 0; iPos < reverseLength_; ++iPos) {
+			if ( (complementMask( iupacMask(reversePrimer[reverseLength_ - 1 - iPos]) ) & charMask) != 0 ) {
+				reverseMasks_[iChar] |= 1ULL << iPos;
+			}
+		}
+	}
+}
+
+std::vector<AmpliconResult> InSilicoPCR::amplify(const ParseFASTA &alignment, const size_t &nThreads) const {
+	std::vector<AmpliconResult> result( alignment.sequenceNumber() );
+	const size_t threadCount = std::max( size_t{1}, std::min( nThreads, alignment.sequenceNumber() ) );
+	std::vector<std::thread> pcrThreads;
+	pcrThreads.reserve(threadCount);
+	for (size_t iThread = 0; iThread < threadCount; ++iThread) {
+		pcrThreads.emplace_back(
+			[this, &alignment, &result, iThread, threadCount](){
+				for (size_t iSeq = iThread; iSeq < alignment.sequenceNumber(); iSeq += threadCount) {
+					result[iSeq]             = this->amplify( alignment.sequence(iSeq) );
+					result[iSeq].sequenceIdx = iSeq;
+				}
+			}
+		);
+	}
+	for (auto &eachThread : pcrThreads) {
+		eachThread.join();
+	}
+	return result;
+}
+
+AmpliconResult InSilicoPCR::amplify(const std::string &alignedSequence) const {
+	std::string ungapped;
+	ungapped.reserve( alignedSequence.size() );
+	std::copy_if( alignedSequence.cbegin(), alignedSequence.cend(), std::back_inserter(ungapped), [](char residue){return residue != '-';} );
+	const auto forwardSites = this->bindingSites_(ungapped, forwardMasks_, forwardLength_);
+	const auto reverseSites = this->bindingSites_(ungapped, reverseMasks_, reverseLength_);
+	AmpliconResult result;
+	uint32_t bestMismatches{2 * maxMismatches_ + 1};
+	for (const auto &eachForward : forwardSites) {
+		// the reverse primer must bind entirely downstream of the forward primer;
+		// reverse sites are in position order, so the product length only grows along the scan
+		auto reverseIt = std::lower_bound( reverseSites.cbegin(), reverseSites.cend(), std::make_pair(eachForward.first + forwardLength_, uint32_t{0}) );
+		for (; reverseIt != reverseSites.cend(); ++reverseIt) {
+			const size_t productLength = reverseIt->first + reverseLength_ - eachForward.first;
+			if (productLength > maxAmpliconLength_) {
+				break;
+			}
+			const uint32_t totalMismatches = eachForward.second + reverseIt->second;
+			if ( (totalMismatches < bestMismatches) || ( (totalMismatches == bestMismatches) && (productLength < result.ampliconLength) ) ) {
+				bestMismatches           = totalMismatches;
+				result.amplified         = true;
+				result.forwardPosition   = eachForward.first;
+				result.forwardMismatches = eachForward.second;
+				result.reversePosition   = reverseIt->first;
+				result.reverseMismatches = reverseIt->second;
+				result.ampliconLength    = productLength;
+			}
+		}
+	}
+	if (result.amplified) {
+		const CoordinateIndex coordinates(alignedSequence);
+		result.ampliconStartColumn = coordinates.toAlignmentColumn(result.forwardPosition);
+		result.ampliconEndColumn   = coordinates.toAlignmentColumn(result.forwardPosition + result.ampliconLength - 1);
+	}
+	return result;
+}
+
+std::vector< std::pair<size_t, uint32_t> > InSilicoPCR::bindingSites_(const std::string &sequence, const std::array<uint64_t, nChars_> &matchMasks, const size_t &primerLength) const {
+	// states[d] has bit i set if the first i + 1 primer positions match the sequence ending at the current residue with at most d mismatches
+	std::vector<uint64_t> states(maxMismatches_ + 1, 0);
+	const uint64_t acceptBit{1ULL << (primerLength - 1)};
+	std::vector< std::pair<size_t, uint32_t> > result;
+	for (size_t iPos = 0; iPos < sequence.size(); ++iPos) {
+		const uint64_t charMask = matchMasks[static_cast<unsigned char>(sequence[iPos]) % nChars_];
+		uint64_t previousState  = states[0];
+		states[0]               = ( (states[0] << 1) | 1 ) & charMask;
+		for (size_t iMismatch = 1; iMismatch <= maxMismatches_; ++iMismatch) {
+			const uint64_t oldState = states[iMismatch];
+			states[iMismatch]       = ( ( (oldState << 1) | 1 ) & charMask ) | ( (previousState << 1) | 1 );
+			previousState           = oldState;
+		}
+		for (uint32_t iMismatch = 0; iMismatch <= maxMismatches_; ++iMismatch) {
+			if ( (states[iMismatch] & acceptBit) != 0 ) {
+				result.emplace_back(iPos + 1 - primerLength, iMismatch);
+				break;
+			}
+		}
+	}
+	return result;
+}
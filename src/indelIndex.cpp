@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Indel event index
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Implementation of an index of distinct gap intervals (indel events) in an alignment.
+ *
+ */
+
+#include <vector>
+#include <utility> // for std::pair
+#include <algorithm>
+#include <string>
+#include <cstdint>
+
+#include "indelIndex.hpp"
+#include "gapEncodedAlignment.hpp"
+#include "fastaParser.hpp"
+
+using namespace BayesicSpace;
+
+IndelIndex::IndelIndex(const GapEncodedAlignment &alignment) : sequenceNumber_{alignment.sequenceNumber()} {
+	sequenceRuns_.reserve(sequenceNumber_);
+	for (size_t iSeq = 0; iSeq < alignment.sequenceNumber(); ++iSeq) {
+		this->addSequenceRuns_( alignment.gapRuns(iSeq), alignment.alignmentLength() );
+	}
+	this->indexEvents_();
+}
+
+IndelIndex::IndelIndex(const ParseFASTA &alignment) : sequenceNumber_{alignment.sequenceNumber()} {
+	sequenceRuns_.reserve(sequenceNumber_);
+	for (size_t iSeq = 0; iSeq < alignment.sequenceNumber(); ++iSeq) {
+		this->addSequenceRuns_( findGapRuns( alignment.sequence(iSeq) ), alignment.alignmentLength() );
+	}
+	this->indexEvents_();
+}
+
+std::pair<size_t, size_t> IndelIndex::eventRange(const size_t &windowStartPosition, const size_t &windowSize) const {
+	auto byStart = [](const IndelEvent &event, size_t column){return event.start < column;};
+	const auto firstIt = std::lower_bound(events_.cbegin(), events_.cend(), windowStartPosition, byStart);
+	const auto endIt   = std::lower_bound(firstIt, events_.cend(), windowStartPosition + windowSize, byStart);
+	return std::pair<size_t, size_t>{static_cast<size_t>( firstIt - events_.cbegin() ), static_cast<size_t>( endIt - events_.cbegin() )};
+}
+
+IndelWindowStatistics IndelIndex::windowStatistics(const size_t &windowStartPosition, const size_t &windowSize) const {
+	const auto range = this->eventRange(windowStartPosition, windowSize);
+	IndelWindowStatistics result{static_cast<uint32_t>(range.second - range.first), 0.0, 0.0};
+	if (result.indels > 0) {
+		const auto nEvents   = static_cast<double>(result.indels);
+		result.meanLength    = static_cast<double>(lengthPrefix_[range.second] - lengthPrefix_[range.first]) / nEvents;
+		result.meanFrequency = static_cast<double>(carrierPrefix_[range.second] - carrierPrefix_[range.first]) / ( nEvents * static_cast<double>(sequenceNumber_) );
+	}
+	return result;
+}
+
+IndelWindowStatistics IndelIndex::windowStatistics(const size_t &windowStartPosition, const size_t &windowSize, const ParseFASTA &alignment) const {
+	if (alignment.sequenceNumber() != sequenceNumber_) {
+		throw std::string("ERROR: the alignment must have the sequences the index was built from in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const size_t windowEnd = windowStartPosition + windowSize;
+	std::vector< std::pair<size_t, size_t> > intervals;
+	uint32_t nUsed{0};
+	for (size_t iSeq = 0; iSeq < sequenceNumber_; ++iSeq) {
+		if ( !alignment.usesSequence(iSeq, windowStartPosition, windowSize) ) {
+			continue;
+		}
+		++nUsed;
+		const auto &runs = sequenceRuns_[iSeq];
+		auto runIt       = std::lower_bound( runs.cbegin(), runs.cend(), std::pair<size_t, size_t>{windowStartPosition, 0} );
+		for (; ( runIt != runs.cend() ) && (runIt->first < windowEnd); ++runIt) {
+			if (alignment.unmaskedColumns(runIt->first, runIt->second - runIt->first) == runIt->second - runIt->first) {
+				intervals.push_back(*runIt);
+			}
+		}
+	}
+	std::sort( intervals.begin(), intervals.end() );
+	IndelWindowStatistics result{0, 0.0, 0.0};
+	size_t totalLength{0};
+	uint64_t totalCarriers{0};
+	size_t iInterval{0};
+	while ( iInterval < intervals.size() ) {
+		const size_t eventStart = iInterval;
+		while ( ( iInterval < intervals.size() ) && (intervals[iInterval] == intervals[eventStart]) ) {
+			++iInterval;
+		}
+		const auto carriers = static_cast<uint32_t>(iInterval - eventStart);
+		if (carriers == nUsed) {
+			continue;
+		}
+		++result.indels;
+		totalLength   += intervals[eventStart].second - intervals[eventStart].first;
+		totalCarriers += carriers;
+	}
+	if (result.indels > 0) {
+		const auto nEvents   = static_cast<double>(result.indels);
+		result.meanLength    = static_cast<double>(totalLength) / nEvents;
+		result.meanFrequency = static_cast<double>(totalCarriers) / ( nEvents * static_cast<double>(nUsed) );
+	}
+	return result;
+}
+
+void IndelIndex::addSequenceRuns_(const std::vector<GapRun> &gapRuns, const size_t &alignmentLength) {
+	std::vector< std::pair<size_t, size_t> > internalRuns;
+	for (const auto &eachRun : gapRuns) {
+		if ( (eachRun.start > 0) && (eachRun.end < alignmentLength) ) {
+			internalRuns.emplace_back(eachRun.start, eachRun.end);
+		}
+	}
+	internalRuns.shrink_to_fit();
+	sequenceRuns_.push_back( std::move(internalRuns) );
+}
+
+void IndelIndex::indexEvents_() {
+	std::vector< std::pair<size_t, size_t> > intervals;
+	for (const auto &eachSequence : sequenceRuns_) {
+		intervals.insert( intervals.end(), eachSequence.cbegin(), eachSequence.cend() );
+	}
+	std::sort( intervals.begin(), intervals.end() );
+	for (const auto &eachInterval : intervals) {
+		if ( events_.empty() || (events_.back().start != eachInterval.first) || (events_.back().end != eachInterval.second) ) {
+			events_.push_back( IndelEvent{eachInterval.first, eachInterval.second, 0} );
+		}
+		++events_.back().carriers;
+	}
+	// gaps shared by all sequences are not polymorphic
+	events_.erase( std::remove_if( events_.begin(), events_.end(),
+		[this](const IndelEvent &eachEvent){return eachEvent.carriers == sequenceNumber_;} ), events_.end() );
+	lengthPrefix_.reserve(events_.size() + 1);
+	carrierPrefix_.reserve(events_.size() + 1);
+	lengthPrefix_.push_back(0);
+	carrierPrefix_.push_back(0);
+	for (const auto &eachEvent : events_) {
+		lengthPrefix_.push_back(lengthPrefix_.back() + eachEvent.end - eachEvent.start);
+		carrierPrefix_.push_back(carrierPrefix_.back() + eachEvent.carriers);
+	}
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Performance metrics
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Implementation of run-time performance metrics (counters, gauges, and latency histograms) exported in the Prometheus text format.
+ *
+ */
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+
+#include <sys/resource.h>
+
+#include "metrics.hpp"
+
+using namespace BayesicSpace;
+
+LatencyHistogram::LatencyHistogram() : count_{0}, sum_{0} {
+	for (auto &eachBucket : buckets_) {
+		eachBucket.store(0, std::memory_order_relaxed);
+	}
+}
+
+void LatencyHistogram::record(const uint64_t &nanoseconds) noexcept {
+	buckets_[bucketIndex_(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+	count_.fetch_add(1, std::memory_order_relaxed);
+	sum_.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::quantile(const double &probability) const {
+	if ( (probability < 0.0) || (probability > 1.0) ) {
+		throw std::string("ERROR: quantile probability must be between 0 and 1 in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const uint64_t total = this->count();
+	if (total == 0) {
+		return 0;
+	}
+	const auto target = std::max( uint64_t{1}, static_cast<uint64_t>( probability * static_cast<double>(total) + 0.5 ) );
+	uint64_t cumulative{0};
+	for (size_t iBucket = 0; iBucket < bucketCount_; ++iBucket) {
+		cumulative += buckets_[iBucket].load(std::memory_order_relaxed);
+		if (cumulative >= target) {
+			return bucketUpperBound_(iBucket);
+		}
+	}
+	return bucketUpperBound_(bucketCount_ - 1);
+}
+
+std::string LatencyHistogram::prometheusText(const std::string &metricName) const {
+	constexpr double nsPerSecond{1e9};
+	std::stringstream outText;
+	outText << "# TYPE " << metricName << " histogram\n";
+	uint64_t cumulative{0};
+	for (size_t iBucket = 0; iBucket < bucketCount_; ++iBucket) {
+		const uint64_t bucketCount = buckets_[iBucket].load(std::memory_order_relaxed);
+		if (bucketCount == 0) {
+			continue;
+		}
+		cumulative += bucketCount;
+		outText << metricName << "_bucket{le=\"" << static_cast<double>( bucketUpperBound_(iBucket) ) / nsPerSecond << "\"} " << cumulative << "\n";
+	}
+	outText << metricName << "_bucket{le=\"+Inf\"} " << this->count() << "\n";
+	outText << metricName << "_sum "   << static_cast<double>( this->sum() ) / nsPerSecond << "\n";
+	outText << metricName << "_count " << this->count() << "\n";
+	return outText.str();
+}
+
+size_t LatencyHistogram::bucketIndex_(const uint64_t &value) noexcept {
+	if (value < subBucketCount_) {
+		return value;
+	}
+	const auto mostSignificantBit = static_cast<uint64_t>( 63 - __builtin_clzll(value) );
+	const uint64_t shift          = mostSignificantBit - subBucketBits_;
+	const uint64_t subBucket      = (value >> shift) & (subBucketCount_ - 1);
+	return (shift + 1) * subBucketCount_ + subBucket;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound_(const size_t &bucketIdx) noexcept {
+	const uint64_t group     = bucketIdx / subBucketCount_;
+	const uint64_t subBucket = bucketIdx % subBucketCount_;
+	if (group == 0) {
+		return subBucket;
+	}
+	const uint64_t shift = group - 1;
+	return ( (subBucketCount_ + subBucket) << shift ) + ( (1ULL << shift) - 1 );
+}
+
+std::atomic<uint64_t>& MetricsRegistry::counter(const std::string &name) {
+	std::lock_guard<std::mutex> lock(registryMutex_);
+	auto &slot = counters_[name];
+	if (!slot) {
+		slot.reset( new std::atomic<uint64_t>{0} );
+	}
+	return *slot;
+}
+
+std::atomic<int64_t>& MetricsRegistry::gauge(const std::string &name) {
+	std::lock_guard<std::mutex> lock(registryMutex_);
+	auto &slot = gauges_[name];
+	if (!slot) {
+		slot.reset( new std::atomic<int64_t>{0} );
+	}
+	return *slot;
+}
+
+LatencyHistogram& MetricsRegistry::histogram(const std::string &name) {
+	std::lock_guard<std::mutex> lock(registryMutex_);
+	auto &slot = histograms_[name];
+	if (!slot) {
+		slot.reset( new LatencyHistogram );
+	}
+	return *slot;
+}
+
+std::string MetricsRegistry::prometheusText() const {
+	constexpr int64_t bytesPerKb{1024};
+	std::lock_guard<std::mutex> lock(registryMutex_);
+	// sort names so that consecutive dumps are easy to diff
+	std::stringstream outText;
+	std::vector<std::string> names;
+	names.reserve( counters_.size() );
+	for (const auto &eachCounter : counters_) {
+		names.push_back(eachCounter.first);
+	}
+	std::sort( names.begin(), names.end() );
+	for (const auto &eachName : names) {
+		outText << "# TYPE " << eachName << " counter\n";
+		outText << eachName << " " << counters_.at(eachName)->load(std::memory_order_relaxed) << "\n";
+	}
+	names.clear();
+	for (const auto &eachGauge : gauges_) {
+		names.push_back(eachGauge.first);
+	}
+	std::sort( names.begin(), names.end() );
+	for (const auto &eachName : names) {
+		outText << "# TYPE " << eachName << " gauge\n";
+		outText << eachName << " " << gauges_.at(eachName)->load(std::memory_order_relaxed) << "\n";
+	}
+	names.clear();
+	for (const auto &eachHistogram : histograms_) {
+		names.push_back(eachHistogram.first);
+	}
+	std::sort( names.begin(), names.end() );
+	for (const auto &eachName : names) {
+		outText << histograms_.at(eachName)->prometheusText(eachName);
+	}
+	struct rusage resourceUse{};
+	if (getrusage(RUSAGE_SELF, &resourceUse) == 0) {
+		outText << "# TYPE process_max_resident_memory_bytes gauge\n";
+		outText << "process_max_resident_memory_bytes " << resourceUse.ru_maxrss * bytesPerKb << "\n";
+	}
+	return outText.str();
+}
+
+void MetricsRegistry::dumpToFile(const std::string &fileName) const {
+	const std::string tmpFileName = fileName + ".tmp";
+	std::fstream outFile;
+	outFile.open(tmpFileName, std::ios::out | std::ios::trunc);
+	if ( !outFile.is_open() ) {
+		throw std::string("ERROR: cannot open metrics file ") + tmpFileName + std::string(" for writing in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	outFile << this->prometheusText();
+	outFile.close();
+	if (std::rename( tmpFileName.c_str(), fileName.c_str() ) != 0) {
+		throw std::string("ERROR: cannot rename ") + tmpFileName + std::string(" to ") + fileName + std::string(" in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+}
+
+ScopedTimer::~ScopedTimer() {
+	const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_);
+	histogram_.record( static_cast<uint64_t>( elapsed.count() ) );
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Persistent query alignment cache
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Implementation of an on-disk cache of query alignment results.
+ *
+ */
+
+#include <unordered_map>
+#include <string>
+#include <sstream>
+#include <fstream>
+
+#include "queryCache.hpp"
+#include "fastaParser.hpp"
+
+using namespace BayesicSpace;
+
+QueryCache::QueryCache(const std::string &cacheFileName) : cacheFileName_{cacheFileName} {
+	std::fstream cacheFile;
+	cacheFile.open(cacheFileName_, std::ios::in);
+	if ( !cacheFile.is_open() ) {
+		return;
+	}
+	std::string cacheLine;
+	while ( std::getline(cacheFile, cacheLine) ) {
+		std::stringstream lineStream(cacheLine);
+		uint64_t key{0};
+		AlignmentStatistics alignStats{};
+		lineStream >> std::hex >> key >> std::dec >> alignStats.referenceStart >> alignStats.referenceLength >> alignStats.queryStart >> alignStats.queryLength;
+		if ( lineStream.fail() ) {
+			continue;
+		}
+		cache_[key] = alignStats;
+	}
+	cacheFile.close();
+}
+
+bool QueryCache::find(const uint64_t &key, AlignmentStatistics &alignStats) {
+	const auto cacheIt = cache_.find(key);
+	if ( cacheIt == cache_.end() ) {
+		++misses_;
+		return false;
+	}
+	++hits_;
+	alignStats = cacheIt->second;
+	return true;
+}
+
+void QueryCache::insert(const uint64_t &key, const AlignmentStatistics &alignStats) {
+	cache_[key] = alignStats;
+	if ( cacheFileName_.empty() ) {
+		return;
+	}
+	std::fstream cacheFile;
+	cacheFile.open(cacheFileName_, std::ios::out | std::ios::app);
+	if ( !cacheFile.is_open() ) {
+		throw std::string("ERROR: cannot open query cache file ") + cacheFileName_ + std::string(" for writing in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	cacheFile << std::hex << key << std::dec << "\t" << alignStats.referenceStart << "\t" << alignStats.referenceLength << "\t" <<
+		alignStats.queryStart << "\t" << alignStats.queryLength << "\n";
+	cacheFile.close();
+}
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Sample metadata table
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023
+ * \version 0.1
+ *
+ * Implementation of a columnar table of sample metadata parsed from FASTA headers.
+ *
+ */
+
+#include <vector>
+#include <unordered_map>
+#include <string>
+#include <array>
+#include <cstdlib>
+#include <cctype>
+
+#include "sampleTable.hpp"
+#include "fastaParser.hpp"
+
+using namespace BayesicSpace;
+
+namespace {
+	constexpr size_t wordSize{64};
+
+	/** \brief Remove surrounding white space
+	 *
+	 * \param[in] text string to trim
+	 * \return trimmed string
+	 */
+	std::string trimSpace(const std::string &text) {
+		const std::string spaces(" \t\r\n");
+		const size_t first = text.find_first_not_of(spaces);
+		if (first == std::string::npos) {
+			return std::string{};
+		}
+		return text.substr( first, text.find_last_not_of(spaces) - first + 1 );
+	}
+	/** \brief Convert to a number
+	 *
+	 * \param[in] text string to convert
+	 * \param[out] number converted value
+	 * \return `true` if the whole string is a number
+	 */
+	bool toNumber(const std::string &text, double &number) {
+		if ( text.empty() ) {
+			return false;
+		}
+		char *parseEnd{nullptr};
+		number = std::strtod(text.c_str(), &parseEnd);
+		return *parseEnd == '\0';
+	}
+}
+
+SampleTable::SampleTable(const std::vector<std::string> &headers) : sampleNumber_{headers.size()} {
+	std::vector< std::unordered_map<std::string, uint32_t> > valueCodes;
+	for (size_t iSample = 0; iSample < headers.size(); ++iSample) {
+		const std::string &header = headers[iSample];
+		size_t fieldPosition{0};
+		size_t fieldStart{0};
+		while (fieldStart <= header.size()) {
+			size_t fieldEnd = header.find_first_of("| \t", fieldStart);
+			if (fieldEnd == std::string::npos) {
+				fieldEnd = header.size();
+			}
+			const std::string field{header.substr(fieldStart, fieldEnd - fieldStart)};
+			fieldStart = fieldEnd + 1;
+			if ( field.empty() ) {
+				continue;
+			}
+			++fieldPosition;
+			const size_t equalPosition = field.find('=');
+			std::string columnName;
+			std::string fieldValue;
+			if ( (equalPosition == std::string::npos) || (equalPosition == 0) ) {
+				columnName = "field" + std::to_string(fieldPosition);
+				fieldValue = field;
+			} else {
+				columnName = field.substr(0, equalPosition);
+				fieldValue = field.substr(equalPosition + 1);
+			}
+			auto columnIt = columnIndex_.find(columnName);
+			if ( columnIt == columnIndex_.end() ) {
+				columnIt = columnIndex_.emplace( columnName, columnNames_.size() ).first;
+				columnNames_.push_back(columnName);
+				dictionaries_.emplace_back();
+				codes_.emplace_back(sampleNumber_, 0);
+				valueCodes.emplace_back();
+			}
+			const size_t columnIdx = columnIt->second;
+			auto codeIt = valueCodes[columnIdx].find(fieldValue);
+			if ( codeIt == valueCodes[columnIdx].end() ) {
+				dictionaries_[columnIdx].push_back(fieldValue);
+				codeIt = valueCodes[columnIdx].emplace( fieldValue, static_cast<uint32_t>( dictionaries_[columnIdx].size() ) ).first;
+			}
+			codes_[columnIdx][iSample] = codeIt->second;
+		}
+	}
+}
+
+SampleTable::SampleTable(const ParseFASTA &alignment) {
+	std::vector<std::string> headers;
+	headers.reserve( alignment.sequenceNumber() );
+	for (size_t iSeq = 0; iSeq < alignment.sequenceNumber(); ++iSeq) {
+		headers.push_back( alignment.header(iSeq) );
+	}
+	*this = SampleTable(headers);
+}
+
+std::string SampleTable::value(const size_t &sampleIdx, const std::string &columnName) const {
+	if (sampleIdx >= sampleNumber_) {
+		throw std::string("ERROR: sample index out of range in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const auto columnIt = columnIndex_.find(columnName);
+	if ( columnIt == columnIndex_.end() ) {
+		throw std::string("ERROR: no metadata column ") + columnName + std::string(" in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const uint32_t code = codes_[columnIt->second][sampleIdx];
+	return code == 0 ? std::string{} : dictionaries_[columnIt->second][code - 1];
+}
+
+std::vector<uint64_t> SampleTable::select(const std::string &predicate) const {
+	const size_t nWords = (sampleNumber_ + wordSize - 1) / wordSize;
+	std::vector<uint64_t> result(nWords, 0);
+	size_t disjunctStart{0};
+	while (disjunctStart <= predicate.size()) {
+		size_t disjunctEnd = predicate.find('|', disjunctStart);
+		if (disjunctEnd == std::string::npos) {
+			disjunctEnd = predicate.size();
+		}
+		const std::string disjunct{predicate.substr(disjunctStart, disjunctEnd - disjunctStart)};
+		disjunctStart = disjunctEnd + 1;
+		std::vector<uint64_t> conjunction(nWords, ~0ULL);
+		size_t termStart{0};
+		while (termStart <= disjunct.size()) {
+			size_t termEnd = disjunct.find('&', termStart);
+			if (termEnd == std::string::npos) {
+				termEnd = disjunct.size();
+			}
+			const std::vector<uint64_t> termBits{this->selectComparison_( disjunct.substr(termStart, termEnd - termStart) )};
+			termStart = termEnd + 1;
+			for (size_t iWord = 0; iWord < nWords; ++iWord) {
+				conjunction[iWord] &= termBits[iWord];
+			}
+		}
+		for (size_t iWord = 0; iWord < nWords; ++iWord) {
+			result[iWord] |= conjunction[iWord];
+		}
+	}
+	return result;
+}
+
+std::vector<uint64_t> SampleTable::selectComparison_(const std::string &comparison) const {
+	// two-character operators are listed first so that they are not mistaken for their first character
+	const std::array<std::string, 6> operators{"!=", "<=", ">=", "=", "<", ">"};
+	const size_t operatorPosition = comparison.find_first_of("!=<>");
+	std::string comparisonOperator;
+	for (const auto &eachOperator : operators) {
+		if ( (operatorPosition != std::string::npos) && (comparison.compare(operatorPosition, eachOperator.size(), eachOperator) == 0) ) {
+			comparisonOperator = eachOperator;
+			break;
+		}
+	}
+	const std::string columnName{trimSpace( comparison.substr(0, operatorPosition) )};
+	if ( comparisonOperator.empty() || columnName.empty() ) {
+		throw std::string("ERROR: cannot parse the comparison '") + comparison + std::string("' in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const std::string target{trimSpace( comparison.substr( operatorPosition + comparisonOperator.size() ) )};
+	const auto columnIt = columnIndex_.find(columnName);
+	if ( columnIt == columnIndex_.end() ) {
+		throw std::string("ERROR: no metadata column ") + columnName + std::string(" in ") +
+			std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const std::vector<std::string> &dictionary = dictionaries_[columnIt->second];
+	double targetNumber{0.0};
+	const bool numericTarget = toNumber(target, targetNumber);
+	// the comparison is evaluated once per distinct value; code 0 (missing field) never matches
+	std::vector<bool> codeMatches(dictionary.size() + 1, false);
+	for (size_t iValue = 0; iValue < dictionary.size(); ++iValue) {
+		int order{0};
+		double valueNumber{0.0};
+		if ( numericTarget && toNumber(dictionary[iValue], valueNumber) ) {
+			order = valueNumber < targetNumber ? -1 : (valueNumber > targetNumber ? 1 : 0);
+		} else {
+			order = dictionary[iValue].compare(target);
+		}
+		if (comparisonOperator == "=") {
+			codeMatches[iValue + 1] = order == 0;
+		} else if (comparisonOperator == "!=") {
+			codeMatches[iValue + 1] = order != 0;
+		} else if (comparisonOperator == "<") {
+			codeMatches[iValue + 1] = order < 0;
+		} else if (comparisonOperator == "<=") {
+			codeMatches[iValue + 1] = order <= 0;
+		} else if (comparisonOperator == ">") {
+			codeMatches[iValue + 1] = order > 0;
+		} else {
+			codeMatches[iValue + 1] = order >= 0;
+		}
+	}
+	std::vector<uint64_t> result( (sampleNumber_ + wordSize - 1) / wordSize, 0 );
+	const std::vector<uint32_t> &columnCodes = codes_[columnIt->second];
+	for (size_t iSample = 0; iSample < sampleNumber_; ++iSample) {
+		if (codeMatches[columnCodes[iSample]]) {
+			result[iSample / wordSize] |= 1ULL << (iSample % wordSize);
+		}
+	}
+	return result;
+}
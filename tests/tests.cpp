@@ -33,9 +33,24 @@
 #include <algorithm>
 #include <unordered_map>
 #include <fstream>
+#include <cstdio>
+#include <cctype>
+#include <cmath>
+#include <iterator>
 
 #include "catch2/catch_test_macros.hpp"
 #include "fastaParser.hpp"
+#include "metrics.hpp"
+#include "queryCache.hpp"
+#include "coordinateIndex.hpp"
+#include "fmIndex.hpp"
+#include "inSilicoPCR.hpp"
+#include "featureIndex.hpp"
+#include "extraFunctions.hpp"
+#include "blockStore.hpp"
+#include "gapEncodedAlignment.hpp"
+#include "indelIndex.hpp"
+#include "sampleTable.hpp"
 
 TEST_CASE("A FASTA file is properly parsed", "[parser]") { // NOLINT
 	const std::string testFASTAfile("../tests/testK.fasta");
@@ -172,3 +187,1646 @@ TEST_CASE("A FASTA file is properly parsed", "[parser]") { // NOLINT
 	}
 }
 
+TEST_CASE("Performance metrics are recorded", "[metrics]") { // NOLINT
+	BayesicSpace::MetricsRegistry metrics;
+	SECTION("Latency histogram") {
+		BayesicSpace::LatencyHistogram &testHistogram = metrics.histogram("test_latency_seconds");
+		constexpr uint64_t nValues{1000};
+		for (uint64_t iValue = 1; iValue <= nValues; ++iValue) {
+			testHistogram.record(iValue);
+		}
+		REQUIRE(testHistogram.count() == nValues);
+		REQUIRE( testHistogram.sum() == nValues * (nValues + 1) / 2 );
+		// buckets have 1/8 relative precision
+		constexpr uint64_t trueMedian{500};
+		const uint64_t median = testHistogram.quantile(0.5);
+		REQUIRE(median >= trueMedian);
+		REQUIRE(median <= trueMedian + trueMedian / 8);
+		REQUIRE(testHistogram.quantile(1.0) >= nValues);
+		REQUIRE_THROWS( testHistogram.quantile(2.0) );
+		// the same name returns the same histogram
+		REQUIRE(metrics.histogram("test_latency_seconds").count() == nValues);
+	}
+	SECTION("Prometheus text") {
+		metrics.counter("test_windows_total") += 3;
+		metrics.gauge("test_queue_depth")      = -2;
+		metrics.histogram("test_save_seconds").record(1);
+		const std::string promText = metrics.prometheusText();
+		REQUIRE(promText.find("# TYPE test_windows_total counter\ntest_windows_total 3\n") != std::string::npos);
+		REQUIRE(promText.find("test_queue_depth -2\n") != std::string::npos);
+		REQUIRE(promText.find("test_save_seconds_bucket{le=\"+Inf\"} 1\n") != std::string::npos);
+		REQUIRE(promText.find("test_save_seconds_count 1\n") != std::string::npos);
+	}
+}
+
+TEST_CASE("Query results are cached on disk", "[queryCache]") { // NOLINT
+	const std::string testFASTAfile("../tests/testK.fasta");
+	const std::string cacheFile("../tests/queryCache.tmp");
+	std::remove( cacheFile.c_str() );
+	BayesicSpace::ParseFASTA testParser(testFASTAfile);
+	std::fstream fastaQueryFile;
+	std::string fastaQueryLine;
+	fastaQueryFile.open(std::string("../tests/querySequence.fasta"), std::ios::in);
+	std::getline(fastaQueryFile, fastaQueryLine);
+	std::string querySequence;
+	while ( std::getline(fastaQueryFile, fastaQueryLine) ) {
+		querySequence += fastaQueryLine;
+	}
+	fastaQueryFile.close();
+	const auto directWindow = testParser.extractSequence(querySequence);
+	{
+		BayesicSpace::QueryCache firstRun(cacheFile);
+		const auto firstWindow = testParser.extractSequence(querySequence, firstRun);
+		REQUIRE(firstRun.misses() == 1);
+		REQUIRE(firstRun.hits()   == 0);
+		REQUIRE(firstWindow.referenceStart  == directWindow.referenceStart);
+		REQUIRE(firstWindow.referenceLength == directWindow.referenceLength);
+	}
+	// a new cache object re-reads the file, as after a restart
+	BayesicSpace::QueryCache secondRun(cacheFile);
+	REQUIRE(secondRun.size() == 1);
+	const auto cachedWindow = testParser.extractSequence(querySequence, secondRun);
+	REQUIRE(secondRun.hits()   == 1);
+	REQUIRE(secondRun.misses() == 0);
+	REQUIRE(cachedWindow.referenceStart  == directWindow.referenceStart);
+	REQUIRE(cachedWindow.referenceLength == directWindow.referenceLength);
+	REQUIRE(cachedWindow.queryStart      == directWindow.queryStart);
+	REQUIRE(cachedWindow.queryLength     == directWindow.queryLength);
+	// a different query misses
+	testParser.extractSequence(querySequence.substr(0, querySequence.size() / 2), secondRun);
+	REQUIRE(secondRun.misses() == 1);
+	// masking changes the consensus the query is aligned to, so a cached unmasked result is not reused
+	testParser.maskColumns( std::vector< std::pair<size_t, size_t> >{ {0, 200} } );
+	const auto maskedWindow = testParser.extractSequence(querySequence, secondRun);
+	REQUIRE(secondRun.misses() == 2);
+	REQUIRE(maskedWindow.referenceStart == testParser.extractSequence(querySequence).referenceStart);
+	std::remove( cacheFile.c_str() );
+}
+
+TEST_CASE("Protein queries are found by six-frame translated search", "[proteinQuery]") { // NOLINT
+	const std::string testFASTAfile("../tests/testK.fasta");
+	BayesicSpace::ParseFASTA testParser(testFASTAfile);
+	std::fstream fastaQueryFile;
+	std::string fastaQueryLine;
+	fastaQueryFile.open(std::string("../tests/querySequence.fasta"), std::ios::in);
+	std::getline(fastaQueryFile, fastaQueryLine);
+	std::string querySequence;
+	while ( std::getline(fastaQueryFile, fastaQueryLine) ) {
+		querySequence += fastaQueryLine;
+	}
+	fastaQueryFile.close();
+	// translate the nucleotide query on either strand with the standard genetic code
+	const std::string geneticCode("FFLLSSSSYY**CC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG");
+	const std::string tcag("TCAG");
+	auto translate = [&geneticCode, &tcag](const std::string &nucleotides){
+		std::string protein;
+		for (size_t iCodon = 0; iCodon + 3 <= nucleotides.size(); iCodon += 3) {
+			const size_t codonIdx = 16 * tcag.find(nucleotides[iCodon]) + 4 * tcag.find(nucleotides[iCodon + 1]) + tcag.find(nucleotides[iCodon + 2]);
+			protein.push_back(geneticCode[codonIdx]);
+		}
+		return protein;
+	};
+	std::string reverseQuery;
+	std::transform(querySequence.crbegin(), querySequence.crend(), std::back_inserter(reverseQuery),
+		[](char nuc){ return nuc == 'A' ? 'T' : (nuc == 'C' ? 'G' : (nuc == 'G' ? 'C' : 'A') ); });
+	const auto nucleotideWindow = testParser.extractSequence(querySequence);
+	const auto forwardWindow    = testParser.extractProteinSequence( translate(querySequence) );
+	const auto reverseWindow    = testParser.extractProteinSequence( translate(reverseQuery) );
+	constexpr size_t codonLength{3};
+	REQUIRE(forwardWindow.referenceStart == nucleotideWindow.referenceStart);
+	REQUIRE(forwardWindow.referenceLength + codonLength >= nucleotideWindow.referenceLength);
+	REQUIRE(forwardWindow.queryStart == 0);
+	REQUIRE(forwardWindow.queryLength + 1 == querySequence.size() / codonLength);
+	// the reverse-strand hit covers the same columns, within a codon at each end
+	REQUIRE(reverseWindow.referenceStart + codonLength >= nucleotideWindow.referenceStart);
+	REQUIRE(reverseWindow.referenceStart <= nucleotideWindow.referenceStart + codonLength);
+	REQUIRE(reverseWindow.referenceStart + reverseWindow.referenceLength + codonLength >= nucleotideWindow.referenceStart + nucleotideWindow.referenceLength);
+}
+
+TEST_CASE("Long queries are found by minimizer chaining", "[longQuery]") { // NOLINT
+	const std::string testFASTAfile("../tests/testK.fasta");
+	BayesicSpace::ParseFASTA testParser(testFASTAfile);
+	std::fstream fastaQueryFile;
+	std::string fastaQueryLine;
+	fastaQueryFile.open(std::string("../tests/querySequence.fasta"), std::ios::in);
+	std::getline(fastaQueryFile, fastaQueryLine);
+	std::string querySequence;
+	while ( std::getline(fastaQueryFile, fastaQueryLine) ) {
+		querySequence += fastaQueryLine;
+	}
+	fastaQueryFile.close();
+	const auto swWindow    = testParser.extractSequence(querySequence);
+	const auto chainWindow = testParser.extractLongSequence(querySequence);
+	REQUIRE(chainWindow.referenceStart  == swWindow.referenceStart);
+	REQUIRE(chainWindow.referenceLength == swWindow.referenceLength);
+	REQUIRE(chainWindow.queryStart      == swWindow.queryStart);
+	REQUIRE(chainWindow.queryLength     == swWindow.queryLength);
+	// a multi-kb stretch of the consensus, with gaps removed, maps back onto its own columns
+	constexpr size_t longStart{2000};
+	constexpr size_t longSize{6000};
+	std::string longQuery{testParser.extractConsensusWindow(longStart, longSize)};
+	const auto firstResidue = longQuery.find_first_not_of('-');
+	const auto lastResidue  = longQuery.find_last_not_of('-');
+	longQuery.erase(std::remove(longQuery.begin(), longQuery.end(), '-'), longQuery.end());
+	const auto longWindow = testParser.extractLongSequence(longQuery);
+	REQUIRE(longWindow.referenceStart  == longStart + firstResidue);
+	REQUIRE(longWindow.referenceLength == lastResidue - firstResidue);
+	REQUIRE(longWindow.queryStart      == 0);
+	REQUIRE(longWindow.queryLength + 1 == longQuery.size() );
+}
+
+TEST_CASE("Exact motifs are located with an FM-index", "[fmIndex]") { // NOLINT
+	const std::string testFASTAfile("../tests/testK.fasta");
+	BayesicSpace::ParseFASTA testParser(testFASTAfile);
+	const BayesicSpace::FMindex testIndex(testParser);
+	SECTION("Coordinate index") {
+		const std::string alignedSequence("--AC-GT---A");
+		const BayesicSpace::CoordinateIndex coordinates(alignedSequence);
+		REQUIRE(coordinates.sequenceLength()  == 5);
+		REQUIRE(coordinates.alignmentLength() == alignedSequence.size());
+		REQUIRE(coordinates.toAlignmentColumn(0) == 2);
+		REQUIRE(coordinates.toAlignmentColumn(2) == 5);
+		REQUIRE(coordinates.toAlignmentColumn(4) == 10);
+		REQUIRE(coordinates.toSequencePosition(0)  == 0);
+		REQUIRE(coordinates.toSequencePosition(4)  == 2);
+		REQUIRE(coordinates.toSequencePosition(11) == 5);
+		REQUIRE( coordinates.isGap(4) );
+		REQUIRE_FALSE( coordinates.isGap(5) );
+		REQUIRE_THROWS( coordinates.toAlignmentColumn(5) );
+		// every residue of a real sequence round-trips
+		const BayesicSpace::CoordinateIndex testCoordinates( testParser.sequence(0) );
+		bool roundTrip{true};
+		for (size_t iPos = 0; iPos < testCoordinates.sequenceLength(); ++iPos) {
+			roundTrip = roundTrip && (testCoordinates.toSequencePosition( testCoordinates.toAlignmentColumn(iPos) ) == iPos);
+		}
+		REQUIRE(roundTrip);
+		// residues spread over long gaps are located through the sparse samples
+		std::string gappedSequence;
+		std::vector<size_t> residueColumns;
+		for (size_t iResidue = 0; iResidue < 1000; ++iResidue) {
+			gappedSequence.append( iResidue < 300 ? 1 : 40 + iResidue % 7, '-' );
+			residueColumns.push_back( gappedSequence.size() );
+			gappedSequence.push_back('A');
+		}
+		const BayesicSpace::CoordinateIndex gappedCoordinates(gappedSequence);
+		bool sameColumns{true};
+		for (size_t iPos = 0; iPos < residueColumns.size(); ++iPos) {
+			sameColumns = sameColumns && (gappedCoordinates.toAlignmentColumn(iPos) == residueColumns[iPos]);
+		}
+		REQUIRE(sameColumns);
+	}
+	SECTION("Motif search") {
+		const std::string motif("GAATTC");
+		// brute-force search of the gap-stripped sequences
+		std::vector<BayesicSpace::MotifHit> trueHits;
+		for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); ++iSeq) {
+			std::string ungapped;
+			std::vector<size_t> columns;
+			for (size_t iCol = 0; iCol < testParser.alignmentLength(); ++iCol) {
+				if (testParser.sequence(iSeq)[iCol] != '-') {
+					ungapped.push_back( static_cast<char>( std::toupper( static_cast<unsigned char>(testParser.sequence(iSeq)[iCol]) ) ) );
+					columns.push_back(iCol);
+				}
+			}
+			for (size_t iPos = ungapped.find(motif); iPos != std::string::npos; iPos = ungapped.find(motif, iPos + 1)) {
+				trueHits.push_back( BayesicSpace::MotifHit{iSeq, iPos, columns[iPos]} );
+			}
+		}
+		REQUIRE( !trueHits.empty() );
+		REQUIRE( testIndex.count(motif) == trueHits.size() );
+		const auto hits = testIndex.locate(motif);
+		REQUIRE( hits.size() == trueHits.size() );
+		bool sameHits{true};
+		for (size_t iHit = 0; iHit < hits.size(); ++iHit) {
+			sameHits = sameHits && (hits[iHit].sequenceIdx == trueHits[iHit].sequenceIdx) &&
+				(hits[iHit].sequencePosition == trueHits[iHit].sequencePosition) && (hits[iHit].alignmentColumn == trueHits[iHit].alignmentColumn);
+		}
+		REQUIRE(sameHits);
+		const auto perSequence = testIndex.countPerSequence(motif);
+		REQUIRE(perSequence.size() == testParser.sequenceNumber());
+		REQUIRE(std::accumulate(perSequence.begin(), perSequence.end(), size_t{0}) == trueHits.size());
+		REQUIRE(testIndex.count("ACGTACGTACGTACGTACGTACGT") == 0);
+		REQUIRE_THROWS( testIndex.count("") );
+	}
+	SECTION("Shared long motifs") {
+		// substrings of one sequence recur in the near-identical others, which exercises the suffix order of long repeats
+		std::vector<std::string> ungappedSequences;
+		for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); ++iSeq) {
+			std::string ungapped;
+			for (const auto &eachChar : testParser.sequence(iSeq)) {
+				if (eachChar != '-') {
+					ungapped.push_back( static_cast<char>( std::toupper( static_cast<unsigned char>(eachChar) ) ) );
+				}
+			}
+			ungappedSequences.push_back( std::move(ungapped) );
+		}
+		bool sameCounts{true};
+		for (size_t motifStart = 0; motifStart + 200 < ungappedSequences[0].size(); motifStart += 97) {
+			const std::string motif{ungappedSequences[0].substr(motifStart, 5 + motifStart % 150)};
+			size_t trueCount{0};
+			for (const auto &eachSequence : ungappedSequences) {
+				for (size_t iPos = eachSequence.find(motif); iPos != std::string::npos; iPos = eachSequence.find(motif, iPos + 1)) {
+					++trueCount;
+				}
+			}
+			sameCounts = sameCounts && (testIndex.count(motif) == trueCount) && (testIndex.locate(motif).size() == trueCount);
+		}
+		REQUIRE(sameCounts);
+	}
+}
+
+TEST_CASE("Amplicons are found by in-silico PCR", "[inSilicoPCR]") { // NOLINT
+	// ungapped template GG ACGTTGCA TTTTTTTTTT GGATCCAA CC
+	const std::string alignedTemplate("G-GACGT--TGCATTTTTTTTTTGGA-TCCAACC");
+	SECTION("Single sequence") {
+		const BayesicSpace::InSilicoPCR exactPCR("ACGTTGCA", "TTGGATCC", 0, 100);
+		const auto exactResult = exactPCR.amplify(alignedTemplate);
+		REQUIRE(exactResult.amplified);
+		REQUIRE(exactResult.forwardPosition     == 2);
+		REQUIRE(exactResult.forwardMismatches   == 0);
+		REQUIRE(exactResult.reversePosition     == 20);
+		REQUIRE(exactResult.reverseMismatches   == 0);
+		REQUIRE(exactResult.ampliconLength      == 26);
+		REQUIRE(exactResult.ampliconStartColumn == 3);
+		REQUIRE(exactResult.ampliconEndColumn   == 31);
+		// degenerate codes match any residue in their set
+		const BayesicSpace::InSilicoPCR degeneratePCR("ACNTTGCR", "TYGGATCC", 0, 100);
+		const auto degenerateResult = degeneratePCR.amplify(alignedTemplate);
+		REQUIRE(degenerateResult.amplified);
+		REQUIRE(degenerateResult.ampliconLength == 26);
+		// a mismatch is tolerated only within the limit
+		const BayesicSpace::InSilicoPCR strictPCR("ACGTTGCC", "TTGGATCC", 0, 100);
+		REQUIRE_FALSE( strictPCR.amplify(alignedTemplate).amplified );
+		const BayesicSpace::InSilicoPCR tolerantPCR("ACGTTGCC", "TTGGATCC", 1, 100);
+		const auto tolerantResult = tolerantPCR.amplify(alignedTemplate);
+		REQUIRE(tolerantResult.amplified);
+		REQUIRE(tolerantResult.forwardMismatches == 1);
+		REQUIRE(tolerantResult.reverseMismatches == 0);
+		// products longer than the limit are not reported
+		const BayesicSpace::InSilicoPCR shortPCR("ACGTTGCA", "TTGGATCC", 0, 25);
+		REQUIRE_FALSE( shortPCR.amplify(alignedTemplate).amplified );
+		// primers in the wrong orientation do not amplify
+		const BayesicSpace::InSilicoPCR swappedPCR("TTGGATCC", "ACGTTGCA", 0, 100);
+		REQUIRE_FALSE( swappedPCR.amplify(alignedTemplate).amplified );
+		// missing or ambiguous template residues are mismatches, and binding sites may not overlap
+		REQUIRE_FALSE( exactPCR.amplify( std::string(60, 'N') ).amplified );
+		const BayesicSpace::InSilicoPCR tolerantExactPCR("ACGTTGCA", "TTGGATCC", 2, 100);
+		REQUIRE_FALSE( tolerantExactPCR.amplify( std::string(60, 'N') ).amplified );
+		REQUIRE_FALSE( tolerantExactPCR.amplify("NNACGTNNNACYTTGCANNNNNN").amplified );
+		const auto maskedResult = tolerantExactPCR.amplify("GGACGTTGCANNNNNNNNGGATCCAANNNN");
+		REQUIRE(maskedResult.amplified);
+		REQUIRE(maskedResult.forwardMismatches == 0);
+		REQUIRE(maskedResult.reverseMismatches == 0);
+		REQUIRE(maskedResult.reversePosition >= maskedResult.forwardPosition + 8);
+		REQUIRE_THROWS( BayesicSpace::InSilicoPCR("", "TTGGATCC", 0, 100) );
+		REQUIRE_THROWS( BayesicSpace::InSilicoPCR(std::string(65, 'A'), "TTGGATCC", 0, 100) );
+		REQUIRE_THROWS( BayesicSpace::InSilicoPCR("ACGT-GCA", "TTGGATCC", 0, 100) );
+		REQUIRE_THROWS( BayesicSpace::InSilicoPCR("ACGTTGCA", "TTGGATCC", 8, 100) );
+	}
+	SECTION("Alignment") {
+		const std::string testFASTAfile("../tests/testK.fasta");
+		BayesicSpace::ParseFASTA testParser(testFASTAfile);
+		std::string ungapped;
+		for (const auto &eachChar : testParser.sequence(0)) {
+			if (eachChar != '-') {
+				ungapped.push_back( static_cast<char>( std::toupper( static_cast<unsigned char>(eachChar) ) ) );
+			}
+		}
+		REQUIRE(ungapped.size() > 300);
+		const std::string forwardPrimer = ungapped.substr(100, 20);
+		std::string reversePrimer;
+		const std::string reverseSite = ungapped.substr(260, 20);
+		const std::unordered_map<char, char> complement{ {'A', 'T'}, {'C', 'G'}, {'G', 'C'}, {'T', 'A'} };
+		for (auto charIt = reverseSite.crbegin(); charIt != reverseSite.crend(); ++charIt) {
+			reversePrimer.push_back( complement.count(*charIt) > 0 ? complement.at(*charIt) : 'N' );
+		}
+		const BayesicSpace::InSilicoPCR testPCR(forwardPrimer, reversePrimer, 2, 1000);
+		const auto singleThread = testPCR.amplify(testParser, 1);
+		const auto multiThread  = testPCR.amplify(testParser, 3);
+		REQUIRE(singleThread.size() == testParser.sequenceNumber());
+		REQUIRE(multiThread.size()  == testParser.sequenceNumber());
+		REQUIRE(singleThread[0].amplified);
+		REQUIRE(singleThread[0].ampliconLength <= 180);
+		bool sameResults{true};
+		for (size_t iSeq = 0; iSeq < singleThread.size(); ++iSeq) {
+			sameResults = sameResults && (singleThread[iSeq].sequenceIdx == iSeq) && (multiThread[iSeq].sequenceIdx == iSeq) &&
+				(singleThread[iSeq].amplified == multiThread[iSeq].amplified) && (singleThread[iSeq].ampliconStartColumn == multiThread[iSeq].ampliconStartColumn) &&
+				(singleThread[iSeq].ampliconEndColumn == multiThread[iSeq].ampliconEndColumn);
+		}
+		REQUIRE(sameResults);
+	}
+}
+
+TEST_CASE("Conserved regions are found in one pass", "[conservedRegions]") { // NOLINT
+	const std::string testFASTAfile("../tests/testK.fasta");
+	BayesicSpace::ParseFASTA testParser(testFASTAfile);
+	constexpr size_t windowSize{20};
+	constexpr uint32_t maxVariable{2};
+	constexpr double minGC{0.3};
+	constexpr double maxGC{0.7};
+	// brute-force variable columns
+	const std::string nucleotides("ACGT-");
+	std::vector<uint32_t> variableColumns;
+	for (size_t iCol = 0; iCol < testParser.alignmentLength(); ++iCol) {
+		std::string states;
+		for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); ++iSeq) {
+			const auto residue = static_cast<char>( std::toupper( static_cast<unsigned char>(testParser.sequence(iSeq)[iCol]) ) );
+			if ( (nucleotides.find(residue) != std::string::npos) && (states.find(residue) == std::string::npos) ) {
+				states.push_back(residue);
+			}
+		}
+		variableColumns.push_back(states.size() > 1 ? 1 : 0);
+	}
+	bool sameVariable{true};
+	for (size_t iCol = 0; iCol < testParser.alignmentLength(); ++iCol) {
+		sameVariable = sameVariable && (testParser.isVariable(iCol) == (variableColumns[iCol] == 1));
+	}
+	REQUIRE(sameVariable);
+	REQUIRE( std::accumulate(variableColumns.begin(), variableColumns.end(), uint32_t{0}) > 0 );
+	REQUIRE_THROWS( testParser.isVariable( testParser.alignmentLength() ) );
+	// brute-force qualifying windows
+	std::vector< std::pair<size_t, uint32_t> > qualifying;
+	for (size_t iStart = 0; iStart + windowSize <= testParser.alignmentLength(); ++iStart) {
+		const uint32_t nVariable = std::accumulate(variableColumns.begin() + static_cast<std::vector<uint32_t>::difference_type>(iStart),
+			variableColumns.begin() + static_cast<std::vector<uint32_t>::difference_type>(iStart + windowSize), uint32_t{0});
+		const std::string consensus = testParser.extractConsensusWindow(iStart, windowSize);
+		const auto nGC  = std::count_if(consensus.begin(), consensus.end(), [](char residue){return (residue == 'G') || (residue == 'C') || (residue == 'g') || (residue == 'c');});
+		const auto nNuc = std::count_if(consensus.begin(), consensus.end(), [](char residue){return std::string("ACGTacgt").find(residue) != std::string::npos;});
+		const double gcContent = nNuc > 0 ? static_cast<double>(nGC) / static_cast<double>(nNuc) : 0.0;
+		if ( (nVariable <= maxVariable) && (gcContent >= minGC) && (gcContent <= maxGC) ) {
+			qualifying.emplace_back(iStart, nVariable);
+		}
+	}
+	const auto regions = testParser.conservedRegions(windowSize, maxVariable, minGC, maxGC);
+	REQUIRE( !qualifying.empty() );
+	REQUIRE( !regions.empty() );
+	REQUIRE( regions.size() < qualifying.size() );
+	bool ranked{true};
+	bool disjoint{true};
+	for (size_t iRegion = 1; iRegion < regions.size(); ++iRegion) {
+		ranked = ranked && (regions[iRegion - 1].variableSites <= regions[iRegion].variableSites);
+		for (size_t jRegion = 0; jRegion < iRegion; ++jRegion) {
+			disjoint = disjoint && ( (regions[iRegion].start >= regions[jRegion].start + windowSize) || (regions[jRegion].start >= regions[iRegion].start + windowSize) );
+		}
+	}
+	REQUIRE(ranked);
+	REQUIRE(disjoint);
+	// every qualifying window is reported or overlaps a reported window that is at least as conserved
+	bool covered{true};
+	for (const auto &eachWindow : qualifying) {
+		covered = covered && std::any_of(regions.cbegin(), regions.cend(), [&eachWindow](const BayesicSpace::ConservedRegion &region){
+			return (region.start < eachWindow.first + windowSize) && (eachWindow.first < region.start + windowSize) && (region.variableSites <= eachWindow.second);
+		});
+	}
+	REQUIRE(covered);
+	REQUIRE(regions.front().variableSites == 0);
+	REQUIRE(regions.front().length == windowSize);
+	REQUIRE_THROWS( testParser.conservedRegions(0, maxVariable, minGC, maxGC) );
+	REQUIRE_THROWS( testParser.conservedRegions(windowSize, maxVariable, maxGC, minGC) );
+}
+
+TEST_CASE("Unaligned sequences are placed into an alignment", "[placement]") { // NOLINT
+	const std::string testFASTAfile("../tests/placement.tmp");
+	const std::string alignedSequence("ATGGCGTACCTGA--CGTTAGCATCGGATCCTTAGGCA");
+	std::fstream testFile;
+	testFile.open(testFASTAfile, std::ios::out);
+	testFile << ">s1\n" << alignedSequence << "\n";
+	testFile << ">s2\n" << alignedSequence << "\n";
+	testFile << ">s3\nATGGCGTTCCTGAGGCGTTAGCATCGGATCCTTAGGCA\n";
+	testFile.close();
+	BayesicSpace::ParseFASTA testParser(testFASTAfile);
+	std::remove( testFASTAfile.c_str() );
+	std::string ungapped;
+	std::copy_if( alignedSequence.cbegin(), alignedSequence.cend(), std::back_inserter(ungapped), [](char residue){return residue != '-';} );
+	std::vector< std::pair<std::string, std::string> > newSequences;
+	newSequences.emplace_back("exact", ungapped);
+	newSequences.emplace_back( "insertion", ungapped.substr(0, 20) + "TTT" + ungapped.substr(20) );
+	newSequences.emplace_back( "deletion", ungapped.substr(0, 18) + ungapped.substr(20) );
+	const auto placements = testParser.placeSequences(newSequences, 2);
+	REQUIRE(placements.size() == newSequences.size());
+	REQUIRE(testParser.sequenceNumber() == 6);
+	REQUIRE(testParser.alignmentLength() == alignedSequence.size());
+	REQUIRE(testParser.header(3) == "exact");
+	REQUIRE(testParser.sequence(3) == alignedSequence);
+	REQUIRE(placements[0].placedResidues    == ungapped.size());
+	REQUIRE(placements[0].droppedInsertions == 0);
+	REQUIRE(placements[0].clippedResidues   == 0);
+	REQUIRE(testParser.sequence(4) == alignedSequence);
+	REQUIRE(placements[1].droppedInsertions == 3);
+	REQUIRE(placements[1].placedResidues    == ungapped.size());
+	std::string deletionAligned(alignedSequence);
+	deletionAligned[20] = '-';
+	deletionAligned[21] = '-';
+	REQUIRE(testParser.sequence(5) == deletionAligned);
+	REQUIRE(placements[2].placedResidues == ungapped.size() - 2);
+	// the consensus is updated with the new sequences
+	REQUIRE(testParser.extractConsensusWindow(0, alignedSequence.size()) == alignedSequence);
+	REQUIRE( testParser.isVariable(7) );
+	REQUIRE_FALSE( testParser.isVariable(0) );
+	newSequences.emplace_back("empty", "---");
+	REQUIRE_THROWS( testParser.placeSequences(newSequences, 1) );
+}
+
+TEST_CASE("Coordinates are lifted over to a reference sample", "[liftover]") { // NOLINT
+	const std::string testFASTAfile("../tests/testK.fasta");
+	BayesicSpace::ParseFASTA testParser(testFASTAfile);
+	const std::string sampleHeader = testParser.header(2);
+	REQUIRE(testParser.sequenceIndex(sampleHeader) == 2);
+	REQUIRE_THROWS( testParser.sequenceIndex("no_such_sample") );
+	REQUIRE_THROWS( testParser.coordinateIndex("no_such_sample") );
+	const BayesicSpace::CoordinateIndex sampleCoordinates{testParser.coordinateIndex(sampleHeader)};
+	const std::string &sampleSequence = testParser.sequence(2);
+	REQUIRE( sampleCoordinates.alignmentLength() == testParser.alignmentLength() );
+	REQUIRE( sampleCoordinates.sequenceLength() == static_cast<size_t>( std::count_if(sampleSequence.cbegin(), sampleSequence.cend(), [](char residue){return residue != '-';}) ) );
+	size_t residueCount{0};
+	bool sameCoordinates{true};
+	for (size_t iCol = 0; iCol < testParser.alignmentLength(); ++iCol) {
+		sameCoordinates = sameCoordinates && (sampleCoordinates.toSequencePosition(iCol) == residueCount);
+		if (sampleSequence[iCol] != '-') {
+			sameCoordinates = sameCoordinates && (sampleCoordinates.toAlignmentColumn(residueCount) == iCol);
+			++residueCount;
+		}
+	}
+	REQUIRE(sameCoordinates);
+}
+
+TEST_CASE("Masked columns are skipped", "[mask]") { // NOLINT
+	const std::string testFASTAfile("../tests/testK.fasta");
+	BayesicSpace::ParseFASTA testParser(testFASTAfile);
+	const BayesicSpace::ParseFASTA unmaskedParser(testParser);
+	const std::vector< std::pair<size_t, size_t> > maskedIntervals{ {60, 70}, {100, 200}, {250, 251}, {1000, 1128} };
+	REQUIRE_THROWS( testParser.maskColumns({ {10, 10} }) );
+	REQUIRE_THROWS( testParser.maskColumns({ {10, testParser.alignmentLength() + 1} }) );
+	testParser.maskColumns(maskedIntervals);
+	std::vector<bool> masked(testParser.alignmentLength(), false);
+	for (const auto &eachInterval : maskedIntervals) {
+		for (size_t iCol = eachInterval.first; iCol < eachInterval.second; ++iCol) {
+			masked[iCol] = true;
+		}
+	}
+	auto skipMasked = [&masked](const std::string &sequence, size_t start, size_t length){
+		std::string window;
+		for (size_t iCol = start; (iCol < start + length) && ( iCol < sequence.size() ); ++iCol) {
+			if (!masked[iCol]) {
+				window.push_back(sequence[iCol]);
+			}
+		}
+		return window;
+	};
+	SECTION("Window extraction") {
+		constexpr size_t windowStart{50};
+		constexpr size_t windowSize{1100};
+		const auto windowSequences = testParser.extractWindow(windowStart, windowSize);
+		std::unordered_map<std::string, uint32_t> trueSequences;
+		for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); ++iSeq) {
+			++trueSequences[skipMasked(testParser.sequence(iSeq), windowStart, windowSize)];
+		}
+		REQUIRE(windowSequences == trueSequences);
+		const std::string consensusWindow = testParser.extractConsensusWindow(windowStart, windowSize);
+		REQUIRE( consensusWindow == skipMasked(unmaskedParser.extractConsensusWindow( 0, testParser.alignmentLength() ), windowStart, windowSize) );
+		REQUIRE( testParser.unmaskedColumns(windowStart, windowSize) == consensusWindow.size() );
+		REQUIRE( testParser.unmaskedColumns(0, testParser.alignmentLength() + 10) == testParser.alignmentLength() - 239 );
+		REQUIRE(testParser.unmaskedColumns(100, 100) == 0);
+		REQUIRE(testParser.extractConsensusWindow(100, 1).empty());
+	}
+	SECTION("Consensus and variable sites") {
+		REQUIRE(testParser.extractConsensusWindow(0, 100) == unmaskedParser.extractConsensusWindow(0, 100).substr(0, 60) + unmaskedParser.extractConsensusWindow(70, 30));
+		bool maskedInvariant{true};
+		for (size_t iCol = 0; iCol < testParser.alignmentLength(); ++iCol) {
+			maskedInvariant = maskedInvariant && (masked[iCol] ? !testParser.isVariable(iCol) : testParser.isVariable(iCol) == unmaskedParser.isVariable(iCol));
+		}
+		REQUIRE(maskedInvariant);
+	}
+	SECTION("Diversity scan") {
+		constexpr size_t windowSize{100};
+		constexpr size_t stepSize{30};
+		const auto diversity = testParser.diversityInWindows(windowSize, stepSize);
+		REQUIRE( diversity.size() == unmaskedParser.diversityInWindows(windowSize, stepSize).size() );
+		bool sameCounts{true};
+		for (const auto &eachWindow : diversity) {
+			std::unordered_map<std::string, uint32_t> trueSequences;
+			for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); ++iSeq) {
+				++trueSequences[skipMasked(testParser.sequence(iSeq), eachWindow.first, windowSize)];
+			}
+			sameCounts = sameCounts && ( eachWindow.second.size() == trueSequences.size() );
+		}
+		REQUIRE(sameCounts);
+	}
+}
+
+TEST_CASE("Feature statistics use an interval index", "[featureIndex]") { // NOLINT
+	const std::string testFASTAfile("../tests/testK.fasta");
+	BayesicSpace::ParseFASTA testParser(testFASTAfile);
+	const std::vector<BayesicSpace::GenomicFeature> features{
+		{"geneA", "gene", 500, 1500}, {"exonA1", "exon", 500, 700}, {"exonA2", "exon", 1200, 1500},
+		{"geneB", "gene", 3000, 3300}, {"repeat", "region", 100, 4000}, {"short", "region", 2000, 2001}
+	};
+	REQUIRE_THROWS( BayesicSpace::FeatureIndex({ {"empty", "gene", 10, 10} }) );
+	BayesicSpace::FeatureIndex featureIndex(features);
+	REQUIRE(featureIndex.size() == features.size());
+	SECTION("Overlap queries") {
+		const std::vector< std::pair<size_t, size_t> > queries{ {0, 100}, {0, 101}, {650, 1250}, {1500, 3000}, {3299, 5000}, {2000, 2001}, {4000, 5000} };
+		bool sameOverlaps{true};
+		for (const auto &eachQuery : queries) {
+			std::vector<std::string> trueNames;
+			for (size_t iFeature = 0; iFeature < featureIndex.size(); ++iFeature) {
+				if ( (featureIndex.feature(iFeature).start < eachQuery.second) && (featureIndex.feature(iFeature).end > eachQuery.first) ) {
+					trueNames.push_back(featureIndex.feature(iFeature).name);
+				}
+			}
+			std::vector<std::string> names;
+			for (const auto &featureIdx : featureIndex.overlapping(eachQuery.first, eachQuery.second) ) {
+				names.push_back(featureIndex.feature(featureIdx).name);
+			}
+			sameOverlaps = sameOverlaps && (names == trueNames);
+		}
+		REQUIRE(sameOverlaps);
+		REQUIRE( featureIndex.overlapping(0, 100).empty() );
+		REQUIRE(featureIndex.overlapping(650, 1250).size() == 4);
+	}
+	SECTION("Overlap queries with a long feature") {
+		std::vector<BayesicSpace::GenomicFeature> manyFeatures{ {"chromosome", "region", 0, 100000} };
+		for (size_t iFeature = 0; iFeature < 2000; ++iFeature) {
+			manyFeatures.push_back( {"exon" + std::to_string(iFeature), "exon", iFeature * 50, iFeature * 50 + 10 + iFeature % 97} );
+		}
+		const BayesicSpace::FeatureIndex manyIndex(manyFeatures);
+		bool sameOverlaps{true};
+		for (size_t queryStart = 0; queryStart < 101000; queryStart += 997) {
+			const size_t queryEnd = queryStart + 1 + queryStart % 300;
+			std::vector<size_t> trueIndexes;
+			for (size_t iFeature = 0; iFeature < manyIndex.size(); ++iFeature) {
+				if ( (manyIndex.feature(iFeature).start < queryEnd) && (manyIndex.feature(iFeature).end > queryStart) ) {
+					trueIndexes.push_back(iFeature);
+				}
+			}
+			sameOverlaps = sameOverlaps && (manyIndex.overlapping(queryStart, queryEnd) == trueIndexes);
+		}
+		REQUIRE(sameOverlaps);
+		REQUIRE(manyIndex.overlapping(99999, 100000).size() == 2);
+		REQUIRE( manyIndex.overlapping(100019, 100050).empty() );
+	}
+	SECTION("Statistics") {
+		const auto singleThread = featureIndex.statistics(testParser, 1);
+		const auto multiThread  = featureIndex.statistics(testParser, 4);
+		REQUIRE(singleThread.size() == featureIndex.size());
+		bool sameStats{true};
+		for (size_t iFeature = 0; iFeature < singleThread.size(); ++iFeature) {
+			const auto &feature = featureIndex.feature(iFeature);
+			const size_t length = feature.end - feature.start;
+			// brute-force pairwise differences among A, C, G, T residues
+			double piSum{0.0};
+			uint32_t nVariable{0};
+			for (size_t iCol = feature.start; iCol < feature.end; ++iCol) {
+				double nDiff{0.0};
+				double nPairs{0.0};
+				for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); ++iSeq) {
+					const auto residue1 = static_cast<char>( std::toupper( static_cast<unsigned char>(testParser.sequence(iSeq)[iCol]) ) );
+					if (std::string("ACGT").find(residue1) == std::string::npos) {
+						continue;
+					}
+					for (size_t jSeq = iSeq + 1; jSeq < testParser.sequenceNumber(); ++jSeq) {
+						const auto residue2 = static_cast<char>( std::toupper( static_cast<unsigned char>(testParser.sequence(jSeq)[iCol]) ) );
+						if (std::string("ACGT").find(residue2) == std::string::npos) {
+							continue;
+						}
+						nPairs += 1.0;
+						nDiff  += residue1 == residue2 ? 0.0 : 1.0;
+					}
+				}
+				piSum     += nPairs > 0.0 ? nDiff / nPairs : 0.0;
+				nVariable += testParser.isVariable(iCol) ? 1 : 0;
+			}
+			const double truePi = piSum / static_cast<double>(length);
+			sameStats = sameStats && (singleThread[iFeature].featureIdx == iFeature) && (singleThread[iFeature].unmaskedColumns == length) &&
+				(singleThread[iFeature].variableSites == nVariable) &&
+				( singleThread[iFeature].haplotypes == testParser.extractWindow(feature.start, length).size() ) &&
+				(std::fabs(singleThread[iFeature].nucleotideDiversity - truePi) < 1e-9) &&
+				(multiThread[iFeature].haplotypes == singleThread[iFeature].haplotypes) &&
+				(multiThread[iFeature].nucleotideDiversity == singleThread[iFeature].nucleotideDiversity);
+		}
+		REQUIRE(sameStats);
+		REQUIRE(singleThread[0].nucleotideDiversity > 0.0);
+	}
+	SECTION("Statistics of overlapping features") {
+		const auto allStats    = featureIndex.statistics(testParser, 2);
+		const auto regionIdxs  = featureIndex.overlapping(650, 1250);
+		const auto regionStats = featureIndex.statistics(testParser, 3, regionIdxs);
+		REQUIRE(regionStats.size() == regionIdxs.size());
+		bool sameStats{true};
+		for (size_t iResult = 0; iResult < regionStats.size(); ++iResult) {
+			const auto &fullStats = allStats[regionIdxs[iResult]];
+			sameStats = sameStats && (regionStats[iResult].featureIdx == regionIdxs[iResult]) && (regionStats[iResult].haplotypes == fullStats.haplotypes) &&
+				(regionStats[iResult].variableSites == fullStats.variableSites) && (regionStats[iResult].nucleotideDiversity == fullStats.nucleotideDiversity);
+		}
+		REQUIRE(sameStats);
+		REQUIRE_THROWS( featureIndex.statistics( testParser, 1, {featureIndex.size()} ) );
+		REQUIRE( BayesicSpace::parseRegion("650-1250") == std::pair<size_t, size_t>{649, 1250} );
+		REQUIRE_THROWS( BayesicSpace::parseRegion("1250-650") );
+		REQUIRE_THROWS( BayesicSpace::parseRegion("0-10") );
+		REQUIRE_THROWS( BayesicSpace::parseRegion("650:1250") );
+	}
+	SECTION("Liftover") {
+		const BayesicSpace::CoordinateIndex sampleCoordinates{testParser.coordinateIndex( testParser.header(0) )};
+		featureIndex.liftOver(sampleCoordinates);
+		bool lifted{true};
+		for (size_t iFeature = 0; iFeature < featureIndex.size(); ++iFeature) {
+			const auto &feature  = featureIndex.feature(iFeature);
+			const auto sourceIt  = std::find_if(features.cbegin(), features.cend(), [&feature](const BayesicSpace::GenomicFeature &source){return source.name == feature.name;});
+			lifted = lifted && (testParser.sequence(0)[feature.start] != '-') && (testParser.sequence(0)[feature.end - 1] != '-') &&
+				(sampleCoordinates.toSequencePosition(feature.start) == sourceIt->start) && (sampleCoordinates.toSequencePosition(feature.end) == sourceIt->end);
+		}
+		REQUIRE(lifted);
+		BayesicSpace::FeatureIndex tooLong({ {"tooLong", "gene", 10, sampleCoordinates.sequenceLength() + 1} });
+		REQUIRE_THROWS( tooLong.liftOver(sampleCoordinates) );
+	}
+	SECTION("Statistics after imputation") {
+		const std::string imputeFile("../tests/impute.tmp");
+		std::fstream testFile;
+		testFile.open(imputeFile, std::ios::out);
+		testFile << ">s1\nACGT\n>s2\nACGT\n>s3\nGCGT\n>s4\nNCGT\n";
+		testFile.close();
+		BayesicSpace::ParseFASTA imputeParser(imputeFile);
+		std::remove( imputeFile.c_str() );
+		const BayesicSpace::FeatureIndex firstColumn({ {"first", "region", 0, 1} });
+		REQUIRE(std::fabs(imputeParser.nucleotideDiversity(0, 1) - 2.0 / 3.0) < 1e-9);
+		imputeParser.imputeMissing();
+		REQUIRE(imputeParser.sequence(3) == "ACGT");
+		REQUIRE(std::fabs(imputeParser.nucleotideDiversity(0, 1) - 0.5) < 1e-9);
+		REQUIRE(std::fabs(firstColumn.statistics(imputeParser, 1)[0].nucleotideDiversity - 0.5) < 1e-9);
+		REQUIRE(imputeParser.variableSiteNumber(0, 4) == 1);
+	}
+}
+
+TEST_CASE("Windows are extracted in parallel", "[parallelWindow]") { // NOLINT
+	const std::string testFASTAfile("../tests/testK.fasta");
+	BayesicSpace::ParseFASTA testParser(testFASTAfile);
+	auto checkWindows = [&testParser](size_t windowStart, size_t windowSize){
+		const auto serialWindows = testParser.extractWindow(windowStart, windowSize);
+		bool sameWindows{true};
+		for (const size_t nThreads : {size_t{1}, size_t{2}, size_t{3}, size_t{7}, size_t{100}}) {
+			sameWindows = sameWindows && (testParser.extractWindow(windowStart, windowSize, nThreads) == serialWindows);
+			const auto sortedWindows = testParser.extractWindowSorted(windowStart, windowSize, nThreads);
+			sameWindows = sameWindows && ( sortedWindows.size() == serialWindows.size() );
+			for (size_t iWindow = 0; iWindow < sortedWindows.size(); ++iWindow) {
+				sameWindows = sameWindows && (serialWindows.at(sortedWindows[iWindow].first) == sortedWindows[iWindow].second);
+				if (iWindow > 0) {
+					sameWindows = sameWindows && (sortedWindows[iWindow - 1].second >= sortedWindows[iWindow].second);
+				}
+			}
+		}
+		return sameWindows;
+	};
+	REQUIRE( checkWindows(0, 100) );
+	REQUIRE( checkWindows(1000, 500) );
+	REQUIRE( checkWindows(testParser.alignmentLength() - 10, 100) );
+	REQUIRE_THROWS( testParser.extractWindow(testParser.alignmentLength(), 10, 4) );
+	REQUIRE_THROWS( testParser.extractWindowSorted(testParser.alignmentLength(), 10, 4) );
+	testParser.maskColumns({ {1010, 1100} });
+	REQUIRE( checkWindows(1000, 500) );
+}
+
+TEST_CASE("Column-range shards reproduce the whole-alignment scan", "[shard]") { // NOLINT
+	const std::string testFASTAfile("../tests/testK.fasta");
+	const BayesicSpace::ParseFASTA testParser(testFASTAfile);
+	const std::vector<BayesicSpace::FastaIndexRecord> fastaIndex{BayesicSpace::indexFASTA(testFASTAfile)};
+	SECTION("Index and column range reading") {
+		REQUIRE( fastaIndex.size() == testParser.sequenceNumber() );
+		REQUIRE( fastaIndex.back().name == testParser.header(testParser.sequenceNumber() - 1) );
+		REQUIRE( fastaIndex.front().length == testParser.alignmentLength() );
+		const BayesicSpace::ParseFASTA rangeParser(testFASTAfile, fastaIndex, 1234, 567);
+		REQUIRE( rangeParser.alignmentLength() == 567 );
+		bool sameColumns{true};
+		for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); ++iSeq) {
+			sameColumns = sameColumns && ( rangeParser.sequence(iSeq) == testParser.sequence(iSeq).substr(1234, 567) );
+		}
+		REQUIRE( sameColumns );
+		REQUIRE_THROWS( BayesicSpace::ParseFASTA(testFASTAfile, fastaIndex, testParser.alignmentLength() - 10, 11) );
+		REQUIRE_THROWS( BayesicSpace::ParseFASTA(testFASTAfile, fastaIndex, 0, 0) );
+	}
+	SECTION("Multi-word headers with a samtools index") {
+		const std::string multiWordFile("../tests/multiWord.tmp");
+		std::fstream outStream;
+		outStream.open(multiWordFile, std::ios::out);
+		outStream << ">seq1 lineage=B.1 date=2021\nACGTACGTAC\nGTAC\n>seq2 lineage=A\nACGTTCGTAC\nGTAA\n";
+		outStream.close();
+		// samtools records only the first header word
+		outStream.open(multiWordFile + ".fai", std::ios::out);
+		outStream << "seq1\t14\t28\t10\t11\nseq2\t14\t60\t10\t11\n";
+		outStream.close();
+		const std::vector<BayesicSpace::FastaIndexRecord> samtoolsIndex{BayesicSpace::indexFASTA(multiWordFile)};
+		REQUIRE(samtoolsIndex.front().name == "seq1");
+		const BayesicSpace::ParseFASTA multiWordParser(multiWordFile, samtoolsIndex, 8, 5);
+		REQUIRE( multiWordParser.header(0) == "seq1 lineage=B.1 date=2021" );
+		REQUIRE( multiWordParser.header(1) == "seq2 lineage=A" );
+		REQUIRE( multiWordParser.sequence(1) == "ACGTA" );
+		std::remove( ( multiWordFile + ".fai" ).c_str() );
+		// blank lines are allowed only where no sequence follows them in the record
+		outStream.open(multiWordFile, std::ios::out);
+		outStream << ">seq1\nACGTACGTAC\nGTAC\n\n>seq2\nACGTTCGTAC\nGTAA\n\n";
+		outStream.close();
+		REQUIRE( BayesicSpace::indexFASTA(multiWordFile).back().length == 14 );
+		outStream.open(multiWordFile, std::ios::out);
+		outStream << ">seq1\nACGTACGTAC\n\nGTACGTACGT\n";
+		outStream.close();
+		REQUIRE_THROWS( BayesicSpace::indexFASTA(multiWordFile) );
+		outStream.open(multiWordFile, std::ios::out);
+		outStream << ">seq1\n\nACGTACGTAC\n";
+		outStream.close();
+		REQUIRE_THROWS( BayesicSpace::indexFASTA(multiWordFile) );
+		std::remove( multiWordFile.c_str() );
+	}
+	SECTION("Shard specification") {
+		size_t shardIdx{0};
+		size_t shardNumber{0};
+		BayesicSpace::parseShard("2/5", shardIdx, shardNumber);
+		REQUIRE( shardIdx == 2 );
+		REQUIRE( shardNumber == 5 );
+		REQUIRE_THROWS( BayesicSpace::parseShard("0/5", shardIdx, shardNumber) );
+		REQUIRE_THROWS( BayesicSpace::parseShard("6/5", shardIdx, shardNumber) );
+		REQUIRE_THROWS( BayesicSpace::parseShard("2", shardIdx, shardNumber) );
+		REQUIRE_THROWS( BayesicSpace::parseShard("a/5", shardIdx, shardNumber) );
+		REQUIRE_THROWS( BayesicSpace::parseShard("2/", shardIdx, shardNumber) );
+	}
+	SECTION("Sharded scans") {
+		auto shardedScanMatches = [&testParser, &fastaIndex, &testFASTAfile](size_t windowSize, size_t stepSize, size_t shardNumber){
+			const auto fullScan = testParser.diversityInWindows(windowSize, stepSize);
+			std::vector< std::pair< size_t, std::vector<uint32_t> > > shardedScan;
+			for (size_t shardIdx = 1; shardIdx <= shardNumber; ++shardIdx) {
+				const auto columnRange = BayesicSpace::shardColumnRange(shardIdx, shardNumber, testParser.alignmentLength(), windowSize, stepSize);
+				if (columnRange.second == 0) {
+					continue;
+				}
+				const BayesicSpace::ParseFASTA shardParser(testFASTAfile, fastaIndex, columnRange.first, columnRange.second);
+				for ( auto &eachWindow : shardParser.diversityInWindows(windowSize, stepSize) ) {
+					shardedScan.emplace_back( eachWindow.first + columnRange.first, std::move(eachWindow.second) );
+				}
+			}
+			return shardedScan == fullScan;
+		};
+		REQUIRE( shardedScanMatches(100, 10, 1) );
+		REQUIRE( shardedScanMatches(100, 10, 3) );
+		REQUIRE( shardedScanMatches(150, 37, 7) );
+		REQUIRE( shardedScanMatches(testParser.alignmentLength() - 5, 1, 10) );
+		REQUIRE( BayesicSpace::shardColumnRange(1, 2, 100, 100, 10).second == 0 );
+	}
+	SECTION("Merging shard tables") {
+		const std::vector<std::string> shardFiles{"../tests/shard1.tmp", "../tests/shard2.tmp"};
+		std::fstream shardStream;
+		shardStream.open(shardFiles[0], std::ios::out);
+		shardStream << "position\tcount\n1\t5\n";
+		shardStream.close();
+		shardStream.open(shardFiles[1], std::ios::out);
+		shardStream << "position\tcount\n11\t4\n11\t1\n";
+		shardStream.close();
+		std::fstream mergedStream;
+		mergedStream.open("../tests/merged.tmp", std::ios::out);
+		BayesicSpace::mergeShardTables(shardFiles, mergedStream);
+		mergedStream.close();
+		mergedStream.open("../tests/merged.tmp", std::ios::in);
+		const std::string merged( (std::istreambuf_iterator<char>(mergedStream)), std::istreambuf_iterator<char>() );
+		mergedStream.close();
+		REQUIRE( merged == "position\tcount\n1\t5\n11\t4\n11\t1\n" );
+		shardStream.open(shardFiles[1], std::ios::out);
+		shardStream << "position\tcount\tunmasked\n";
+		shardStream.close();
+		mergedStream.open("../tests/merged.tmp", std::ios::out);
+		REQUIRE_THROWS( BayesicSpace::mergeShardTables(shardFiles, mergedStream) );
+		mergedStream.close();
+		std::remove( shardFiles[0].c_str() );
+		std::remove( shardFiles[1].c_str() );
+		std::remove("../tests/merged.tmp");
+	}
+}
+
+TEST_CASE("Progressive scans refine coarse windows", "[progressive]") { // NOLINT
+	const std::string testFASTAfile("../tests/testK.fasta");
+	BayesicSpace::ParseFASTA testParser(testFASTAfile);
+	const BayesicSpace::WindowPlan hashPlan{BayesicSpace::WindowEngine::hash, 1, 0.0, 0.0};
+	auto progressiveScanMatches = [&testParser](size_t windowSize, size_t stepSize, size_t coarseStride, const BayesicSpace::WindowPlan &plan){
+		auto fullScan = testParser.diversityInWindows(windowSize, stepSize);
+		// engines may list the counts of a window in different orders
+		for (auto &eachWindow : fullScan) {
+			std::sort( eachWindow.second.begin(), eachWindow.second.end() );
+		}
+		std::vector< std::pair< size_t, std::vector<uint32_t> > > progressiveScan;
+		const size_t nWindows = testParser.diversityInWindows(windowSize, stepSize, coarseStride, plan,
+			[&progressiveScan](const size_t &windowStart, std::vector<uint32_t> &&counts){
+				std::sort( counts.begin(), counts.end() );
+				progressiveScan.emplace_back( windowStart, std::move(counts) );
+				return true;
+			}
+		);
+		std::sort( progressiveScan.begin(), progressiveScan.end() );
+		return (nWindows == fullScan.size() ) && (progressiveScan == fullScan);
+	};
+	SECTION("All windows are reported") {
+		REQUIRE( progressiveScanMatches(100, 10, 0, hashPlan) );
+		REQUIRE( progressiveScanMatches(100, 10, 1, hashPlan) );
+		REQUIRE( progressiveScanMatches(100, 10, 16, hashPlan) );
+		REQUIRE( progressiveScanMatches(150, 37, 50, hashPlan) );
+		REQUIRE( progressiveScanMatches(100, 10, 100000, hashPlan) );
+		testParser.maskColumns({ {1010, 1100} });
+		REQUIRE( progressiveScanMatches(100, 10, 8, hashPlan) );
+	}
+	SECTION("Planned engines and threads") {
+		REQUIRE( progressiveScanMatches(100, 10, 16, BayesicSpace::WindowPlan{BayesicSpace::WindowEngine::projection, 3, 0.0, 0.0}) );
+		REQUIRE( progressiveScanMatches(150, 37, 50, BayesicSpace::WindowPlan{BayesicSpace::WindowEngine::hash, 4, 0.0, 0.0}) );
+		testParser.buildPrefixHashIndex(64);
+		REQUIRE( progressiveScanMatches(200, 10, 8, BayesicSpace::WindowPlan{BayesicSpace::WindowEngine::prefixHash, 2, 0.0, 0.0}) );
+		// threaded batches are still reported coarse to fine
+		std::vector<size_t> windowStarts;
+		testParser.diversityInWindows(100, 10, 5, BayesicSpace::WindowPlan{BayesicSpace::WindowEngine::hash, 3, 0.0, 0.0},
+			[&windowStarts](const size_t &windowStart, std::vector<uint32_t> &&){
+				windowStarts.push_back(windowStart);
+				return true;
+			}
+		);
+		REQUIRE( windowStarts.at(0) == 0 );
+		REQUIRE( windowStarts.at(1) == 40 );
+		REQUIRE( windowStarts.back() % 20 == 10 );
+	}
+	SECTION("Coarse windows come first") {
+		std::vector<size_t> windowStarts;
+		testParser.diversityInWindows(100, 10, 5, hashPlan,
+			[&windowStarts](const size_t &windowStart, std::vector<uint32_t> &&){
+				windowStarts.push_back(windowStart);
+				return true;
+			}
+		);
+		// stride 5 rounds down to 4: windows 0, 4, 8, ... then 2, 6, ... then the odd ones
+		REQUIRE( windowStarts.at(0) == 0 );
+		REQUIRE( windowStarts.at(1) == 40 );
+		const size_t nCoarse = ( windowStarts.size() + 3 ) / 4;
+		REQUIRE( windowStarts.at(nCoarse) == 20 );
+		REQUIRE( windowStarts.back() % 20 == 10 );
+	}
+	SECTION("Cancellation") {
+		size_t nReported{0};
+		const size_t nWindows = testParser.diversityInWindows(100, 10, 4, hashPlan,
+			[&nReported](const size_t &, std::vector<uint32_t> &&){
+				++nReported;
+				return nReported < 7;
+			}
+		);
+		REQUIRE( nWindows == 7 );
+		REQUIRE( nReported == 7 );
+		// threads stop at the end of the batch holding the cancelled window
+		nReported = 0;
+		REQUIRE( testParser.diversityInWindows(100, 10, 4, BayesicSpace::WindowPlan{BayesicSpace::WindowEngine::hash, 2, 0.0, 0.0},
+			[&nReported](const size_t &, std::vector<uint32_t> &&){
+				++nReported;
+				return nReported < 7;
+			}
+		) == 7 );
+		REQUIRE_THROWS( testParser.diversityInWindows(100, 0, 4, hashPlan, [](const size_t &, std::vector<uint32_t> &&){return true;}) );
+	}
+}
+
+TEST_CASE("Sequences are reordered by similarity", "[reorder]") { // NOLINT
+	const std::string testFASTAfile("../tests/testK.fasta");
+	const BayesicSpace::ParseFASTA fileOrderParser(testFASTAfile);
+	BayesicSpace::ParseFASTA testParser(testFASTAfile);
+	testParser.reorderBySimilarity();
+	auto sameSequences = [&fileOrderParser](const BayesicSpace::ParseFASTA &parser){
+		bool same = parser.sequenceNumber() == fileOrderParser.sequenceNumber();
+		for (size_t iSeq = 0; same && ( iSeq < parser.sequenceNumber() ); ++iSeq) {
+			same = ( parser.header(iSeq) == fileOrderParser.header(iSeq) ) && ( parser.sequence(iSeq) == fileOrderParser.sequence(iSeq) );
+		}
+		return same;
+	};
+	auto sortedCounts = [](std::vector< std::pair< size_t, std::vector<uint32_t> > > table){
+		for (auto &eachWindow : table) {
+			std::sort( eachWindow.second.begin(), eachWindow.second.end() );
+		}
+		return table;
+	};
+	SECTION("Original order is kept") {
+		REQUIRE( sameSequences(testParser) );
+		REQUIRE( testParser.alignmentHash() == fileOrderParser.alignmentHash() );
+		REQUIRE( testParser.sequenceIndex( fileOrderParser.header(7) ) == 7 );
+		REQUIRE( testParser.extractConsensusWindow( 0, testParser.alignmentLength() ) == fileOrderParser.extractConsensusWindow( 0, fileOrderParser.alignmentLength() ) );
+		const BayesicSpace::ParseFASTA copiedParser(testParser);
+		REQUIRE( sameSequences(copiedParser) );
+		testParser.reorderBySimilarity();
+		REQUIRE( sameSequences(testParser) );
+	}
+	SECTION("Window statistics do not change") {
+		REQUIRE( sortedCounts( testParser.diversityInWindows(100, 50) ) == sortedCounts( fileOrderParser.diversityInWindows(100, 50) ) );
+		REQUIRE( testParser.extractWindow(1000, 300) == fileOrderParser.extractWindow(1000, 300) );
+		REQUIRE( testParser.extractWindow(1000, 300, 3) == fileOrderParser.extractWindow(1000, 300) );
+	}
+	SECTION("Placed sequences are appended in the original order") {
+		const std::string newSequence{fileOrderParser.sequence(3).substr(500, 400)};
+		testParser.placeSequences({ {"placed", newSequence} }, 1);
+		REQUIRE( testParser.sequenceNumber() == fileOrderParser.sequenceNumber() + 1 );
+		REQUIRE( testParser.header(testParser.sequenceNumber() - 1) == "placed" );
+		REQUIRE( testParser.sequenceIndex("placed") == fileOrderParser.sequenceNumber() );
+		REQUIRE( testParser.header(3) == fileOrderParser.header(3) );
+	}
+}
+
+TEST_CASE("Block-compressed store gives random access to windows", "[blockStore]") { // NOLINT
+	const std::string testFASTAfile("../tests/testK.fasta");
+	const BayesicSpace::ParseFASTA testParser(testFASTAfile);
+	const BayesicSpace::BlockCompressedAlignment testStore(testParser, 256, 4);
+	SECTION("Store properties") {
+		REQUIRE( testStore.sequenceNumber() == testParser.sequenceNumber() );
+		REQUIRE( testStore.alignmentLength() == testParser.alignmentLength() );
+		REQUIRE( testStore.blockNumber() == (testParser.alignmentLength() + 255) / 256 );
+		REQUIRE( testStore.header(5) == testParser.header(5) );
+		REQUIRE( testStore.compressedBytes() < testParser.sequenceNumber() * testParser.alignmentLength() / 4 );
+		REQUIRE_THROWS( BayesicSpace::BlockCompressedAlignment(testParser, 0, 4) );
+		REQUIRE_THROWS( BayesicSpace::BlockCompressedAlignment(testParser, 256, 0) );
+	}
+	SECTION("Windows match the alignment") {
+		bool sameWindows{true};
+		for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); ++iSeq) {
+			sameWindows = sameWindows && ( testStore.window(iSeq, 0, testParser.alignmentLength() ) == testParser.sequence(iSeq) );
+		}
+		REQUIRE( sameWindows );
+		REQUIRE( testStore.window(3, 250, 20) == testParser.sequence(3).substr(250, 20) );
+		REQUIRE( testStore.window(3, testParser.alignmentLength() - 5, 100) == testParser.sequence(3).substr(testParser.alignmentLength() - 5) );
+		REQUIRE( testStore.extractWindow(1000, 500) == testParser.extractWindow(1000, 500) );
+		REQUIRE( testStore.extractWindow(10, 100) == testParser.extractWindow(10, 100) );
+		REQUIRE_THROWS( testStore.window(testParser.sequenceNumber(), 0, 10) );
+		REQUIRE_THROWS( testStore.extractWindow(testParser.alignmentLength(), 10) );
+	}
+	SECTION("Streaming from the FASTA file") {
+		const BayesicSpace::BlockCompressedAlignment fileStore(testFASTAfile, 100, 2);
+		REQUIRE( fileStore.sequenceNumber() == testParser.sequenceNumber() );
+		REQUIRE( fileStore.alignmentLength() == testParser.alignmentLength() );
+		REQUIRE( fileStore.header(7) == testParser.header(7) );
+		bool sameWindows{true};
+		for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); ++iSeq) {
+			sameWindows = sameWindows && ( fileStore.window(iSeq, 0, testParser.alignmentLength() ) == testParser.sequence(iSeq) );
+		}
+		REQUIRE( sameWindows );
+		REQUIRE( fileStore.extractWindow(1000, 500) == testParser.extractWindow(1000, 500) );
+		REQUIRE( fileStore.extractWindowSorted(1000, 500) == testParser.extractWindowSorted(1000, 500) );
+		REQUIRE( fileStore.consensusWindow(1000, 500) == testStore.consensusWindow(1000, 500) );
+		// ties may be broken differently, but the two consensus residues must then be equally common
+		const std::string storeConsensus{fileStore.consensusWindow( 0, testParser.alignmentLength() )};
+		const std::string parserConsensus{testParser.extractConsensusWindow( 0, testParser.alignmentLength() )};
+		bool sameConsensus{true};
+		for (size_t iCol = 0; iCol < testParser.alignmentLength(); ++iCol) {
+			if (storeConsensus[iCol] == parserConsensus[iCol]) {
+				continue;
+			}
+			int64_t countDifference{0};
+			for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); ++iSeq) {
+				countDifference += testParser.sequence(iSeq)[iCol] == storeConsensus[iCol] ? 1 : 0;
+				countDifference -= testParser.sequence(iSeq)[iCol] == parserConsensus[iCol] ? 1 : 0;
+			}
+			sameConsensus = sameConsensus && (countDifference == 0);
+		}
+		REQUIRE( sameConsensus );
+		REQUIRE( fileStore.consensusWindow(1000, 500).size() == 500 );
+		REQUIRE_THROWS( fileStore.consensusWindow(testParser.alignmentLength(), 10) );
+		REQUIRE_THROWS( BayesicSpace::BlockCompressedAlignment("../tests/noSuchFile.fasta", 100, 2) );
+	}
+}
+
+TEST_CASE("Sequences with too much missing data are filtered", "[missingData]") { // NOLINT
+	const std::string testFASTAfile("../tests/testK.fasta");
+	BayesicSpace::ParseFASTA testParser(testFASTAfile);
+	auto countMissing = [&testParser](size_t iSeq, size_t startIdx, size_t windowLength){
+		const std::string window{testParser.sequence(iSeq).substr(startIdx, windowLength)};
+		return static_cast<size_t>( std::count_if( window.cbegin(), window.cend(),
+			[](char residue){return std::string("ACGTUacgtu").find(residue) == std::string::npos;} ) );
+	};
+	SECTION("Missing data counts") {
+		bool sameCounts{true};
+		for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); ++iSeq) {
+			sameCounts = sameCounts && ( testParser.missingColumns(iSeq, 0, testParser.alignmentLength() ) == countMissing(iSeq, 0, testParser.alignmentLength() ) );
+			sameCounts = sameCounts && ( testParser.missingColumns(iSeq, 37, 200) == countMissing(iSeq, 37, 200) );
+			sameCounts = sameCounts && ( testParser.missingColumns(iSeq, 64, 64) == countMissing(iSeq, 64, 64) );
+		}
+		REQUIRE( sameCounts );
+		REQUIRE( testParser.missingColumns(0, 0, 60) == 60 );
+		testParser.maskColumns({ {10, 30} });
+		REQUIRE( testParser.missingColumns(0, 0, 60) == 40 );
+		REQUIRE_THROWS( testParser.missingColumns(testParser.sequenceNumber(), 0, 10) );
+	}
+	SECTION("Window filtering") {
+		const size_t windowStart{1000};
+		const size_t windowSize{300};
+		uint32_t nKept{0};
+		for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); ++iSeq) {
+			nKept += countMissing(iSeq, windowStart, windowSize) * 10 <= windowSize ? 1 : 0;
+		}
+		auto totalCount = [](const std::unordered_map<std::string, uint32_t> &windows){
+			uint32_t total{0};
+			for (const auto &eachWindow : windows) {
+				total += eachWindow.second;
+			}
+			return total;
+		};
+		REQUIRE( totalCount( testParser.extractWindow(windowStart, windowSize) ) == testParser.sequenceNumber() );
+		testParser.filterMissing(0.1);
+		const auto filteredWindows = testParser.extractWindow(windowStart, windowSize);
+		REQUIRE( totalCount(filteredWindows) == nKept );
+		REQUIRE( testParser.extractWindow(windowStart, windowSize, 3) == filteredWindows );
+		const auto diversity = testParser.diversityInWindows(windowSize, windowStart);
+		REQUIRE( std::accumulate( diversity.at(1).second.cbegin(), diversity.at(1).second.cend(), uint32_t{0} ) == nKept );
+		uint32_t nKeptFirst{0};
+		for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); ++iSeq) {
+			nKeptFirst += countMissing(iSeq, 0, windowSize) * 10 <= windowSize ? 1 : 0;
+		}
+		REQUIRE( std::accumulate( diversity.at(0).second.cbegin(), diversity.at(0).second.cend(), uint32_t{0} ) == nKeptFirst );
+		testParser.reorderBySimilarity();
+		REQUIRE( testParser.extractWindow(windowStart, windowSize) == filteredWindows );
+		testParser.filterMissing(1.0);
+		REQUIRE( totalCount( testParser.extractWindow(windowStart, windowSize) ) == testParser.sequenceNumber() );
+		REQUIRE_THROWS( testParser.filterMissing(1.5) );
+		REQUIRE_THROWS( testParser.filterMissing(-0.1) );
+	}
+}
+
+TEST_CASE("Windows compatible up to missing data are grouped", "[compatibleGroups]") { // NOLINT
+	const std::string testFASTAfile("../tests/testK.fasta");
+	BayesicSpace::ParseFASTA testParser(testFASTAfile);
+	auto totalCount = [](const std::unordered_map<std::string, uint32_t> &windows){
+		uint32_t total{0};
+		for (const auto &eachWindow : windows) {
+			total += eachWindow.second;
+		}
+		return total;
+	};
+	// two windows are compatible if each position allows a common state
+	auto compatible = [](const std::string &first, const std::string &second){
+		for (size_t iPos = 0; iPos < first.size(); ++iPos) {
+			auto states = [](char residue){
+				const uint8_t nucMask = BayesicSpace::iupacMask(residue);
+				return residue == '-' ? uint8_t{16} : (nucMask == 15 ? uint8_t{31} : nucMask);
+			};
+			if ( ( states(first[iPos]) & states(second[iPos]) ) == 0 ) {
+				return false;
+			}
+		}
+		return true;
+	};
+	const size_t windowStart{400};
+	const size_t windowSize{400};
+	const auto exactWindows = testParser.extractWindow(windowStart, windowSize);
+	testParser.groupCompatible(true);
+	const auto groupedWindows = testParser.extractWindow(windowStart, windowSize);
+	SECTION("Groups cover all sequences and are pairwise incompatible") {
+		REQUIRE( totalCount(groupedWindows) == totalCount(exactWindows) );
+		REQUIRE( groupedWindows.size() < exactWindows.size() );
+		bool allIncompatible{true};
+		for (const auto &firstGroup : groupedWindows) {
+			for (const auto &secondGroup : groupedWindows) {
+				if (firstGroup.first != secondGroup.first) {
+					allIncompatible = allIncompatible && !compatible(firstGroup.first, secondGroup.first);
+				}
+			}
+		}
+		REQUIRE( allIncompatible );
+		// every exact window is compatible with at least one group
+		bool allPlaced{true};
+		for (const auto &eachWindow : exactWindows) {
+			allPlaced = allPlaced && std::any_of( groupedWindows.cbegin(), groupedWindows.cend(),
+				[&eachWindow, &compatible](const std::pair<const std::string, uint32_t> &eachGroup){return compatible(eachWindow.first, eachGroup.first);} );
+		}
+		REQUIRE( allPlaced );
+	}
+	SECTION("All scans group the same way") {
+		REQUIRE( testParser.extractWindow(windowStart, windowSize, 3) == groupedWindows );
+		const auto sortedGroups = testParser.extractWindowSorted(windowStart, windowSize, 3);
+		REQUIRE( sortedGroups.size() == groupedWindows.size() );
+		REQUIRE( std::is_sorted( sortedGroups.cbegin(), sortedGroups.cend(),
+			[](const std::pair<std::string, uint32_t> &first, const std::pair<std::string, uint32_t> &second){return first.second > second.second;} ) );
+		REQUIRE( testParser.extractWindowSorted(windowStart, windowSize).size() == groupedWindows.size() );
+		const auto diversity = testParser.diversityInWindows(windowSize, windowStart);
+		REQUIRE( diversity.at(1).second.size() == groupedWindows.size() );
+		testParser.groupCompatible(false);
+		REQUIRE( testParser.extractWindow(windowStart, windowSize) == exactWindows );
+	}
+}
+
+TEST_CASE("Gap-encoded alignments store gap runs and residues", "[gapEncoding]") { // NOLINT
+	const std::string testFASTAfile("../tests/testK.fasta");
+	const BayesicSpace::ParseFASTA testParser(testFASTAfile);
+	const BayesicSpace::GapEncodedAlignment fileEncoded(testFASTAfile);
+	const BayesicSpace::GapEncodedAlignment parserEncoded(testParser);
+	SECTION("Encoding") {
+		REQUIRE( fileEncoded.sequenceNumber() == testParser.sequenceNumber() );
+		REQUIRE( fileEncoded.alignmentLength() == testParser.alignmentLength() );
+		REQUIRE( fileEncoded.header(4) == testParser.header(4) );
+		std::string ungapped;
+		std::copy_if( testParser.sequence(0).cbegin(), testParser.sequence(0).cend(), std::back_inserter(ungapped), [](char residue){return residue != '-';} );
+		REQUIRE( fileEncoded.residues(0) == ungapped );
+		REQUIRE( fileEncoded.gapRuns(0).front().start == 0 );
+		REQUIRE( fileEncoded.storageBytes() == parserEncoded.storageBytes() );
+		REQUIRE_THROWS( BayesicSpace::GapEncodedAlignment("../tests/empty.fasta") );
+	}
+	SECTION("Windows and consensus") {
+		bool sameWindows{true};
+		for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); ++iSeq) {
+			sameWindows = sameWindows && ( fileEncoded.window(iSeq, 0, testParser.alignmentLength() ) == testParser.sequence(iSeq) );
+			sameWindows = sameWindows && ( fileEncoded.window(iSeq, 17, 333) == testParser.sequence(iSeq).substr(17, 333) );
+			sameWindows = sameWindows && ( fileEncoded.window(iSeq, testParser.alignmentLength() - 3, 10) == testParser.sequence(iSeq).substr(testParser.alignmentLength() - 3) );
+		}
+		REQUIRE( sameWindows );
+		REQUIRE( fileEncoded.extractWindow(1000, 500) == testParser.extractWindow(1000, 500) );
+		// ParseFASTA breaks ties in hash table order, so the two consensus sequences may differ only at ties
+		const std::string encodedConsensus{fileEncoded.consensus()};
+		const std::string parserConsensus{testParser.extractConsensusWindow( 0, testParser.alignmentLength() )};
+		REQUIRE( encodedConsensus.size() == parserConsensus.size() );
+		bool onlyTies{true};
+		for (size_t iCol = 0; iCol < encodedConsensus.size(); ++iCol) {
+			if (encodedConsensus[iCol] != parserConsensus[iCol]) {
+				uint32_t encodedCount{0};
+				uint32_t parserCount{0};
+				for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); ++iSeq) {
+					encodedCount += testParser.sequence(iSeq)[iCol] == encodedConsensus[iCol] ? 1 : 0;
+					parserCount  += testParser.sequence(iSeq)[iCol] == parserConsensus[iCol] ? 1 : 0;
+				}
+				onlyTies = onlyTies && (encodedCount == parserCount);
+			}
+		}
+		REQUIRE( onlyTies );
+		REQUIRE_THROWS( fileEncoded.window(0, testParser.alignmentLength(), 10) );
+		REQUIRE_THROWS( fileEncoded.window(testParser.sequenceNumber(), 0, 10) );
+		REQUIRE( fileEncoded.consensusWindow(1000, 500) == encodedConsensus.substr(1000, 500) );
+		REQUIRE( fileEncoded.consensusWindow(testParser.alignmentLength() - 3, 10) == encodedConsensus.substr(testParser.alignmentLength() - 3) );
+		REQUIRE_THROWS( fileEncoded.consensusWindow(testParser.alignmentLength(), 10) );
+		REQUIRE( fileEncoded.extractWindowSorted(1000, 500) == testParser.extractWindowSorted(1000, 500) );
+	}
+}
+
+TEST_CASE("Indel events are indexed by position", "[indelIndex]") { // NOLINT
+	const BayesicSpace::ParseFASTA testParser("../tests/testK.fasta");
+	const BayesicSpace::IndelIndex testIndels{BayesicSpace::GapEncodedAlignment(testParser)};
+	// brute-force distinct internal gap runs and their carriers
+	std::vector< std::pair<size_t, size_t> > intervals;
+	for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); ++iSeq) {
+		const std::string &sequence = testParser.sequence(iSeq);
+		size_t iCol{0};
+		while (iCol < sequence.size()) {
+			if (sequence[iCol] != '-') {
+				++iCol;
+				continue;
+			}
+			const size_t runStart{iCol};
+			while ( (iCol < sequence.size()) && (sequence[iCol] == '-') ) {
+				++iCol;
+			}
+			if ( (runStart > 0) && ( iCol < sequence.size() ) ) {
+				intervals.emplace_back(runStart, iCol);
+			}
+		}
+	}
+	std::sort( intervals.begin(), intervals.end() );
+	// runs shared by all sequences are not polymorphic
+	size_t distinctEvents{0};
+	for (size_t iInterval = 0; iInterval < intervals.size(); ) {
+		const size_t eventStart{iInterval};
+		while ( ( iInterval < intervals.size() ) && (intervals[iInterval] == intervals[eventStart]) ) {
+			++iInterval;
+		}
+		distinctEvents += iInterval - eventStart < testParser.sequenceNumber() ? 1 : 0;
+	}
+	SECTION("Events") {
+		REQUIRE( testIndels.size() == distinctEvents );
+		REQUIRE( testIndels.size() > 0 );
+		bool sorted{true};
+		uint64_t totalCarriers{0};
+		for (size_t iEvent = 0; iEvent < testIndels.size(); ++iEvent) {
+			sorted         = sorted && ( (iEvent == 0) || (testIndels.event(iEvent - 1).start <= testIndels.event(iEvent).start) );
+			sorted         = sorted && (testIndels.event(iEvent).start < testIndels.event(iEvent).end) && (testIndels.event(iEvent).start > 0) &&
+				(testIndels.event(iEvent).carriers < testParser.sequenceNumber() );
+			totalCarriers += testIndels.event(iEvent).carriers;
+		}
+		REQUIRE( sorted );
+		REQUIRE( totalCarriers >= testIndels.size() );
+		const BayesicSpace::IndelIndex parserIndels(testParser);
+		bool sameEvents{parserIndels.size() == testIndels.size()};
+		for (size_t iEvent = 0; sameEvents && ( iEvent < testIndels.size() ); ++iEvent) {
+			sameEvents = (parserIndels.event(iEvent).start == testIndels.event(iEvent).start) && (parserIndels.event(iEvent).end == testIndels.event(iEvent).end) &&
+				(parserIndels.event(iEvent).carriers == testIndels.event(iEvent).carriers);
+		}
+		REQUIRE( sameEvents );
+		REQUIRE_THROWS( testIndels.event( testIndels.size() ) );
+	}
+	SECTION("Window statistics") {
+		constexpr size_t windowStart{300};
+		constexpr size_t windowSize{700};
+		uint32_t windowEvents{0};
+		size_t totalLength{0};
+		uint64_t totalCarriers{0};
+		for (size_t iEvent = 0; iEvent < testIndels.size(); ++iEvent) {
+			const BayesicSpace::IndelEvent &event = testIndels.event(iEvent);
+			if ( (event.start >= windowStart) && (event.start < windowStart + windowSize) ) {
+				++windowEvents;
+				totalLength   += event.end - event.start;
+				totalCarriers += event.carriers;
+			}
+		}
+		const BayesicSpace::IndelWindowStatistics windowStats{testIndels.windowStatistics(windowStart, windowSize)};
+		REQUIRE( windowStats.indels == windowEvents );
+		if (windowEvents > 0) {
+			constexpr double precision{1e-9};
+			REQUIRE( std::abs( windowStats.meanLength - static_cast<double>(totalLength) / static_cast<double>(windowEvents) ) < precision );
+			REQUIRE( std::abs( windowStats.meanFrequency -
+				static_cast<double>(totalCarriers) / ( static_cast<double>(windowEvents) * static_cast<double>( testParser.sequenceNumber() ) ) ) < precision );
+		}
+		const BayesicSpace::IndelWindowStatistics wholeStats{testIndels.windowStatistics( 0, testParser.alignmentLength() )};
+		REQUIRE( wholeStats.indels == testIndels.size() );
+		const BayesicSpace::IndelWindowStatistics emptyStats{testIndels.windowStatistics(testParser.alignmentLength(), 100)};
+		REQUIRE( emptyStats.indels == 0 );
+		REQUIRE( emptyStats.meanLength == 0.0 );
+		const BayesicSpace::IndelWindowStatistics unfilteredStats{testIndels.windowStatistics(windowStart, windowSize, testParser)};
+		REQUIRE( unfilteredStats.indels == windowStats.indels );
+		REQUIRE( unfilteredStats.meanLength == windowStats.meanLength );
+		REQUIRE( std::abs(unfilteredStats.meanFrequency - windowStats.meanFrequency) < 1e-9 );
+	}
+	SECTION("Filtered window statistics") {
+		BayesicSpace::ParseFASTA filteredParser("../tests/testK.fasta");
+		constexpr size_t windowStart{0};
+		const size_t windowSize{filteredParser.alignmentLength()};
+		const std::pair<size_t, size_t> maskedRange{2000, 2600};
+		// every other sequence, and a masked block
+		std::vector<uint64_t> sampleBits( (filteredParser.sequenceNumber() + 63) / 64, 0 );
+		for (size_t iSeq = 0; iSeq < filteredParser.sequenceNumber(); iSeq += 2) {
+			sampleBits[iSeq / 64] |= 1ULL << (iSeq % 64);
+		}
+		filteredParser.selectSamples(sampleBits);
+		filteredParser.maskColumns({maskedRange});
+		std::vector< std::pair<size_t, size_t> > selectedIntervals;
+		uint32_t nSelected{0};
+		for (size_t iSeq = 0; iSeq < filteredParser.sequenceNumber(); iSeq += 2) {
+			++nSelected;
+			const std::string &sequence = filteredParser.sequence(iSeq);
+			size_t iCol{0};
+			while ( iCol < sequence.size() ) {
+				if (sequence[iCol] != '-') {
+					++iCol;
+					continue;
+				}
+				const size_t runStart{iCol};
+				while ( ( iCol < sequence.size() ) && (sequence[iCol] == '-') ) {
+					++iCol;
+				}
+				const bool overlapsMask = (runStart < maskedRange.second) && (iCol > maskedRange.first);
+				if ( (runStart > 0) && ( iCol < sequence.size() ) && !overlapsMask ) {
+					selectedIntervals.emplace_back(runStart, iCol);
+				}
+			}
+		}
+		std::sort( selectedIntervals.begin(), selectedIntervals.end() );
+		uint32_t windowEvents{0};
+		uint64_t totalCarriers{0};
+		for (size_t iInterval = 0; iInterval < selectedIntervals.size(); ) {
+			const size_t eventStart{iInterval};
+			while ( ( iInterval < selectedIntervals.size() ) && (selectedIntervals[iInterval] == selectedIntervals[eventStart]) ) {
+				++iInterval;
+			}
+			if (iInterval - eventStart < nSelected) {
+				++windowEvents;
+				totalCarriers += iInterval - eventStart;
+			}
+		}
+		const BayesicSpace::IndelWindowStatistics filteredStats{testIndels.windowStatistics(windowStart, windowSize, filteredParser)};
+		REQUIRE( filteredStats.indels == windowEvents );
+		REQUIRE( filteredStats.indels < testIndels.size() );
+		if (windowEvents > 0) {
+			REQUIRE( std::abs( filteredStats.meanFrequency -
+				static_cast<double>(totalCarriers) / ( static_cast<double>(windowEvents) * static_cast<double>(nSelected) ) ) < 1e-9 );
+		}
+		const std::string twoSequenceFile("../tests/twoSequences.tmp");
+		std::fstream testFile;
+		testFile.open(twoSequenceFile, std::ios::out);
+		testFile << ">s1\nAC--GT\n>s2\nACGTGT\n";
+		testFile.close();
+		const BayesicSpace::ParseFASTA twoSequences(twoSequenceFile);
+		std::remove( twoSequenceFile.c_str() );
+		REQUIRE_THROWS( testIndels.windowStatistics(0, 6, twoSequences) );
+	}
+}
+
+TEST_CASE("Header metadata selects samples", "[sampleTable]") { // NOLINT
+	BayesicSpace::ParseFASTA testParser("../tests/testK.fasta");
+	const std::vector<std::string> lineages{"B.1", "B.1.1", "A"};
+	std::vector<std::string> headers;
+	for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); ++iSeq) {
+		headers.push_back( testParser.header(iSeq) + "|2021-0" + std::to_string(iSeq % 9 + 1) + "-15 lineage=" + lineages[iSeq % lineages.size()] +
+			( iSeq % 2 == 0 ? " depth=" + std::to_string(iSeq * 10) : std::string{} ) );
+	}
+	const BayesicSpace::SampleTable testTable(headers);
+	auto countBits = [](const std::vector<uint64_t> &bits){
+		size_t nSet{0};
+		for (const auto &eachWord : bits) {
+			nSet += static_cast<size_t>( __builtin_popcountll(eachWord) );
+		}
+		return nSet;
+	};
+	SECTION("Columns") {
+		REQUIRE( testTable.sampleNumber() == testParser.sequenceNumber() );
+		REQUIRE( testTable.columnNumber() == 4 );
+		REQUIRE( testTable.columnName(0) == "field1" );
+		REQUIRE( testTable.value(0, "field1") == testParser.header(0) );
+		REQUIRE( testTable.value(1, "lineage") == "B.1.1" );
+		REQUIRE( testTable.value(2, "field2") == "2021-03-15" );
+		REQUIRE( testTable.value(1, "depth").empty() );
+		REQUIRE_THROWS( testTable.value(0, "country") );
+		REQUIRE_THROWS( testTable.value(testParser.sequenceNumber(), "lineage") );
+		const BayesicSpace::SampleTable parserTable(testParser);
+		REQUIRE( parserTable.sampleNumber() == testParser.sequenceNumber() );
+	}
+	SECTION("Predicates") {
+		size_t nB1{0};
+		size_t nB1late{0};
+		size_t nDeep{0};
+		for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); ++iSeq) {
+			nB1     += iSeq % lineages.size() == 0 ? 1 : 0;
+			nB1late += ( (iSeq % lineages.size() == 0) && (iSeq % 9 + 1 > 4) ) ? 1 : 0;
+			nDeep   += ( (iSeq % 2 == 0) && (iSeq * 10 > 95) ) ? 1 : 0;
+		}
+		REQUIRE( countBits( testTable.select("lineage=B.1") ) == nB1 );
+		REQUIRE( countBits( testTable.select("lineage = B.1 & field2>2021-05") ) == nB1late );
+		REQUIRE( countBits( testTable.select("lineage!=B.1 | lineage=B.1") ) == testParser.sequenceNumber() );
+		// numeric comparison: 100 > 95 even though "100" < "95" as strings
+		REQUIRE( countBits( testTable.select("depth>95") ) == nDeep );
+		REQUIRE_THROWS( testTable.select("country=France") );
+		REQUIRE_THROWS( testTable.select("lineage") );
+	}
+	SECTION("Window selection") {
+		constexpr size_t windowStart{400};
+		constexpr size_t windowSize{400};
+		const std::vector<uint64_t> selection{testTable.select("lineage=B.1")};
+		std::unordered_map<std::string, uint32_t> expected;
+		for (size_t iSeq = 0; iSeq < testParser.sequenceNumber(); iSeq += lineages.size()) {
+			++expected[testParser.sequence(iSeq).substr(windowStart, windowSize)];
+		}
+		testParser.selectSamples(selection);
+		REQUIRE( testParser.extractWindow(windowStart, windowSize) == expected );
+		REQUIRE( testParser.extractWindow(windowStart, windowSize, 3) == expected );
+		testParser.reorderBySimilarity();
+		REQUIRE( testParser.extractWindow(windowStart, windowSize) == expected );
+		testParser.selectSamples( std::vector<uint64_t>{} );
+		uint32_t total{0};
+		for (const auto &eachWindow : testParser.extractWindow(windowStart, windowSize) ) {
+			total += eachWindow.second;
+		}
+		REQUIRE( total == testParser.sequenceNumber() );
+		REQUIRE_THROWS( testParser.selectSamples( std::vector<uint64_t>(selection.size() + 1, 0) ) );
+	}
+}
+
+TEST_CASE("Window plans choose equivalent engines", "[windowPlan]") { // NOLINT
+	BayesicSpace::ParseFASTA testParser("../tests/testK.fasta");
+	constexpr size_t windowSize{300};
+	constexpr size_t stepSize{150};
+	const size_t windowNumber = (testParser.alignmentLength() - windowSize - 1) / stepSize + 1;
+	auto sortedCounts = [](std::vector< std::pair< size_t, std::vector<uint32_t> > > &&windows){
+		for (auto &eachWindow : windows) {
+			std::sort( eachWindow.second.begin(), eachWindow.second.end() );
+		}
+		return windows;
+	};
+	SECTION("Planning") {
+		const BayesicSpace::WindowPlan autoPlan{testParser.planWindows(windowSize, windowNumber, 4, BayesicSpace::WindowEngine::automatic)};
+		REQUIRE( autoPlan.engine != BayesicSpace::WindowEngine::automatic );
+		REQUIRE( autoPlan.threads == 4 );
+		REQUIRE( autoPlan.polymorphicFraction >= 0.0 );
+		REQUIRE( autoPlan.polymorphicFraction <= 1.0 );
+		REQUIRE( autoPlan.duplicationRate >= 0.0 );
+		REQUIRE( autoPlan.duplicationRate < 1.0 );
+		const BayesicSpace::WindowPlan singlePlan{testParser.planWindows(windowSize, 1, 4, BayesicSpace::WindowEngine::projection)};
+		REQUIRE( singlePlan.engine == BayesicSpace::WindowEngine::projection );
+		REQUIRE( singlePlan.threads == 1 );
+		// too few sequences to split a single window
+		REQUIRE( testParser.planWindows(windowSize, 1, 4, BayesicSpace::WindowEngine::hash).threads == 1 );
+		REQUIRE_THROWS( testParser.planWindows(windowSize, 1, 0, BayesicSpace::WindowEngine::automatic) );
+		REQUIRE( BayesicSpace::parseWindowEngine("projection") == BayesicSpace::WindowEngine::projection );
+		REQUIRE_THROWS( BayesicSpace::parseWindowEngine("pbwt") );
+	}
+	SECTION("Engines agree") {
+		const BayesicSpace::WindowPlan hashPlan{BayesicSpace::WindowEngine::hash, 3, 0.0, 0.0};
+		const BayesicSpace::WindowPlan projectionPlan{BayesicSpace::WindowEngine::projection, 3, 0.0, 0.0};
+		const auto serialWindows{sortedCounts( testParser.diversityInWindows(windowSize, stepSize) )};
+		REQUIRE( serialWindows.size() == windowNumber );
+		REQUIRE( sortedCounts( testParser.diversityInWindows(windowSize, stepSize, hashPlan) ) == serialWindows );
+		REQUIRE( sortedCounts( testParser.diversityInWindows(windowSize, stepSize, projectionPlan) ) == serialWindows );
+		REQUIRE( testParser.extractWindow(1000, windowSize, projectionPlan) == testParser.extractWindow(1000, windowSize) );
+		REQUIRE( testParser.extractWindowSorted(1000, windowSize, projectionPlan).size() == testParser.extractWindow(1000, windowSize).size() );
+		testParser.groupCompatible(true);
+		testParser.filterMissing(0.5);
+		REQUIRE( sortedCounts( testParser.diversityInWindows(windowSize, stepSize, projectionPlan) ) ==
+			sortedCounts( testParser.diversityInWindows(windowSize, stepSize) ) );
+		REQUIRE( testParser.extractWindow(400, windowSize, projectionPlan) == testParser.extractWindow(400, windowSize) );
+	}
+}
+
+TEST_CASE("Packed integer keys count short windows", "[packedWindows]") { // NOLINT
+	BayesicSpace::ParseFASTA testParser("../tests/testK.fasta");
+	const BayesicSpace::WindowPlan packedPlan{BayesicSpace::WindowEngine::packed, 2, 0.0, 0.0};
+	auto sortedCounts = [](std::vector< std::pair< size_t, std::vector<uint32_t> > > &&windows){
+		for (auto &eachWindow : windows) {
+			std::sort( eachWindow.second.begin(), eachWindow.second.end() );
+		}
+		return windows;
+	};
+	SECTION("Window size classes") {
+		// one key word, two key words, and projections too wide to pack
+		const std::vector<size_t> windowSizes{20, 90, 600};
+		for (const auto &windowSize : windowSizes) {
+			REQUIRE( sortedCounts( testParser.diversityInWindows(windowSize, 37, packedPlan) ) == sortedCounts( testParser.diversityInWindows(windowSize, 37) ) );
+			REQUIRE( testParser.extractWindow(1200, windowSize, packedPlan) == testParser.extractWindow(1200, windowSize) );
+		}
+		REQUIRE( BayesicSpace::parseWindowEngine("packed") == BayesicSpace::WindowEngine::packed );
+		REQUIRE( testParser.planWindows(16, 100, 1, BayesicSpace::WindowEngine::automatic).engine != BayesicSpace::WindowEngine::projection );
+	}
+	SECTION("Filters") {
+		testParser.filterMissing(0.2);
+		testParser.groupCompatible(true);
+		REQUIRE( sortedCounts( testParser.diversityInWindows(30, 50, packedPlan) ) == sortedCounts( testParser.diversityInWindows(30, 50) ) );
+		const auto sortedWindow{testParser.extractWindowSorted(400, 60, packedPlan)};
+		REQUIRE( std::is_sorted( sortedWindow.cbegin(), sortedWindow.cend(),
+			[](const std::pair<std::string, uint32_t> &first, const std::pair<std::string, uint32_t> &second){return first.second > second.second;} ) );
+		REQUIRE( sortedWindow.size() == testParser.extractWindow(400, 60).size() );
+	}
+}
+
+TEST_CASE("Prefix-hash index hashes arbitrary windows", "[prefixHash]") { // NOLINT
+	BayesicSpace::ParseFASTA testParser("../tests/testK.fasta");
+	const BayesicSpace::WindowPlan prefixPlan{BayesicSpace::WindowEngine::prefixHash, 2, 0.0, 0.0};
+	auto sortedCounts = [](std::vector< std::pair< size_t, std::vector<uint32_t> > > &&windows){
+		for (auto &eachWindow : windows) {
+			std::sort( eachWindow.second.begin(), eachWindow.second.end() );
+		}
+		return windows;
+	};
+	REQUIRE_THROWS( testParser.windowHash(0, 0, 10) );
+	REQUIRE_THROWS( testParser.planWindows(100, 1, 1, BayesicSpace::WindowEngine::prefixHash) );
+	REQUIRE_THROWS( testParser.buildPrefixHashIndex(0) );
+	testParser.buildPrefixHashIndex(16);
+	REQUIRE( testParser.prefixHashSpacing() == 16 );
+	SECTION("Window hashes") {
+		// equal windows hash alike, different windows differently
+		bool hashesMatch{true};
+		const size_t windowStart{333};
+		const size_t windowSize{517};
+		for (size_t iSeq = 1; iSeq < testParser.sequenceNumber(); ++iSeq) {
+			const bool sameWindow = testParser.sequence(iSeq).substr(windowStart, windowSize) == testParser.sequence(0).substr(windowStart, windowSize);
+			const bool sameHash   = testParser.windowHash(iSeq, windowStart, windowSize) == testParser.windowHash(0, windowStart, windowSize);
+			hashesMatch           = hashesMatch && (sameWindow == sameHash);
+		}
+		REQUIRE( hashesMatch );
+		bool offsetsMatch{true};
+		for (size_t iOffset = 1; iOffset < 200; iOffset += 3) {
+			const bool sameWindow = testParser.sequence(2).substr(windowStart, 40) == testParser.sequence(2).substr(windowStart + iOffset, 40);
+			const bool sameHash   = testParser.windowHash(2, windowStart, 40) == testParser.windowHash(2, windowStart + iOffset, 40);
+			offsetsMatch          = offsetsMatch && (sameWindow == sameHash);
+		}
+		REQUIRE( offsetsMatch );
+		REQUIRE_THROWS( testParser.windowHash(testParser.sequenceNumber(), 0, 10) );
+	}
+	SECTION("Grouping") {
+		const std::vector<size_t> windowSizes{7, 64, 1000};
+		for (const auto &windowSize : windowSizes) {
+			REQUIRE( sortedCounts( testParser.diversityInWindows(windowSize, 41, prefixPlan) ) == sortedCounts( testParser.diversityInWindows(windowSize, 41) ) );
+			REQUIRE( testParser.extractWindow(100, windowSize, prefixPlan) == testParser.extractWindow(100, windowSize) );
+		}
+		// the index follows masks and reordering
+		testParser.maskColumns( std::vector< std::pair<size_t, size_t> >{ {120, 180}, {900, 905} } );
+		testParser.reorderBySimilarity();
+		REQUIRE( testParser.prefixHashSpacing() == 16 );
+		REQUIRE( sortedCounts( testParser.diversityInWindows(200, 100, prefixPlan) ) == sortedCounts( testParser.diversityInWindows(200, 100) ) );
+		REQUIRE( testParser.extractWindow(850, 100, prefixPlan) == testParser.extractWindow(850, 100) );
+		testParser.groupCompatible(true);
+		REQUIRE( sortedCounts( testParser.diversityInWindows(150, 100, prefixPlan) ) == sortedCounts( testParser.diversityInWindows(150, 100) ) );
+	}
+}
+
+TEST_CASE("Polymorphic columns give compact haplotypes", "[polymorphicWindow]") { // NOLINT
+	BayesicSpace::ParseFASTA testParser("../tests/testK.fasta");
+	auto windowCounts = [](const std::unordered_map<std::string, uint32_t> &window){
+		std::vector<uint32_t> counts;
+		for (const auto &eachWindow : window) {
+			counts.push_back(eachWindow.second);
+		}
+		std::sort( counts.begin(), counts.end() );
+		return counts;
+	};
+	SECTION("Projection of full windows") {
+		const std::vector<size_t> windowSizes{20, 90, 600};
+		for (const auto &windowSize : windowSizes) {
+			const std::vector<size_t> columns{testParser.polymorphicColumns(1200, windowSize)};
+			REQUIRE( std::is_sorted( columns.cbegin(), columns.cend() ) );
+			REQUIRE( std::all_of( columns.cbegin(), columns.cend(), [windowSize](size_t iCol){return (iCol >= 1200) && (iCol < 1200 + windowSize);} ) );
+			// with no masked columns, full windows reduced to the polymorphic offsets are the compact haplotypes
+			std::unordered_map<std::string, uint32_t> projectedWindows;
+			for ( const auto &eachWindow : testParser.extractWindow(1200, windowSize) ) {
+				std::string haplotype;
+				for (const auto &iCol : columns) {
+					haplotype.push_back(eachWindow.first[iCol - 1200]);
+				}
+				projectedWindows[haplotype] += eachWindow.second;
+			}
+			REQUIRE( testParser.extractPolymorphicWindow(1200, windowSize) == projectedWindows );
+		}
+		REQUIRE_THROWS( testParser.polymorphicColumns(testParser.alignmentLength(), 10) );
+		REQUIRE_THROWS( testParser.extractPolymorphicWindow(testParser.alignmentLength(), 10) );
+	}
+	SECTION("Filters and masks") {
+		testParser.maskColumns( std::vector< std::pair<size_t, size_t> >{ {420, 440} } );
+		testParser.filterMissing(0.2);
+		REQUIRE( windowCounts( testParser.extractPolymorphicWindow(400, 100) ) == windowCounts( testParser.extractWindow(400, 100) ) );
+		const std::vector<size_t> columns{testParser.polymorphicColumns(400, 100)};
+		REQUIRE( std::none_of( columns.cbegin(), columns.cend(), [](size_t iCol){return (iCol >= 420) && (iCol < 440);} ) );
+		testParser.groupCompatible(true);
+		REQUIRE( windowCounts( testParser.extractPolymorphicWindow(400, 100) ) == windowCounts( testParser.extractWindow(400, 100) ) );
+	}
+	SECTION("Engines and sorting") {
+		testParser.maskColumns( std::vector< std::pair<size_t, size_t> >{ {1210, 1230} } );
+		const auto packedHaplotypes = testParser.extractPolymorphicWindow(1200, 300);
+		const std::vector<BayesicSpace::WindowEngine> engines{BayesicSpace::WindowEngine::hash, BayesicSpace::WindowEngine::projection, BayesicSpace::WindowEngine::packed};
+		for (const auto &eachEngine : engines) {
+			const BayesicSpace::WindowPlan plan{eachEngine, 3, 0.0, 0.0};
+			REQUIRE( testParser.extractPolymorphicWindow(1200, 300, plan) == packedHaplotypes );
+		}
+		// sorted haplotypes follow the sorted full windows, ties included
+		const BayesicSpace::WindowPlan hashPlan{BayesicSpace::WindowEngine::hash, 3, 0.0, 0.0};
+		const auto sortedWindows    = testParser.extractWindowSorted(1200, 300, 3);
+		const auto sortedHaplotypes = testParser.extractPolymorphicWindowSorted(1200, 300, BayesicSpace::WindowPlan{BayesicSpace::WindowEngine::packed, 1, 0.0, 0.0});
+		REQUIRE( sortedHaplotypes.size() == sortedWindows.size() );
+		REQUIRE( testParser.extractPolymorphicWindowSorted(1200, 300, hashPlan) == sortedHaplotypes );
+		REQUIRE( testParser.extractWindowSorted(1200, 300) == sortedWindows );
+		// window strings skip the 20 masked columns
+		const std::vector<size_t> columns{testParser.polymorphicColumns(1200, 300)};
+		bool sameOrder{true};
+		for (size_t iWindow = 0; iWindow < sortedWindows.size(); ++iWindow) {
+			std::string haplotype;
+			for (const auto &iCol : columns) {
+				haplotype.push_back(sortedWindows[iWindow].first[iCol < 1210 ? iCol - 1200 : iCol - 1220]);
+			}
+			sameOrder = sameOrder && (haplotype == sortedHaplotypes[iWindow].first) && (sortedWindows[iWindow].second == sortedHaplotypes[iWindow].second);
+		}
+		REQUIRE(sameOrder);
+	}
+	SECTION("Output") {
+		const std::vector<size_t> columns{testParser.polymorphicColumns(1200, 90)};
+		std::string consensus;
+		for (const auto &iCol : columns) {
+			consensus += testParser.extractConsensusWindow(iCol, 1);
+		}
+		const std::unordered_map<std::string, uint32_t> haplotypeTable{testParser.extractPolymorphicWindow(1200, 90)};
+		const std::vector< std::pair<std::string, uint32_t> > haplotypes( haplotypeTable.cbegin(), haplotypeTable.cend() );
+		const std::string outFileName("../tests/polymorphic.tmp");
+		std::fstream outStream;
+		outStream.open(outFileName, std::ios::out);
+		REQUIRE_THROWS( BayesicSpace::savePolymorphicHaplotypes(haplotypes, columns, consensus + "A", BayesicSpace::CoordinateIndex{}, outStream) );
+		BayesicSpace::savePolymorphicHaplotypes(haplotypes, columns, consensus, BayesicSpace::CoordinateIndex{}, outStream);
+		outStream.close();
+		std::fstream inStream;
+		inStream.open(outFileName, std::ios::in);
+		std::string line;
+		std::getline(inStream, line);
+		REQUIRE( line.substr(0, 2) == "# " );
+		REQUIRE( static_cast<size_t>( std::count( line.cbegin(), line.cend(), ',' ) ) + 1 == columns.size() );
+		std::getline(inStream, line);
+		REQUIRE( line == consensus + "\tC" );
+		size_t nHaplotypes{0};
+		bool compactLines{true};
+		while ( std::getline(inStream, line) ) {
+			compactLines = compactLines && (line.find('\t') == columns.size());
+			++nHaplotypes;
+		}
+		inStream.close();
+		std::remove( outFileName.c_str() );
+		REQUIRE( compactLines );
+		REQUIRE( nHaplotypes == haplotypes.size() );
+		// query matches start with the query line and report the match on the consensus line
+		const BayesicSpace::AlignmentStatistics matchStats{1200, 90, 0, 5};
+		outStream.open(outFileName, std::ios::out);
+		BayesicSpace::savePolymorphicWindow(testParser, 1200, 90, matchStats, "ACGTA", BayesicSpace::WindowPlan{BayesicSpace::WindowEngine::packed, 1, 0.0, 0.0}, true, BayesicSpace::CoordinateIndex{}, outStream);
+		outStream.close();
+		inStream.open(outFileName, std::ios::in);
+		std::getline(inStream, line);
+		REQUIRE( line == "ACGTA\tQ" );
+		std::getline(inStream, line);
+		REQUIRE( line.substr(0, 2) == "# " );
+		std::getline(inStream, line);
+		REQUIRE( line == consensus + "\tC|1200|90" );
+		inStream.close();
+		std::remove( outFileName.c_str() );
+		// positions lifted over to a reference sample, with an insertion column
+		const std::string liftFile("../tests/liftover.tmp");
+		outStream.open(liftFile, std::ios::out);
+		outStream << ">ref\nACG-T\n>s2\nACGAT\n>s3\nTCG-A\n";
+		outStream.close();
+		const BayesicSpace::ParseFASTA liftParser(liftFile);
+		std::remove( liftFile.c_str() );
+		outStream.open(outFileName, std::ios::out);
+		BayesicSpace::savePolymorphicWindow(liftParser, 0, 5, BayesicSpace::WindowPlan{BayesicSpace::WindowEngine::hash, 1, 0.0, 0.0}, false,
+			liftParser.coordinateIndex("ref"), outStream);
+		outStream.close();
+		inStream.open(outFileName, std::ios::in);
+		std::getline(inStream, line);
+		inStream.close();
+		std::remove( outFileName.c_str() );
+		REQUIRE( line == "# 1,3+,4" );
+	}
+}